@@ -0,0 +1,365 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        main.cpp
+
+ */
+/*============================================================================*/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <torch/script.h>
+
+#include <Utils_Logging.hpp>
+#include <Utils_Preprocessing.hpp>
+#include <DeepLabV3_Inference.hpp>
+#include <DeepImageMatting_Inference.hpp>
+#include <VideoBackgroundEraser_Algo.hpp>
+#include <VideoBackgroundEraser_Compositor.hpp>
+
+// Every benchmark runs at these resolutions, selected by the benchmark argument
+static const cv::Size g_resolutions[] = {cv::Size(1280, 720), cv::Size(1920, 1080), cv::Size(3840, 2160)};
+static const char* g_resolutionNames[] = {"720p", "1080p", "4K"};
+
+// Paths of the stand-in models, written once at startup
+static std::string g_deeplabv3_path;
+static std::string g_deepimagematting_path;
+
+////// STAND-IN MODELS //////
+// Small convolution stacks with the inputs and outputs of the real networks, so the code around them can be
+// measured without downloading the trained weights. Their own inference time means nothing.
+int createStandInModels()
+{
+    try {
+        torch::NoGradGuard no_grad_guard;
+
+        // DeepLabV3 : NCHW normalized rgb -> NCHW scores of 5 classes, same resolution
+        torch::jit::script::Module deeplabv3("DeepLabV3_StandIn");
+        deeplabv3.register_parameter("conv1", 0.1*torch::randn({8, 3, 3, 3}), false);
+        deeplabv3.register_parameter("conv2", 0.1*torch::randn({5, 8, 3, 3}), false);
+        deeplabv3.define(R"JIT(
+def forward(self, x):
+    x = torch.relu(torch.conv2d(x, self.conv1, None, [1, 1], [1, 1]))
+    return torch.conv2d(x, self.conv2, None, [1, 1], [1, 1])
+)JIT");
+        g_deeplabv3_path = cv::tempfile(".pt");
+        deeplabv3.save(g_deeplabv3_path);
+
+        // DeepImageMatting : NCHW rgb and trimap -> NCHW alpha in [0, 1], same resolution
+        torch::jit::script::Module deepimagematting("DeepImageMatting_StandIn");
+        deepimagematting.register_parameter("conv1", 0.1*torch::randn({8, 4, 3, 3}), false);
+        deepimagematting.register_parameter("conv2", 0.1*torch::randn({1, 8, 3, 3}), false);
+        deepimagematting.define(R"JIT(
+def forward(self, x):
+    x = torch.relu(torch.conv2d(x, self.conv1, None, [1, 1], [1, 1]))
+    return torch.sigmoid(torch.conv2d(x, self.conv2, None, [1, 1], [1, 1]))
+)JIT");
+        g_deepimagematting_path = cv::tempfile(".pt");
+        deepimagematting.save(g_deepimagematting_path);
+    } catch(const c10::Error& e) {
+        logging_error("Failed to create the stand-in models : " << e.what());
+        return -1;
+    }
+
+    return 0;
+}
+
+////// SYNTHETIC FRAMES //////
+// Noisy background and a foreground ellipse, moved horizontally by i_shift pixels.
+// o_backgroundMask is the ground truth, 255 for background pixels
+void createFrame(const cv::Size& i_size, int i_shift, cv::Mat& o_image, cv::Mat& o_backgroundMask)
+{
+    cv::RNG rng(1234);
+    o_image.create(i_size, CV_8UC3);
+    rng.fill(o_image, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(64));
+    const cv::Point center(i_size.width/2 + i_shift, i_size.height/2);
+    const cv::Size axes(i_size.width/6, i_size.height/3);
+    cv::ellipse(o_image, center, axes, 0, 0, 360, cv::Scalar(200, 120, 80), cv::FILLED);
+
+    o_backgroundMask.create(i_size, CV_8U);
+    o_backgroundMask.setTo(255);
+    cv::ellipse(o_backgroundMask, center, axes, 0, 0, 360, cv::Scalar(0), cv::FILLED);
+}
+
+// Stand-in models, or the trained ones given by VBGE_BENCHMARK_DEEPLABV3 and VBGE_BENCHMARK_DEEPIMAGEMATTING : the
+// quality counters only mean something with the trained models
+VBGE::VideoBackgroundEraser_Settings getSettings()
+{
+    VBGE::VideoBackgroundEraser_Settings settings;
+    const char* deeplabv3_path = std::getenv("VBGE_BENCHMARK_DEEPLABV3");
+    const char* deepimagematting_path = std::getenv("VBGE_BENCHMARK_DEEPIMAGEMATTING");
+    settings.deeplabv3_inference.model_path = (nullptr != deeplabv3_path) ? deeplabv3_path : g_deeplabv3_path;
+    settings.deepimagematting_inference.model_path = (nullptr != deepimagematting_path) ? deepimagematting_path : g_deepimagematting_path;
+    settings.imageMatting_scale = 0.5f;
+    return settings;
+}
+
+void setResolutionLabel(benchmark::State& state)
+{
+    state.SetLabel(g_resolutionNames[state.range(0)]);
+}
+
+////// BENCHMARKS //////
+// Packed uint8 to normalized planar float, input of both networks
+static void BM_Preprocessing(benchmark::State& state)
+{
+    const cv::Size size = g_resolutions[state.range(0)];
+    cv::Mat image, backgroundMask;
+    createFrame(size, 0, image, backgroundMask);
+    std::vector<float> planes(3*size.area());
+    const cv::Vec3f mean(0.485f, 0.456f, 0.406f);
+    const cv::Vec3f stdDev(0.229f, 0.224f, 0.225f);
+    for(auto _ : state) {
+        VBGE::preprocess_packedToPlanar(image, false, 1.f/255.f, mean, stdDev, planes.data());
+        benchmark::DoNotOptimize(planes.data());
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_Preprocessing)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Same, written as bfloat16 for InferencePrecision::BF16
+static void BM_Preprocessing_BFloat16(benchmark::State& state)
+{
+    const cv::Size size = g_resolutions[state.range(0)];
+    cv::Mat image, backgroundMask;
+    createFrame(size, 0, image, backgroundMask);
+    std::vector<uint16_t> planes(3*size.area());
+    const cv::Vec3f mean(0.485f, 0.456f, 0.406f);
+    const cv::Vec3f stdDev(0.229f, 0.224f, 0.225f);
+    for(auto _ : state) {
+        VBGE::preprocess_packedToPlanar(image, false, 1.f/255.f, mean, stdDev, planes.data());
+        benchmark::DoNotOptimize(planes.data());
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_Preprocessing_BFloat16)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// DeepLabV3_Inference::run : preprocessing, forward, argmax and copy of the classes id
+static void BM_DeepLabV3_Run(benchmark::State& state)
+{
+    VBGE::DeepLabV3_Inference deeplabv3(getSettings().deeplabv3_inference);
+    std::vector<cv::Mat> images(1), segmentations;
+    cv::Mat backgroundMask;
+    createFrame(g_resolutions[state.range(0)], 0, images[0], backgroundMask);
+    for(auto _ : state) {
+        deeplabv3.run(images, segmentations);
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_DeepLabV3_Run)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// DeepLabV3_Inference::run_backgroundMask : preprocessing, forward, and reduction to the background mask
+static void BM_DeepLabV3_BackgroundMask(benchmark::State& state)
+{
+    VBGE::DeepLabV3_Inference deeplabv3(getSettings().deeplabv3_inference);
+    std::vector<cv::Mat> images(1), backgroundMasks;
+    cv::Mat backgroundMask;
+    createFrame(g_resolutions[state.range(0)], 0, images[0], backgroundMask);
+    for(auto _ : state) {
+        deeplabv3.run_backgroundMask(images, backgroundMasks);
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_DeepLabV3_BackgroundMask)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Segmentation stage : DeepLabV3 and mask building, argument 1 selects the fused background mask
+static void BM_Stage_Segmentation(benchmark::State& state)
+{
+    VBGE::VideoBackgroundEraser_Settings settings = getSettings();
+    settings.enable_fusedBackgroundMask = (0 != state.range(1));
+    VBGE::VideoBackgroundEraser_Algo algo(settings);
+    VBGE::VideoBackgroundEraser_Frame frame;
+    cv::Mat backgroundMask;
+    createFrame(g_resolutions[state.range(0)], 0, frame.image, backgroundMask);
+    for(auto _ : state) {
+        algo.run_segmentation(frame);
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_Stage_Segmentation)->ArgsProduct({{0, 1, 2}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// Segmentation stage at segmentation_scale = argument 1 / 100, guided upsampling included. The counter
+// trimap_mismatch is the fraction of the pixels whose trimap differs from the one at scale 1 on the same frame
+static void BM_Stage_SegmentationScale(benchmark::State& state)
+{
+    VBGE::VideoBackgroundEraser_Settings settings = getSettings();
+    VBGE::VideoBackgroundEraser_Frame reference;
+    cv::Mat backgroundMask;
+    createFrame(g_resolutions[state.range(0)], 0, reference.image, backgroundMask);
+    {
+        VBGE::VideoBackgroundEraser_Algo algo(settings);
+        algo.run_segmentation(reference);
+        algo.run_trimap(reference);
+    }
+    settings.deeplabv3_inference.segmentation_scale = state.range(1) / 100.f;
+    VBGE::VideoBackgroundEraser_Algo algo(settings);
+    VBGE::VideoBackgroundEraser_Frame frame;
+    frame.image = reference.image;
+    for(auto _ : state) {
+        algo.run_segmentation(frame);
+    }
+    algo.run_trimap(frame);
+    cv::Mat mismatch;
+    cv::compare(frame.trimap, reference.trimap, mismatch, cv::CMP_NE);
+    state.counters["trimap_mismatch"] = cv::countNonZero(mismatch) / static_cast<double>(mismatch.total());
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_Stage_SegmentationScale)->ArgsProduct({{0, 1, 2}, {100, 50, 25}})->Unit(benchmark::kMillisecond);
+
+// Trimap stage : compute_trimap() and its resizes, argument 1 adds temporalManagement() on two alternating frames
+static void BM_Stage_Trimap(benchmark::State& state)
+{
+    VBGE::VideoBackgroundEraser_Settings settings = getSettings();
+    settings.enable_temporalManagement = (0 != state.range(1));
+    VBGE::VideoBackgroundEraser_Algo algo(settings);
+    VBGE::VideoBackgroundEraser_Frame frames[2];
+    for(int i = 0 ; i < 2 ; ++i) {
+        createFrame(g_resolutions[state.range(0)], 8*i, frames[i].image, frames[i].backgroundMask);
+    }
+    int i = 0;
+    for(auto _ : state) {
+        algo.run_trimap(frames[i]);
+        i = 1 - i;
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_Stage_Trimap)->ArgsProduct({{0, 1, 2}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// DeepImageMatting_Inference::run at the resolution of Deep Image Matting
+static void BM_DeepImageMatting_Run(benchmark::State& state)
+{
+    VBGE::VideoBackgroundEraser_Settings settings = getSettings();
+    VBGE::VideoBackgroundEraser_Algo algo(settings);
+    VBGE::DeepImageMatting_Inference deepimagematting(settings.deepimagematting_inference);
+    VBGE::VideoBackgroundEraser_Frame frame;
+    createFrame(g_resolutions[state.range(0)], 0, frame.image, frame.backgroundMask);
+    algo.run_trimap(frame);
+    std::vector<cv::Mat> images(1), trimaps(1, frame.trimap_down), alphas;
+    cv::resize(frame.image, images[0], frame.trimap_down.size(), 0, 0, cv::INTER_AREA);
+    for(auto _ : state) {
+        deepimagematting.run(images, trimaps, alphas);
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_DeepImageMatting_Run)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Tiled DeepImageMatting_Inference::run, 512 pixels tiles with the default overlap. The counter alpha_mae_x255 is the
+// mean absolute difference against untiled inference on the same frame, in 1/255 : the target is below 1.
+// With the stand-in model, whose context is a few pixels, it only checks the blending of the tiles : the trained
+// model (see getSettings()) checks the tolerance itself
+static void BM_DeepImageMatting_Tiled(benchmark::State& state)
+{
+    VBGE::VideoBackgroundEraser_Settings settings = getSettings();
+    VBGE::VideoBackgroundEraser_Algo algo(settings);
+    VBGE::DeepImageMatting_Inference deepimagematting(settings.deepimagematting_inference);
+    VBGE::DeepImageMatting_Inference_Settings tiledSettings = settings.deepimagematting_inference;
+    tiledSettings.tile_size = 512;
+    VBGE::DeepImageMatting_Inference deepimagematting_tiled(tiledSettings);
+    VBGE::VideoBackgroundEraser_Frame frame;
+    createFrame(g_resolutions[state.range(0)], 0, frame.image, frame.backgroundMask);
+    algo.run_trimap(frame);
+    std::vector<cv::Mat> images(1), trimaps(1, frame.trimap_down), alphas, alphas_tiled;
+    cv::resize(frame.image, images[0], frame.trimap_down.size(), 0, 0, cv::INTER_AREA);
+    deepimagematting.run(images, trimaps, alphas);
+    for(auto _ : state) {
+        deepimagematting_tiled.run(images, trimaps, alphas_tiled);
+    }
+    state.counters["alpha_mae_x255"] = 255. * cv::norm(alphas[0], alphas_tiled[0], cv::NORM_L1) / alphas[0].total();
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_DeepImageMatting_Tiled)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Matting stage : resizes before and after Deep Image Matting, post processing, and merge of alpha with the image.
+// Argument 1 selects roi matting
+static void BM_Stage_Matting(benchmark::State& state)
+{
+    VBGE::VideoBackgroundEraser_Settings settings = getSettings();
+    settings.enable_roiMatting = (0 != state.range(1));
+    VBGE::VideoBackgroundEraser_Algo algo(settings);
+    VBGE::VideoBackgroundEraser_Frame frame;
+    createFrame(g_resolutions[state.range(0)], 0, frame.image, frame.backgroundMask);
+    frame.imageNetwork = frame.image;
+    algo.run_trimap(frame);
+    for(auto _ : state) {
+        algo.run_matting(frame);
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_Stage_Matting)->ArgsProduct({{0, 1, 2}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// Compositing over the grid background of the sample
+static void BM_Compositing(benchmark::State& state)
+{
+    const cv::Size size = g_resolutions[state.range(0)];
+    cv::Mat image, backgroundMask;
+    createFrame(size, 0, image, backgroundMask);
+    cv::Mat image_withoutBackground;
+    cv::cvtColor(image, image_withoutBackground, cv::COLOR_RGB2RGBA);
+    cv::Mat alpha;
+    cv::GaussianBlur(255 - backgroundMask, alpha, cv::Size(15, 15), 0);
+    const int fromTo[] = {0, 3};
+    cv::mixChannels(&alpha, 1, &image_withoutBackground, 1, fromTo, 1);
+
+    cv::Mat grid(size, CV_8UC3, cv::Scalar::all(255));
+    for(int x = 0 ; x < size.width ; x += 32) {
+        cv::line(grid, cv::Point(x, 0), cv::Point(x, size.height - 1), cv::Scalar::all(0));
+    }
+    for(int y = 0 ; y < size.height ; y += 32) {
+        cv::line(grid, cv::Point(0, y), cv::Point(size.width - 1, y), cv::Scalar::all(0));
+    }
+    VBGE::VideoBackgroundEraser_Compositor compositor;
+    compositor.set_background(grid, cv::INTER_NEAREST);
+    cv::Mat composite;
+    for(auto _ : state) {
+        compositor.run(image_withoutBackground, composite);
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_Compositing)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Time to first frame : models loading, optional freezing and optimization, and the first frame through every stage.
+// Argument 1 selects enable_optimizeForInference. The steady-state latency is the one of the stage benchmarks
+static void BM_TimeToFirstFrame(benchmark::State& state)
+{
+    VBGE::VideoBackgroundEraser_Settings settings = getSettings();
+    settings.deeplabv3_inference.enable_optimizeForInference = (0 != state.range(1));
+    settings.deepimagematting_inference.enable_optimizeForInference = (0 != state.range(1));
+    cv::Mat image, backgroundMask;
+    createFrame(g_resolutions[state.range(0)], 0, image, backgroundMask);
+    for(auto _ : state) {
+        VBGE::VideoBackgroundEraser_Algo algo(settings);
+        VBGE::VideoBackgroundEraser_Frame frame;
+        frame.image = image;
+        algo.run_segmentation(frame);
+        algo.run_trimap(frame);
+        algo.run_matting(frame);
+    }
+    setResolutionLabel(state);
+}
+BENCHMARK(BM_TimeToFirstFrame)->ArgsProduct({{0, 1, 2}, {0, 1}})->Unit(benchmark::kMillisecond)->Iterations(3);
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    if(0 > createStandInModels()) {
+        logging_error("createStandInModels() failed.");
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    std::remove(g_deeplabv3_path.c_str());
+    std::remove(g_deepimagematting_path.c_str());
+
+    return 0;
+}
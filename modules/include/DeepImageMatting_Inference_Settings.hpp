@@ -16,6 +16,8 @@
 #include <opencv2/opencv.hpp>
 #include <torch/script.h>
 
+#include "Utils_InferencePrecision.hpp"
+
 /*============================================================================*/
 /* namespace                                                                  */
 /*============================================================================*/
@@ -35,6 +37,41 @@ public:
 
     //! @brief Device to use for inference : torch::kCPU or torch::kCUDA (multi GPU is not handled)
     torch::DeviceType inferenceDeviceType = torch::kCPU;
+
+    //! @brief Side of the square tiles of tiled inference, in pixels. Larger images are processed tile by tile,
+    //!        so peak memory depends on the tile size instead of the image size. 0 disables tiling
+    //!        (unless maxMemory_bytes requires it)
+    int               tile_size = 0;
+
+    //! @brief Overlap between neighbouring tiles, in pixels. Alpha is blended over the overlap with weights ramping
+    //!        from the tile borders. Tiles only see tile_overlap pixels of context across a seam : with at least 128,
+    //!        the target tolerance against untiled inference is a mean absolute difference of alpha below 1/255,
+    //!        reported by the DeepImageMatting_Tiled benchmark
+    int               tile_overlap = 128;
+
+    //! @brief Memory cap of a forward, in bytes. Chooses the tile size (the smallest of this and tile_size)
+    //!        and the number of images (or tiles) given to a single forward. 0 for no cap
+    size_t            maxMemory_bytes = 0;
+
+    //! @brief Estimated peak memory of a forward per input pixel, in bytes, used with maxMemory_bytes.
+    //!        Depends on the model and the device : measure it with a forward on an image of known size
+    int               memory_bytesPerPixel = 1024;
+
+    //! @brief Freeze the model and optimize it for inference (conv-BN folding, oneDNN layouts on CPU). Needs libtorch 1.10 or later
+    bool              enable_optimizeForInference = false;
+
+    //! @brief Directory where the frozen model is saved, keyed by the path, size and modification time of
+    //!        model_path, so later startups skip freezing.
+    //!        Empty to disable the cache. Only used with enable_optimizeForInference
+    std::string       optimizedModel_cacheDirectory = "";
+
+    //! @brief Precision of the forwards. BF16 converts the model and falls back to FP32 on CPUs without native bfloat16.
+    //!        INT8 loads quantized_model_path instead of model_path, and needs inferenceDeviceType = torch::kCPU
+    InferencePrecision precision = InferencePrecision::FP32;
+
+    //! @brief Path to the post-training quantized TorchScript model, produced from model_path by tools/quantize_model.py.
+    //!        Only used with InferencePrecision::INT8
+    std::string       quantized_model_path = "/some/path/data/best_DeepImageMatting_int8.pt";
 };
 
 } /* namespace VBGE */
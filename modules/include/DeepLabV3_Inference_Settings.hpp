@@ -16,6 +16,8 @@
 #include <opencv2/opencv.hpp>
 #include <torch/script.h>
 
+#include "Utils_InferencePrecision.hpp"
+
 /*============================================================================*/
 /* namespace                                                                  */
 /*============================================================================*/
@@ -38,6 +40,38 @@ public:
 
     //! @brief Device to use for inference : torch::kCPU or torch::kCUDA (multi GPU is not handled)
     torch::DeviceType    inferenceDeviceType = torch::kCPU;
+
+    //! @brief Number of rows reduced at once when computing a background mask (see DeepLabV3_Inference::run_backgroundMask()).
+    //!        Bounds the size of the temporary tensors, 0 reduces the whole image at once
+    int                  backgroundMask_chunkRows = 64;
+
+    //! @brief Freeze the model and optimize it for inference (conv-BN folding, oneDNN layouts on CPU). Needs libtorch 1.10 or later
+    bool                 enable_optimizeForInference = false;
+
+    //! @brief Directory where the frozen model is saved, keyed by the path, size and modification time of
+    //!        model_path, so later startups skip freezing.
+    //!        Empty to disable the cache. Only used with enable_optimizeForInference
+    std::string          optimizedModel_cacheDirectory = "";
+
+    //! @brief Precision of the forwards. BF16 converts the model and falls back to FP32 on CPUs without native bfloat16.
+    //!        INT8 loads quantized_model_path instead of model_path, and needs inferenceDeviceType = torch::kCPU
+    InferencePrecision   precision = InferencePrecision::FP32;
+
+    //! @brief Path to the post-training quantized TorchScript model, produced from model_path by tools/quantize_model.py.
+    //!        Only used with InferencePrecision::INT8
+    std::string          quantized_model_path = "/some/path/data/best_deeplabv3_skydiver_int8.pt";
+
+    //! @brief Rescale factor of the images before the network, in ]0, 1]. The segmentation only needs to be coarse, Deep Image
+    //!        Matting refines the edges. Outputs keep the input resolution : background masks are upsampled guided by the
+    //!        input image (see segmentation_guidedRadius), classes with the nearest neighbour
+    float                segmentation_scale = 1.f;
+
+    //! @brief Radius of the guided upsampling of the background masks, in pixels at the resolution of the network
+    int                  segmentation_guidedRadius = 4;
+
+    //! @brief Regularization of the guided upsampling, for a luma in [0, 1] : image edges with a contrast below its square root
+    //!        do not move the mask edges
+    float                segmentation_guidedEps = 1e-3f;
 };
 
 } /* namespace VBGE */
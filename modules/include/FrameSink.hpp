@@ -0,0 +1,95 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef FRAMESINK_HPP_
+#define FRAMESINK_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <cstdint>
+
+#include <opencv2/opencv.hpp>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Interface of the destinations of the processed frames
+ *
+ *              A sink takes ownership of the frames it receives and may encode and
+ *              write them asynchronously. write() blocks when the sink falls behind.
+ */
+/*============================================================================*/
+class FrameSink {
+public:
+
+    //! @brief Encoding statistics, since the creation of the sink
+    struct Statistics {
+        //! @brief Number of frames written
+        uint64_t nbFrames = 0;
+        //! @brief Number of bytes written
+        uint64_t nbBytes = 0;
+        //! @brief Cumulated time spent encoding and writing, over all workers
+        double   encodeSeconds = 0.;
+        //! @brief Time elapsed between the first write() and the last written frame
+        double   elapsedSeconds = 0.;
+        //! @brief Number of frames written per second of elapsed time
+        double   framesPerSecond = 0.;
+        //! @brief Number of megabytes written per second of elapsed time
+        double   megabytesPerSecond = 0.;
+    };
+
+    virtual ~FrameSink() {}
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Class instance status
+     * @return 		(bool)         : True if the class instance was correctly initialized
+     *
+     */
+    /*============================================================================*/
+    virtual bool get_isInitialized() = 0;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Give a frame to the sink. Blocks while too many frames are pending.
+     * @param[in] 		i_index  : Index of the frame in the stream
+     * @param[in] 		io_image : Frame to write, ownership is taken by the sink
+     * @return 		(int)    : 0 on success, negative if the sink failed (including a previous asynchronous write)
+     *
+     */
+    /*============================================================================*/
+    virtual int write(int64_t i_index, cv::Mat&& io_image) = 0;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Wait until all pending frames are written
+     * @return 		(int)    : 0 on success, negative if a write failed
+     *
+     */
+    /*============================================================================*/
+    virtual int flush() = 0;
+
+    virtual Statistics get_statistics() = 0;
+};
+
+} /* namespace VBGE */
+#endif /* FRAMESINK_HPP_ */
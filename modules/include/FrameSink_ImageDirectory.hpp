@@ -0,0 +1,108 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_ImageDirectory.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef FRAMESINK_IMAGEDIRECTORY_HPP_
+#define FRAMESINK_IMAGEDIRECTORY_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "FrameSink.hpp"
+#include "FrameSink_ImageDirectory_Settings.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Write frames as numbered images in a directory
+ *
+ *              A pool of workers encodes and writes the frames in parallel. Frames may reach
+ *              the disk in any order, but each file is named after the index of its frame.
+ */
+/*============================================================================*/
+class FrameSink_ImageDirectory : public FrameSink {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor, starts the workers
+     * @param[in] 		i_settings         : user settings
+     *
+     */
+    /*============================================================================*/
+    FrameSink_ImageDirectory(const FrameSink_ImageDirectory_Settings& i_settings);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Destructor, writes the pending frames and stops the workers
+     *
+     */
+    /*============================================================================*/
+    virtual ~FrameSink_ImageDirectory();
+
+    virtual bool get_isInitialized();
+
+    virtual int write(int64_t i_index, cv::Mat&& io_image);
+
+    virtual int flush();
+
+    virtual Statistics get_statistics();
+
+private:
+    struct Job {
+        int64_t index;
+        cv::Mat image;
+    };
+
+    // Misc
+    bool m_isInitialized = false;
+
+    // Settings
+    const FrameSink_ImageDirectory_Settings m_settings;
+    std::vector<int> m_encoderParams;
+
+    // Members
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_jobDone;
+    std::deque<Job> m_jobs;
+    int m_nbJobsInProgress = 0;
+    bool m_stop = false;
+    bool m_hasFailed = false;
+
+    // Statistics
+    Statistics m_statistics;
+    bool m_hasStarted = false;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    void worker_loop();
+    bool write_image(const Job& i_job, uint64_t& o_nbBytes);
+};
+
+} /* namespace VBGE */
+#endif /* FRAMESINK_IMAGEDIRECTORY_HPP_ */
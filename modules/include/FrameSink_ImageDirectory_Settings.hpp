@@ -0,0 +1,49 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_ImageDirectory_Settings.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef FRAMESINK_IMAGEDIRECTORY_SETTINGS_HPP_
+#define FRAMESINK_IMAGEDIRECTORY_SETTINGS_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <opencv2/opencv.hpp>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+class FrameSink_ImageDirectory_Settings {
+public:
+
+    //! @brief Path to the directory where images are written, as <directory_path>/<index, 8 digits><extension>
+    std::string directory_path = "";
+
+    //! @brief Extension of the images, which selects the encoder
+    std::string extension = ".png";
+
+    //! @brief Offset added to the frame index in the file names
+    int64_t     index_offset = 0;
+
+    //! @brief Number of threads encoding and writing images in parallel
+    int         nbWorkers = 4;
+
+    //! @brief Maximum number of frames waiting to be written. write() blocks above this limit
+    int         maxPendingFrames = 8;
+
+    //! @brief PNG compression level, from 0 (no compression) to 9 (smallest size, slowest). 1 is the cv::imwrite default
+    int         png_compression = 1;
+
+    //! @brief PNG compression strategy, one of cv::ImwritePNGFlags. cv::IMWRITE_PNG_STRATEGY_RLE is the cv::imwrite default
+    int         png_strategy = cv::IMWRITE_PNG_STRATEGY_RLE;
+};
+
+} /* namespace VBGE */
+#endif /* FRAMESINK_IMAGEDIRECTORY_SETTINGS_HPP_ */
@@ -0,0 +1,163 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_Raw.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef FRAMESINK_RAW_HPP_
+#define FRAMESINK_RAW_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <chrono>
+#include <mutex>
+#include <streambuf>
+
+#include <opencv2/opencv.hpp>
+
+#include "FrameSink.hpp"
+#include "FrameSink_Raw_Settings.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+//! @brief Header at the start of a raw file, native endianness. The frame table (RawFrameEntry[capacity]) follows it
+struct RawFileHeader {
+    //! @brief "VBGERAW1"
+    char     magic[8];
+    uint32_t version;
+    //! @brief Size of the header and of the frame table, page aligned : offset of the first frame
+    uint32_t headerSize;
+    uint32_t width;
+    uint32_t height;
+    //! @brief Number of channels, 4, of 8 bits
+    uint32_t channels;
+    //! @brief Order of the channels, "BGRA" or "RGBA"
+    char     layout[4];
+    //! @brief Size of a frame, rows without padding
+    uint64_t frameSize;
+    //! @brief Distance between two frames, page aligned so each frame can be mapped alone
+    uint64_t frameStride;
+    //! @brief Number of entries of the frame table, the maximum number of frames. The file only holds the frames
+    //!        reserved so far, it grows while frames are written : readers map headerSize + frameCount*frameStride bytes
+    uint64_t capacity;
+    //! @brief Number of frames written. Updated with a release store once a frame and its entry are complete :
+    //!        a reader loading it with acquire semantics can read every frame below it
+    uint64_t frameCount;
+};
+
+//! @brief Entry of the frame table
+struct RawFrameEntry {
+    //! @brief Offset of the frame from the start of the file
+    uint64_t offset;
+    //! @brief Index of the frame in the input stream
+    int64_t  index;
+    //! @brief Presentation time of the frame in the input, in milliseconds. -1 if unknown
+    double   timestamp_ms;
+};
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Write uncompressed frames, without any encoding
+ *
+ *              File mode : the file is created at the first frame, sized for maxFrames frames, and
+ *              mapped in memory. It doubles when more frames come, up to a frame table of 4 times
+ *              maxFrames. Each frame is copied to its place, then published in the header
+ *              (see RawFileHeader::frameCount) : consumers can map the file and read frame N in place
+ *              while it is being written. The file is truncated after the last frame at destruction.
+ *
+ *              Standard output mode : the frames are written back to back, to be piped into
+ *              "ffmpeg -f rawvideo -pix_fmt bgra -s WxH -i -". std::cout is redirected to std::cerr
+ *              while the sink exists, so the logs do not mix with the frames.
+ *
+ *              Frames are written in the calling thread, the copy is the only cost.
+ */
+/*============================================================================*/
+class FrameSink_Raw : public FrameSink {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor
+     * @param[in] 		i_settings         : user settings
+     *
+     */
+    /*============================================================================*/
+    FrameSink_Raw(const FrameSink_Raw_Settings& i_settings);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Destructor, unmaps and truncates the file, or restores std::cout
+     *
+     */
+    /*============================================================================*/
+    virtual ~FrameSink_Raw();
+
+    virtual bool get_isInitialized();
+
+    virtual int write(int64_t i_index, cv::Mat&& io_image);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Same as write(), with the timestamp of the frame, stored in the frame table
+     * @param[in] 		i_index        : Index of the frame in the stream
+     * @param[in] 		i_timestamp_ms : Presentation time of the frame in the input, in milliseconds
+     * @param[in] 		io_image       : Frame to write, CV_8UC4
+     * @return 		(int)    : 0 on success, negative on error
+     *
+     */
+    /*============================================================================*/
+    int write(int64_t i_index, double i_timestamp_ms, cv::Mat&& io_image);
+
+    virtual int flush();
+
+    virtual Statistics get_statistics();
+
+private:
+    // Misc
+    bool m_isInitialized = false;
+
+    // Settings
+    const FrameSink_Raw_Settings m_settings;
+
+    // Members
+    std::mutex m_mutex;
+    bool m_isStdout = false;
+    std::streambuf* m_coutBuffer = nullptr;
+    int m_file = -1;
+    uchar* m_map = nullptr;
+    size_t m_mapSize = 0;
+    RawFileHeader* m_header = nullptr;
+    RawFrameEntry* m_entries = nullptr;
+    cv::Size m_size;
+    bool m_hasFailed = false;
+
+    // Statistics
+    Statistics m_statistics;
+    bool m_hasStarted = false;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    //! @brief Create and map the file, at the size of the first frame
+    bool create_file(const cv::Size& i_size);
+    //! @brief Extend the file and its mapping for more frames, up to the capacity of the frame table
+    bool grow_file();
+    bool write_file(int64_t i_index, double i_timestamp_ms, const cv::Mat& i_image, uint64_t& o_nbBytes);
+    bool write_stdout(const cv::Mat& i_image, uint64_t& o_nbBytes);
+};
+
+} /* namespace VBGE */
+#endif /* FRAMESINK_RAW_HPP_ */
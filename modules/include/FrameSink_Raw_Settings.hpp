@@ -0,0 +1,44 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_Raw_Settings.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef FRAMESINK_RAW_SETTINGS_HPP_
+#define FRAMESINK_RAW_SETTINGS_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <cstdint>
+#include <string>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+class FrameSink_Raw_Settings {
+public:
+
+    //! @brief Path of the raw file, or "-" to stream the frames to the standard output, without header
+    std::string path = "";
+
+    //! @brief Expected number of frames, an estimate : the file is first sized for it, then doubles when needed.
+    //!        The table of offsets and timestamps holds 4 times as many frames, write() fails once it is full.
+    //!        Not used on the standard output
+    int64_t     maxFrames = 0;
+
+    //! @brief Reserve the blocks of the whole file when it is created (posix_fallocate), so writing never
+    //!        runs out of space nor fragments the file. Otherwise the file is sparse
+    bool        enable_preallocation = true;
+
+    //! @brief Frames are BGRA packed (OpenCV default) instead of RGBA
+    bool        isBGR = true;
+};
+
+} /* namespace VBGE */
+#endif /* FRAMESINK_RAW_SETTINGS_HPP_ */
@@ -0,0 +1,142 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_Video.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef FRAMESINK_VIDEO_HPP_
+#define FRAMESINK_VIDEO_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+
+#include "FrameSink.hpp"
+#include "FrameSink_Video_Settings.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Write RGBA frames to a video container, with an intra codec keeping the alpha channel
+ *
+ *              cv::VideoWriter only takes 1 or 3 channels : the frames are piped raw to an FFmpeg
+ *              process, started at the first frame with its size. A dedicated thread feeds the
+ *              pipe in frame order, FFmpeg encodes with its own threads. Frames must be in order and
+ *              of the same size. The video has a constant frame rate : each frame is placed at its
+ *              timestamp when it has one (variable frame rate inputs), else at its index, and is
+ *              repeated up to the next one, or dropped when the video is already past its time
+ *              (as ffmpeg -vsync cfr). Missing indices are logged. The videos are finalized when
+ *              the sink is destroyed. The statistics count the raw bytes given to the encoder.
+ */
+/*============================================================================*/
+class FrameSink_Video : public FrameSink {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor, starts the encoding thread
+     * @param[in] 		i_settings         : user settings
+     *
+     */
+    /*============================================================================*/
+    FrameSink_Video(const FrameSink_Video_Settings& i_settings);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Destructor, writes the pending frames, stops the thread and finalizes the videos
+     *
+     */
+    /*============================================================================*/
+    virtual ~FrameSink_Video();
+
+    virtual bool get_isInitialized();
+
+    virtual int write(int64_t i_index, cv::Mat&& io_image);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Same as write(), with the timestamp of the frame, which places it in the video
+     * @param[in] 		i_index        : Index of the frame in the stream
+     * @param[in] 		i_timestamp_ms : Presentation time of the frame in the input, in milliseconds, -1 if unknown
+     * @param[in] 		io_image       : Frame to write, CV_8UC4
+     * @return 		(int)    : 0 on success, negative on error
+     *
+     */
+    /*============================================================================*/
+    int write(int64_t i_index, double i_timestamp_ms, cv::Mat&& io_image);
+
+    virtual int flush();
+
+    virtual Statistics get_statistics();
+
+private:
+    struct Job {
+        int64_t index;
+        double timestamp_ms;
+        cv::Mat image;
+    };
+
+    // Misc
+    bool m_isInitialized = false;
+
+    // Settings
+    const FrameSink_Video_Settings m_settings;
+
+    // Members
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_jobDone;
+    std::deque<Job> m_jobs;
+    bool m_isJobInProgress = false;
+    bool m_stop = false;
+    bool m_hasFailed = false;
+    // Owned by the encoding thread : encoder processes, size of the videos, alpha plane, first and last frames given,
+    // and number of frames of the videos
+    FILE* m_video = nullptr;
+    FILE* m_alpha = nullptr;
+    cv::Size m_size;
+    cv::Mat m_alphaPlane;
+    int64_t m_firstIndex = -1;
+    double m_firstTimestamp_ms = -1.;
+    int64_t m_lastIndex = -1;
+    int64_t m_nbVideoFrames = 0;
+
+    // Statistics
+    Statistics m_statistics;
+    bool m_hasStarted = false;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    void encode_loop();
+    bool encode_image(const Job& i_job, uint64_t& o_nbBytes);
+    //! @brief Start the encoders at the size of the first frame
+    bool open_encoders(const cv::Size& i_size);
+    //! @brief Close the pipes and wait for the encoders, returns false if one of them failed
+    bool close_encoders();
+};
+
+} /* namespace VBGE */
+#endif /* FRAMESINK_VIDEO_HPP_ */
@@ -0,0 +1,61 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_Video_Settings.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef FRAMESINK_VIDEO_SETTINGS_HPP_
+#define FRAMESINK_VIDEO_SETTINGS_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <string>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+//! @brief Intra codecs keeping the alpha channel
+enum class VideoCodec {
+    //! @brief QuickTime Animation (qtrle), lossless run-length, .mov
+    QuickTimeAnimation,
+    //! @brief PNG in a .mov, lossless, smaller than qtrle on natural images but slower to encode
+    PNG,
+    //! @brief FFV1, lossless, .mkv or .mov, the best ratio of size and encoding speed
+    FFV1
+};
+
+class FrameSink_Video_Settings {
+public:
+
+    //! @brief Path of the video, the container is selected by its extension
+    std::string path = "";
+
+    //! @brief Codec of the video and of the alpha matte
+    VideoCodec  codec = VideoCodec::QuickTimeAnimation;
+
+    //! @brief Frame rate of the video, the one of the input video. A frame is shown at its timestamp rounded to
+    //!        a multiple of 1 / fps seconds, or without timestamp at (index - first index) / fps seconds
+    double      fps = 25.;
+
+    //! @brief Frames are BGRA packed (OpenCV default) instead of RGBA
+    bool        isBGR = true;
+
+    //! @brief Optional path of a second video holding only the alpha channel, as grayscale, for compositors
+    //!        which take a separate matte. Empty to disable
+    std::string alpha_path = "";
+
+    //! @brief FFmpeg executable which encodes the frames
+    std::string ffmpeg_path = "ffmpeg";
+
+    //! @brief Maximum number of frames waiting to be encoded. write() blocks above this limit
+    int         maxPendingFrames = 8;
+};
+
+} /* namespace VBGE */
+#endif /* FRAMESINK_VIDEO_SETTINGS_HPP_ */
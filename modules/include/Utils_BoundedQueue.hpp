@@ -0,0 +1,207 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_BoundedQueue.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_BOUNDEDQUEUE_HPP_
+#define UTILS_BOUNDEDQUEUE_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Bounded lock-free queue, single producer and single consumer
+ *
+ *              Items are moved in and out of a ring buffer. Only one thread may push
+ *              and only one thread may pop. The queue also gathers occupancy statistics,
+ *              which can be read from any thread.
+ */
+/*============================================================================*/
+template<typename T>
+class BoundedQueue {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor
+     * @param[in] 		i_capacity : maximum number of items stored in the queue
+     *
+     */
+    /*============================================================================*/
+    explicit BoundedQueue(size_t i_capacity)
+        : m_buffer(i_capacity + 1)
+    {
+    }
+
+    size_t capacity() const {
+        return m_buffer.size() - 1;
+    }
+
+    //! @brief Approximate number of items in the queue, exact if called by the producer or the consumer
+    size_t size() const {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        return (tail >= head) ? (tail - head) : (tail + m_buffer.size() - head);
+    }
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Push an item if the queue is not full. Producer only.
+     * @param[in,out] 	io_item : item to push, moved from only if the push succeeded
+     * @return 		(bool)  : True if the item was pushed
+     *
+     */
+    /*============================================================================*/
+    bool try_push(T& io_item) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t next = increment(tail);
+        if(next == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        m_buffer[tail] = std::move(io_item);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Pop an item if the queue is not empty. Consumer only.
+     * @param[out] 		o_item : popped item
+     * @return 		(bool) : True if an item was popped
+     *
+     */
+    /*============================================================================*/
+    bool try_pop(T& o_item) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        if(head == tail) {
+            return false;
+        }
+        // Occupancy is sampled each time the consumer takes an item
+        const size_t occupancy = (tail >= head) ? (tail - head) : (tail + m_buffer.size() - head);
+        m_occupancySum.fetch_add(occupancy, std::memory_order_relaxed);
+        m_nbPop.fetch_add(1, std::memory_order_relaxed);
+
+        o_item = std::move(m_buffer[head]);
+        m_head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Push an item, waiting while the queue is full. Producer only.
+     * @param[in,out] 	io_item  : item to push
+     * @param[in] 		i_abort  : flag checked while waiting, the push is cancelled when it becomes true
+     * @return 		(bool)   : True if the item was pushed, false if cancelled
+     *
+     */
+    /*============================================================================*/
+    bool push(T& io_item, const std::atomic<bool>& i_abort) {
+        if(try_push(io_item)) {
+            return true;
+        }
+        m_nbPushBlocked.fetch_add(1, std::memory_order_relaxed);
+        for(int spin = 0 ; false == i_abort.load(std::memory_order_relaxed) ; ++spin) {
+            backoff(spin);
+            if(try_push(io_item)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Pop an item, waiting while the queue is empty. Consumer only.
+     * @param[out] 		o_item   : popped item
+     * @param[in] 		i_abort  : flag checked while waiting, the pop is cancelled when it becomes true
+     * @return 		(bool)   : True if an item was popped, false if cancelled
+     *
+     */
+    /*============================================================================*/
+    bool pop(T& o_item, const std::atomic<bool>& i_abort) {
+        if(try_pop(o_item)) {
+            return true;
+        }
+        m_nbPopStarved.fetch_add(1, std::memory_order_relaxed);
+        for(int spin = 0 ; false == i_abort.load(std::memory_order_relaxed) ; ++spin) {
+            backoff(spin);
+            if(try_pop(o_item)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //! @brief Mean number of items in the queue, sampled at each pop
+    double get_meanOccupancy() const {
+        const uint64_t nbPop = m_nbPop.load(std::memory_order_relaxed);
+        return nbPop ? static_cast<double>(m_occupancySum.load(std::memory_order_relaxed)) / nbPop : 0.;
+    }
+
+    //! @brief Number of times the producer had to wait because the queue was full
+    uint64_t get_nbPushBlocked() const {
+        return m_nbPushBlocked.load(std::memory_order_relaxed);
+    }
+
+    //! @brief Number of times the consumer had to wait because the queue was empty
+    uint64_t get_nbPopStarved() const {
+        return m_nbPopStarved.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<T> m_buffer;
+
+    // Producer and consumer indices live on separate cache lines
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+
+    // Statistics
+    alignas(64) std::atomic<uint64_t> m_occupancySum{0};
+    std::atomic<uint64_t> m_nbPop{0};
+    std::atomic<uint64_t> m_nbPushBlocked{0};
+    std::atomic<uint64_t> m_nbPopStarved{0};
+
+    size_t increment(size_t i_index) const {
+        return (i_index + 1 == m_buffer.size()) ? 0 : i_index + 1;
+    }
+
+    static void backoff(int i_spin) {
+        if(i_spin < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+};
+
+} /* namespace VBGE */
+#endif /* UTILS_BOUNDEDQUEUE_HPP_ */
@@ -0,0 +1,31 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_InferencePrecision.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_INFERENCEPRECISION_HPP_
+#define UTILS_INFERENCEPRECISION_HPP_
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+//! @brief Arithmetic used by the forward of a network
+enum class InferencePrecision {
+    //! @brief Float32 weights and activations, on any device
+    FP32,
+    //! @brief bfloat16 weights and activations, converted from the FP32 model at load time. Falls back to FP32
+    //!        on CPUs without native bfloat16 (AVX512-BF16 or AMX), checked at runtime
+    BF16,
+    //! @brief Post-training quantized model (fbgemm), CPU only. Loaded from a separate artifact produced by
+    //!        tools/quantize_model.py : int8 weights, 4x smaller, and int8 convolutions
+    INT8
+};
+
+} /* namespace VBGE */
+#endif /* UTILS_INFERENCEPRECISION_HPP_ */
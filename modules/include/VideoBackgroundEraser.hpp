@@ -17,6 +17,9 @@
 #include <torch/script.h>
 
 #include "VideoBackgroundEraser_Settings.hpp"
+#include "VideoBackgroundEraser_Frame.hpp"
+#include "VideoBackgroundEraser_Statistics.hpp"
+#include "VideoBackgroundEraser_Scheduler.hpp"
 
 /*============================================================================*/
 /* define                                                                     */
@@ -49,10 +52,72 @@ public:
 
 
     VideoBackgroundEraser(const VideoBackgroundEraser_Settings& i_settings);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor of a stream sharing its inference with other streams
+     * @param[in] 		i_settings  : user settings. The settings of the networks are the ones of i_scheduler
+     * @param[in] 		i_scheduler : Scheduler batching the DeepLabV3 and DeepImageMatting requests of its streams.
+     *                                Temporal state and buffers stay in each stream
+     *
+     */
+    /*============================================================================*/
+    VideoBackgroundEraser(const VideoBackgroundEraser_Settings& i_settings, const std::shared_ptr<VideoBackgroundEraser_Scheduler>& i_scheduler);
     virtual ~VideoBackgroundEraser();
 
     bool get_isInitialized();
 
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Statistics of the pooled allocator, see VideoBackgroundEraser_Settings::enable_pooledAllocator
+     * @return 		(AllocatorStatistics) : Allocations since the start of the process and during the last frame, for the whole
+     *                                          process : the same for every instance
+     *
+     */
+    /*============================================================================*/
+    AllocatorStatistics get_allocatorStatistics();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Number of frames segmented by DeepLabV3 or propagated from the previous frame,
+     *                  see VideoBackgroundEraser_Settings::keyframe_interval
+     * @return 		(FrameCounters) : Counters since the creation of the instance
+     *
+     */
+    /*============================================================================*/
+    FrameCounters get_frameCounters();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Frames where a scene cut was detected since the previous call,
+     *                  see VideoBackgroundEraser_Settings::enable_sceneCutDetection
+     * @param[out]		o_indexes : Frame indexes, in order. With run() and run_batch(), frames are counted from 0
+     *
+     */
+    /*============================================================================*/
+    void get_sceneCuts(std::vector<int64_t>& o_indexes);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Latency percentiles of each stage, frames processed, allocations, and fraction of the trimaps in
+     *                  the unknown band, since the creation of the instance. Can be called from any thread.
+     *                  See also VideoBackgroundEraser_Settings::statistics_dumpPath for periodic dumps
+     * @return 		(Statistics) : Statistics, Statistics::to_string() serializes them to JSON or Prometheus text
+     *
+     */
+    /*============================================================================*/
+    Statistics get_statistics();
+
     /*============================================================================*/
     /* Function Description                                                       */
     /*============================================================================*/
@@ -65,6 +130,38 @@ public:
     /*============================================================================*/
     int run(const cv::Mat& i_image, cv::Mat& o_image_withoutBackground);
 
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Process successive frames at once, each network runs a single forward for the whole batch.
+     *                  Trades latency for throughput. Temporal management still sees the frames in order.
+     * @param[in] 		i_images                   : Input images, in temporal order, all of the same size and type
+     * @param[out]		o_images_withoutBackground : Output images, same order as i_images
+     *
+     */
+    /*============================================================================*/
+    int run_batch(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& o_images_withoutBackground);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	The three stages of run(), exposed to be executed in a pipeline
+     *                  run_segmentation : DeepLabV3 and background mask
+     *                  run_trimap       : temporal management and trimap
+     *                  run_matting      : Deep Image Matting and output image
+     * @param[in,out]	io_frame : Frame, image must be set before run_segmentation().
+     *                             image_withoutBackground is available after run_matting()
+     *
+     * @note            Two different stages may run concurrently on two different frames,
+     *                  but each stage must be called in frame order, from one thread at a time.
+     */
+    /*============================================================================*/
+    int run_segmentation(VideoBackgroundEraser_Frame& io_frame);
+    int run_trimap(VideoBackgroundEraser_Frame& io_frame);
+    int run_matting(VideoBackgroundEraser_Frame& io_frame);
+
 
 };
 
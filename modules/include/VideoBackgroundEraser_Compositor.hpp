@@ -0,0 +1,148 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Compositor.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_COMPOSITOR_HPP_
+#define VIDEOBACKGROUNDERASER_COMPOSITOR_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Blend the output of VideoBackgroundEraser over a new background
+ *
+ *              The background is an image, a solid color or the frames of a second video.
+ *              It is resized and converted once to the size and depth of the frames, then
+ *              each call to run() only blends : SIMD integer arithmetic for CV_8U frames,
+ *              rows processed in parallel.
+ */
+/*============================================================================*/
+class VideoBackgroundEraser_Compositor {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor
+     * @param[in] 		i_isBGR : True if the frames are BGRA (see VideoBackgroundEraser_Settings::input_isBGR).
+     *                            Only used to convert the frames of a background video, which are read as BGR
+     *
+     */
+    /*============================================================================*/
+    VideoBackgroundEraser_Compositor(bool i_isBGR = false);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Destructor
+     *
+     */
+    /*============================================================================*/
+    ~VideoBackgroundEraser_Compositor();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Use an image as background
+     * @param[in] 		i_background    : Background, 3 channels in the same order as the frames, CV_8U, CV_16U or CV_32F (0-1).
+     *                                    Resized to the size of the frames
+     * @param[in] 		i_interpolation : Interpolation used to resize the background
+     *
+     */
+    /*============================================================================*/
+    int set_background(const cv::Mat& i_background, int i_interpolation = cv::INTER_LINEAR);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Use a solid color as background
+     * @param[in] 		i_color : Color, 3 channels in the same order as the frames, 0-255
+     *
+     */
+    /*============================================================================*/
+    int set_background(const cv::Scalar& i_color);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Use the frames of a video as background, one frame for each call to run(). The video loops
+     * @param[in] 		i_videoPath : Path of the video, or anything cv::VideoCapture can open
+     *
+     */
+    /*============================================================================*/
+    int set_background(const std::string& i_videoPath);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Blend a frame over the background
+     * @param[in] 		i_image_withoutBackground : Output of VideoBackgroundEraser, 4 channels, CV_8U, CV_16U or CV_32F
+     * @param[out]		o_composite               : Composite, 3 channels, same size and depth as i_image_withoutBackground.
+     *                                              Its buffer is reused when it already has the right size and type
+     *
+     */
+    /*============================================================================*/
+    int run(const cv::Mat& i_image_withoutBackground, cv::Mat& o_composite);
+
+private:
+    enum class BackgroundType {
+        None,
+        Image,
+        Color,
+        Video
+    };
+
+    // Settings
+    bool m_isBGR = false;
+
+    // Members
+    BackgroundType m_backgroundType = BackgroundType::None;
+    // Background as given by the user, or last frame of the background video
+    cv::Mat m_background;
+    int m_interpolation = cv::INTER_LINEAR;
+    cv::Scalar m_color;
+    cv::VideoCapture m_backgroundVideo;
+    // Background at the size and depth of the frames, a single row for a solid color
+    cv::Mat m_background_prepared;
+    cv::Mat m_background_resized;
+    cv::Size m_preparedSize;
+    int m_preparedDepth = -1;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Prepare m_background_prepared for frames of this size and depth. Reads the next frame of a background video
+     * @param[in] 		i_size  : Size of the frames
+     * @param[in] 		i_depth : Depth of the frames
+     *
+     */
+    /*============================================================================*/
+    int prepare_background(const cv::Size& i_size, int i_depth);
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_COMPOSITOR_HPP_ */
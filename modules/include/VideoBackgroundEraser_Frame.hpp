@@ -0,0 +1,81 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Frame.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_FRAME_HPP_
+#define VIDEOBACKGROUNDERASER_FRAME_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <chrono>
+
+#include <opencv2/opencv.hpp>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Data of one frame travelling through the stages of VideoBackgroundEraser
+ *
+ *              An instance can be reused for successive frames : its buffers are kept
+ *              and only reallocated when the resolution changes.
+ */
+/*============================================================================*/
+class VideoBackgroundEraser_Frame {
+public:
+    //! @brief Index of the frame in the input stream
+    int64_t index = -1;
+
+    //! @brief Presentation time of the frame in the input, in milliseconds, -1 if unknown. Only carried to the sinks
+    double timestamp_ms = -1.;
+
+    //! @brief Time the segmentation stage started on the frame, for the end-to-end latency ("total" stage)
+    std::chrono::steady_clock::time_point segmentationStart;
+
+    //! @brief Input image, RGB (or BGR, see VideoBackgroundEraser_Settings::input_isBGR) packed, CV_8UC3, CV_16UC3 or CV_32FC3
+    cv::Mat image;
+
+    //! @brief Output image, RGBA (or BGRA) packed, same size and depth as image
+    cv::Mat image_withoutBackground;
+
+    //! @brief Input image with a depth handled by the networks, CV_8UC3 or CV_32FC3. Shares image data when possible.
+    //!        Filled by the segmentation stage
+    cv::Mat imageNetwork;
+
+    //! @brief Buffer of imageNetwork when image has to be converted, kept between frames
+    cv::Mat imageNetwork_buffer;
+
+    //! @brief True when the image matches the previous one (see VideoBackgroundEraser_Settings::enable_duplicateDetection).
+    //!        Filled by the segmentation stage, the matting stage then reuses the previous alpha
+    bool isDuplicate = false;
+
+    //! @brief True when the image starts a new shot (see VideoBackgroundEraser_Settings::enable_sceneCutDetection).
+    //!        Filled by the segmentation stage, the trimap stage then drops its temporal state
+    bool isSceneCut = false;
+
+    //! @brief Mask, CV_8UC1, 255 for background pixels, filled by the segmentation stage
+    cv::Mat backgroundMask;
+
+    //! @brief Mask, CV_8UC1, 255 for foreground pixels, filled by the trimap stage
+    cv::Mat foregroundMask;
+
+    //! @brief Trimap, CV_8UC1, 255 for foreground, 128 for uncertain areas, 0 for background, filled by the trimap stage
+    cv::Mat trimap;
+
+    //! @brief Trimap at the resolution of Deep Image Matting (see VideoBackgroundEraser_Settings::imageMatting_scale)
+    cv::Mat trimap_down;
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_FRAME_HPP_ */
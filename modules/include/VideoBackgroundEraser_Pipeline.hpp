@@ -0,0 +1,118 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Pipeline.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_PIPELINE_HPP_
+#define VIDEOBACKGROUNDERASER_PIPELINE_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Utils_BoundedQueue.hpp"
+#include "VideoBackgroundEraser.hpp"
+#include "VideoBackgroundEraser_Frame.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Pipelined execution of VideoBackgroundEraser
+ *
+ *              Each stage runs in its own thread, stages are joined by bounded lock-free queues :
+ *              decode -> segmentation -> trimap -> matting -> encode
+ *              While frame N is in Deep Image Matting, frame N+1 can be in DeepLabV3.
+ *              Frames go through every stage in order, so the encode stage receives them in order.
+ */
+/*============================================================================*/
+class VideoBackgroundEraser_Pipeline {
+public:
+    typedef std::unique_ptr<VideoBackgroundEraser_Frame> FramePtr;
+
+    //! @brief Decode stage. Fills o_frame.image. Returns 0 if a frame was read, 1 at the end of the stream, negative on error
+    typedef std::function<int(VideoBackgroundEraser_Frame& o_frame)> SourceFunction;
+
+    //! @brief Encode stage. Consumes io_frame.image_withoutBackground. Returns 0 to continue, 1 to stop, negative on error
+    typedef std::function<int(VideoBackgroundEraser_Frame& io_frame)> SinkFunction;
+
+    //! @brief Occupancy of a queue between two stages. A queue often full means its consumer is the slowest stage
+    struct QueueStatistics {
+        std::string name;
+        size_t      capacity;
+        size_t      size;
+        double      meanOccupancy;
+        uint64_t    nbPushBlocked;
+        uint64_t    nbPopStarved;
+    };
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor
+     * @param[in] 		io_vbge          : initialized instance running the stages, must outlive the pipeline
+     * @param[in] 		i_queueCapacity  : number of frames each queue can hold
+     *
+     */
+    /*============================================================================*/
+    VideoBackgroundEraser_Pipeline(VideoBackgroundEraser& io_vbge, size_t i_queueCapacity = 2);
+
+    ~VideoBackgroundEraser_Pipeline();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run the pipeline until the end of the stream, an error or a stop request
+     * @param[in] 		i_source : decode stage, called from a dedicated thread
+     * @param[in] 		i_sink   : encode stage, called from the calling thread (allows display with highgui)
+     * @return 		(int)    : 0 on success, negative if a stage failed
+     *
+     */
+    /*============================================================================*/
+    int run(const SourceFunction& i_source, const SinkFunction& i_sink);
+
+    //! @brief Request all stages to stop, can be called from any thread
+    void stop();
+
+    //! @brief Occupancy of the queues, can be called from any thread while running
+    std::vector<QueueStatistics> get_queueStatistics() const;
+
+private:
+    typedef int (VideoBackgroundEraser::*StageFunction)(VideoBackgroundEraser_Frame&);
+
+    // Members
+    VideoBackgroundEraser& m_vbge;
+    std::atomic<bool> m_abort{false};
+    std::atomic<int> m_result{0};
+
+    // Queues between stages
+    BoundedQueue<FramePtr> m_decodedQueue;
+    BoundedQueue<FramePtr> m_segmentedQueue;
+    BoundedQueue<FramePtr> m_trimappedQueue;
+    BoundedQueue<FramePtr> m_mattedQueue;
+    // Frames given back by the encode stage to the decode stage, to reuse their buffers
+    BoundedQueue<FramePtr> m_recycledQueue;
+
+    void decode_loop(const SourceFunction& i_source);
+    void stage_loop(BoundedQueue<FramePtr>& io_input, BoundedQueue<FramePtr>& io_output, StageFunction i_stage, const char* i_stageName);
+    void set_error();
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_PIPELINE_HPP_ */
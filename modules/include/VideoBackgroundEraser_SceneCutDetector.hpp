@@ -0,0 +1,100 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_SceneCutDetector.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_SCENECUTDETECTOR_HPP_
+#define VIDEOBACKGROUNDERASER_SCENECUTDETECTOR_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <opencv2/opencv.hpp>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Detect shot boundaries in a sequence of frames
+ *
+ *              Each frame is reduced to a color histogram of a small thumbnail, and a cut is
+ *              detected when the Bhattacharyya distance to the histogram of the previous frame
+ *              exceeds a threshold. Used by VideoBackgroundEraser to reset its temporal state,
+ *              it can also run on its own, for instance to split a long video into shots
+ *              processed in parallel.
+ */
+/*============================================================================*/
+class VideoBackgroundEraser_SceneCutDetector {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor
+     * @param[in] 		i_threshold      : Histogram distance above which two frames belong to different shots, in [0, 1]
+     * @param[in] 		i_thumbnailWidth : Width of the thumbnail the histogram is computed on, the height keeps the aspect ratio
+     *
+     */
+    /*============================================================================*/
+    VideoBackgroundEraser_SceneCutDetector(float i_threshold = 0.5f, int i_thumbnailWidth = 128);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Destructor
+     *
+     */
+    /*============================================================================*/
+    ~VideoBackgroundEraser_SceneCutDetector();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Compare a frame with the previous one
+     * @param[in] 		i_image    : Frame, 3 channels, CV_8U, CV_16U or CV_32F (0-1)
+     * @param[out]		o_isCut    : True when the frame starts a new shot. Never true for the first frame,
+     *                               or the first one after a resolution change
+     * @param[out]		o_distance : Optional, histogram distance to the previous frame, in [0, 1]
+     *
+     */
+    /*============================================================================*/
+    int run(const cv::Mat& i_image, bool& o_isCut, double* o_distance = nullptr);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Forget the previous frame, the next one is never a cut
+     *
+     */
+    /*============================================================================*/
+    void reset();
+
+private:
+    // Settings
+    float m_threshold = 0.5f;
+    int m_thumbnailWidth = 128;
+
+    // Members
+    cv::Mat m_thumbnail;
+    cv::Mat m_thumbnail_uint8;
+    // Histograms of the current and previous frames, swapped after each frame
+    cv::Mat m_histogram;
+    cv::Mat m_histogram_prev;
+    cv::Size m_size_prev;
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_SCENECUTDETECTOR_HPP_ */
@@ -0,0 +1,137 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Scheduler.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_SCHEDULER_HPP_
+#define VIDEOBACKGROUNDERASER_SCHEDULER_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "VideoBackgroundEraser_Scheduler_Settings.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Forward Declaration                                                        */
+/*============================================================================*/
+class VideoBackgroundEraser_Scheduler_Algo;
+
+//! @brief Batches run by the scheduler, for each network
+class SchedulerStatistics {
+public:
+    //! @brief Number of batched forwards of DeepLabV3, and of images in them
+    uint64_t nbBatches_deeplabv3 = 0;
+    uint64_t nbImages_deeplabv3 = 0;
+
+    //! @brief Number of batched forwards of DeepImageMatting, and of images in them
+    uint64_t nbBatches_deepimagematting = 0;
+    uint64_t nbImages_deepimagematting = 0;
+};
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Inference shared by several streams, with dynamic batching across them
+ *
+ *              Each VideoBackgroundEraser created with a scheduler sends its DeepLabV3 and
+ *              DeepImageMatting requests here instead of running its own forwards. The requests
+ *              pending within VideoBackgroundEraser_Scheduler_Settings::maxDelay_us are run as one
+ *              batched forward, and the results go back to the calling stream, which waits for them.
+ *              Requests of higher priority are served first. Only the images of the same size,
+ *              type and channel order are batched together.
+ *              All methods can be called from any thread.
+ */
+/*============================================================================*/
+class VideoBackgroundEraser_Scheduler {
+private:
+    std::unique_ptr<VideoBackgroundEraser_Scheduler_Algo> m_algo;
+
+public:
+
+    VideoBackgroundEraser_Scheduler(const VideoBackgroundEraser_Scheduler_Settings& i_settings);
+    virtual ~VideoBackgroundEraser_Scheduler();
+
+    bool get_isInitialized();
+
+    //! @brief Settings of the scheduler
+    const VideoBackgroundEraser_Scheduler_Settings& get_settings();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run DeepLabV3 segmentation on images, batched with the requests of the other streams
+     * @param[in] 		i_images         : Input images, RGB or BGR packed, CV_8UC3 (0-255) or CV_32FC3 (0-1), all of the same size
+     * @param[in,out]	io_segmentations : Output segmentations, classes id in int32. Buffers already there are reused
+     * @param[in] 		i_isBGR          : True if the images are BGR
+     * @param[in] 		i_priority       : Requests of higher priority are served first
+     * @return 		(int) : 0 on success, -1 on error
+     *
+     */
+    /*============================================================================*/
+    int run_segmentation(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& io_segmentations,
+                         bool i_isBGR = false, int i_priority = 0);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run DeepLabV3 on images and reduce the scores to background masks, batched with the requests of the other streams
+     * @param[in] 		i_images           : Input images, RGB or BGR packed, CV_8UC3 (0-255) or CV_32FC3 (0-1), all of the same size
+     * @param[in,out]	io_backgroundMasks : Output masks, CV_8UC1, 255 for background pixels. Buffers already there are reused
+     * @param[in] 		i_isBGR            : True if the images are BGR
+     * @param[in] 		i_priority         : Requests of higher priority are served first
+     * @return 		(int) : 0 on success, -1 on error
+     *
+     */
+    /*============================================================================*/
+    int run_backgroundMask(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& io_backgroundMasks,
+                           bool i_isBGR = false, int i_priority = 0);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run DeepImageMatting on images and their trimaps, batched with the requests of the other streams
+     * @param[in] 		i_images             : Input images, RGB or BGR packed, CV_8UC3 (0-255) or CV_32FC3 (0-1), all of the same size
+     * @param[in] 		i_trimaps            : Input trimaps, CV_8UC1, one per image
+     * @param[in,out]	io_alpha_predictions : Output alphas, CV_32FC1. Buffers already there are reused
+     * @param[in] 		i_isBGR              : True if the images are BGR
+     * @param[in] 		i_priority           : Requests of higher priority are served first
+     * @return 		(int) : 0 on success, -1 on error
+     *
+     */
+    /*============================================================================*/
+    int run_matting(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                    std::vector<cv::Mat>& io_alpha_predictions, bool i_isBGR = false, int i_priority = 0);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Number of batches run since the creation of the scheduler
+     * @return 		(SchedulerStatistics) : Batches and images of each network
+     *
+     */
+    /*============================================================================*/
+    SchedulerStatistics get_statistics();
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_SCHEDULER_HPP_ */
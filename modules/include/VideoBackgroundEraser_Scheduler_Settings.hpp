@@ -0,0 +1,40 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Scheduler_Settings.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_SCHEDULER_SETTINGS_HPP_
+#define VIDEOBACKGROUNDERASER_SCHEDULER_SETTINGS_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include "DeepLabV3_Inference_Settings.hpp"
+#include "DeepImageMatting_Inference_Settings.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+class VideoBackgroundEraser_Scheduler_Settings {
+public:
+    //! @brief Settings class for the inference encapsulation of DeepLabV3, shared by every stream
+    DeepLabV3_Inference_Settings deeplabv3_inference;
+
+    //! @brief Settings class for the inference encapsulation of DeepImageMatting, shared by every stream
+    DeepImageMatting_Inference_Settings deepimagematting_inference;
+
+    //! @brief Maximum number of images in a batched forward. A single request with more images runs alone
+    int maxBatchSize = 8;
+
+    //! @brief Maximum time, in microseconds, a request waits for requests of other streams before its batch runs
+    int maxDelay_us = 5000;
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_SCHEDULER_SETTINGS_HPP_ */
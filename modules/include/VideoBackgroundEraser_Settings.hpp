@@ -17,6 +17,7 @@
 
 #include "DeepLabV3_Inference_Settings.hpp"
 #include "DeepImageMatting_Inference_Settings.hpp"
+#include "VideoBackgroundEraser_Statistics.hpp"
 
 /*============================================================================*/
 /* namespace                                                                  */
@@ -34,8 +35,129 @@ public:
     //! @brief "Enable temporal management of scene to improve accuracy between frames. Might not work well for video where the background is moving
     bool enable_temporalManagement = false;
 
+    //! @brief Temporal management : a pixel is confirmed as foreground when it was detected more than temporal_P times
+    //!        in the last temporal_Q frames
+    int temporal_P = 2;
+
+    //! @brief Temporal management : number of frames of the detection history, at most 8
+    int temporal_Q = 3;
+
+    //! @brief Temporal management : rescale factor of the optical flow and of the temporal state, in ]0, 1].
+    //!        Only the final foreground mask is upscaled to the input resolution
+    float temporal_scale = 1.f;
+
+    //! @brief Temporal management : preset of cv::DISOpticalFlow, PRESET_ULTRAFAST, PRESET_FAST or PRESET_MEDIUM
+    int opticalFlow_preset = cv::DISOpticalFlow::PRESET_MEDIUM;
+
+    //! @brief Keyframe mode : DeepLabV3 runs every keyframe_interval frames, the background mask of the frames in between
+    //!        is warped from the previous frame with the optical flow. 1 runs DeepLabV3 on every frame
+    int keyframe_interval = 1;
+
+    //! @brief Keyframe mode : rescale factor of the optical flow and of the propagated mask
+    float keyframe_scale = 0.5f;
+
+    //! @brief Keyframe mode : a keyframe is forced when the mean flow (L1 norm, in pixels at the input resolution) exceeds this value
+    float keyframe_maxMeanFlow = 4.f;
+
+    //! @brief Keyframe mode : a keyframe is forced when the mean difference between the frame and the previous one
+    //!        warped by the flow exceeds this value, in [0, 1]
+    float keyframe_maxResidual = 0.05f;
+
+    //! @brief Keyframe mode : a keyframe is forced when the background area changed by more than this ratio of
+    //!        the frame area since the last keyframe
+    float keyframe_maxAreaChange = 0.02f;
+
+    //! @brief Frames nearly identical to the previous one (frozen frames, pulldown, padding) reuse its alpha
+    //!        instead of running the networks
+    bool enable_duplicateDetection = false;
+
+    //! @brief Duplicate detection : maximum mean absolute difference between the thumbnails of two frames, in 8-bit levels
+    float duplicate_maxDifference = 1.f;
+
+    //! @brief Duplicate detection : width of the compared thumbnails, the height keeps the aspect ratio
+    int duplicate_thumbnailWidth = 64;
+
+    //! @brief Detect shot boundaries : the temporal state is dropped on a cut instead of being warped across it,
+    //!        and a keyframe is forced in keyframe mode
+    bool enable_sceneCutDetection = false;
+
+    //! @brief Scene cut detection : color histogram distance between two frames above which they belong to different shots, in [0, 1]
+    float sceneCut_threshold = 0.5f;
+
+    //! @brief Path of a file where the statistics (see VideoBackgroundEraser::get_statistics()) are written periodically,
+    //!        replaced at each dump. Empty to disable
+    std::string statistics_dumpPath = "";
+
+    //! @brief Format of the statistics file
+    StatisticsFormat statistics_dumpFormat = StatisticsFormat::JSON;
+
+    //! @brief Statistics are written every statistics_dumpInterval frames
+    int statistics_dumpInterval = 100;
+
     //! @brief Rescale factor for Deep Image Matting
     float imageMatting_scale = 1.f;
+
+    //! @brief Input images are BGR packed (OpenCV default) instead of RGB. Output images are then BGRA instead of RGBA
+    bool input_isBGR = false;
+
+    //! @brief Install a pooled allocator as default allocator of cv::Mat, for the whole process.
+    //!        Released buffers are kept and reused by later allocations of the same size instead of going back to the system
+    bool enable_pooledAllocator = false;
+
+    //! @brief DeepLabV3 reduces its scores to the background mask on the inference device, instead of returning
+    //!        the class of each pixel which is then compared to each background id. Same mask, less memory traffic
+    bool enable_fusedBackgroundMask = true;
+
+    //! @brief Run Deep Image Matting only on crops around the unknown areas of the trimap, batched in a single forward,
+    //!        instead of the whole frame. Frames without unknown area never run Deep Image Matting, whatever this setting
+    bool enable_roiMatting = false;
+
+    //! @brief Context added around each unknown area in roi mode, in pixels at the resolution of Deep Image Matting
+    int roiMatting_padding = 32;
+
+    //! @brief In roi mode, a frame is processed whole when its crops cover more than this ratio of its area
+    float roiMatting_maxAreaRatio = 0.5f;
+
+    //! @brief Priority of this stream in the scheduler it was created with (see VideoBackgroundEraser_Scheduler).
+    //!        Its requests are served before the ones of streams of lower priority
+    int scheduler_priority = 0;
+
+    //! @brief Expected size of the input images. When set, the networks run warmup_nbIterations times at the
+    //!        resolutions of this size in the constructor, so the first frames do not pay for the JIT profiling
+    cv::Size warmup_size = cv::Size(0, 0);
+
+    //! @brief Number of forwards of each network during the warmup
+    int warmup_nbIterations = 3;
+
+    //! @brief Threading : number of cores shared by the torch intra-op threads, the torch inter-op threads and the
+    //!        OpenCV pool. 0 keeps the defaults of the libraries, which each size their pool to every core.
+    //!        The torch and OpenMP thread counts are process-wide : streams of a same process should use the same budget
+    int threads_budget = 0;
+
+    //! @brief Threading : share of the budget given to the OpenCV pool (optical flow, morphology, resizes), in [0, 1[.
+    //!        At least one core
+    float threads_openCVRatio = 0.25f;
+
+    //! @brief Threading : number of torch inter-op threads, which run the independent branches of a graph.
+    //!        They run on the torch cores. Set once per process, before the first forward. 0 keeps the default
+    int threads_torchInterOp = 1;
+
+    //! @brief Threading : pin each partition to its own cores, from threads_firstCore. Linux only.
+    //!        The thread building the instance, which runs the warmup, is pinned to the torch cores
+    bool enable_threadPinning = false;
+
+    //! @brief Threading : first core of the budget when the threads are pinned
+    int threads_firstCore = 0;
+
+    //! @brief Threading : DeepLabV3 and Deep Image Matting get separate partitions of the torch cores, so that with
+    //!        VideoBackgroundEraser_Pipeline one frame is segmented while the previous one is matted, instead of
+    //!        both networks competing for every core. Only with the OpenMP backend of libtorch : its native pool is
+    //!        sized for the whole process, and both networks then share the torch cores. run() and run_batch() run the
+    //!        networks one after the other on every torch core
+    bool enable_concurrentNetworks = false;
+
+    //! @brief Threading : share of the torch cores given to DeepLabV3 with concurrent networks, in ]0, 1[
+    float threads_segmentationRatio = 0.5f;
 };
 
 } /* namespace VBGE */
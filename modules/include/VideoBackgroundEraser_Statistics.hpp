@@ -0,0 +1,160 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Statistics.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_STATISTICS_HPP_
+#define VIDEOBACKGROUNDERASER_STATISTICS_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+//! @brief Statistics of the pooled cv::Mat allocator (see VideoBackgroundEraser_Settings::enable_pooledAllocator).
+//!        The allocator serves every cv::Mat of the process, whatever the thread : the counters are process-wide.
+//!        With several VideoBackgroundEraser instances, each one reports the allocations of all of them, and
+//!        "the last frame" spans from the previous frame completed by any instance
+class AllocatorStatistics {
+public:
+    //! @brief Number of buffers allocated, from the pool or from the system
+    uint64_t nbAllocations = 0;
+
+    //! @brief Number of bytes allocated, from the pool or from the system
+    uint64_t nbBytes = 0;
+
+    //! @brief Number of buffers which could not be served by the pool and were allocated from the system
+    uint64_t nbSystemAllocations = 0;
+
+    //! @brief Number of buffers allocated during the last frame
+    uint64_t nbAllocations_lastFrame = 0;
+
+    //! @brief Number of bytes allocated during the last frame
+    uint64_t nbBytes_lastFrame = 0;
+
+    //! @brief Number of bytes currently kept in the pool
+    size_t   cachedBytes = 0;
+};
+
+//! @brief Number of frames processed by each path of the segmentation stage
+class FrameCounters {
+public:
+    //! @brief Frames segmented by DeepLabV3
+    uint64_t nbFrames_inferred = 0;
+
+    //! @brief Frames whose mask was propagated from the previous frame with the optical flow (keyframe mode)
+    uint64_t nbFrames_propagated = 0;
+
+    //! @brief Keyframes forced before the end of the interval, because a threshold was exceeded or at a scene cut
+    //!        (keyframe mode)
+    uint64_t nbKeyframes_forced = 0;
+
+    //! @brief Frames detected as duplicates of the previous one, which reused its output
+    uint64_t nbFrames_duplicate = 0;
+
+    //! @brief Scene cuts detected
+    uint64_t nbSceneCuts = 0;
+};
+
+//! @brief Format of the statistics files, see VideoBackgroundEraser_Settings::statistics_dumpPath
+enum class StatisticsFormat {
+    JSON,
+    Prometheus
+};
+
+//! @brief Latency of a stage of VideoBackgroundEraser. A batch counts as a single call, except for the "total" stage :
+//!        latency of each frame from the start of its segmentation to the end of its matting
+class StageStatistics {
+public:
+    //! @brief Name of the stage
+    std::string name;
+
+    //! @brief Number of calls
+    uint64_t nbCalls = 0;
+
+    //! @brief Mean latency, in milliseconds
+    double latency_mean_ms = 0.;
+
+    //! @brief Latency percentiles, in milliseconds, estimated within 5%
+    double latency_p50_ms = 0.;
+    double latency_p95_ms = 0.;
+    double latency_p99_ms = 0.;
+};
+
+//! @brief Thread partition of VideoBackgroundEraser, see VideoBackgroundEraser_Settings::threads_budget
+class PartitionStatistics {
+public:
+    //! @brief Name of the partition : "torch", or "segmentation" and "matting" with concurrent networks, and "opencv"
+    std::string name;
+
+    //! @brief First core and number of cores. firstCore is -1 when the threads are not pinned
+    int firstCore = -1;
+    int nbCores = 0;
+
+    //! @brief Number of threads of the partition
+    int nbThreads = 0;
+
+    //! @brief Fraction of the time since initialization spent in the networks of the partition, -1 for the OpenCV pool
+    double busyRatio = -1.;
+
+    //! @brief Fraction of the time its cores were busy since initialization, whatever the process. -1 when the threads are not pinned
+    double cpuUtilization = -1.;
+};
+
+//! @brief Statistics of a VideoBackgroundEraser instance since its creation, see VideoBackgroundEraser::get_statistics()
+class Statistics {
+public:
+    //! @brief Latency of each stage
+    std::vector<StageStatistics> stages;
+
+    //! @brief Frames which went through the whole pipeline
+    uint64_t nbFrames = 0;
+
+    //! @brief Frames processed by each path of the segmentation stage
+    FrameCounters frameCounters;
+
+    //! @brief Allocations of the pooled allocator, process-wide, all 0 when it is disabled
+    AllocatorStatistics allocator;
+
+    //! @brief Fraction of the trimap pixels in the unknown band, over all frames and for the last frame.
+    //!        Deep Image Matting time grows with it, in roi mode
+    double unknownRatio = 0.;
+    double unknownRatio_lastFrame = 0.;
+
+    //! @brief Time spent in the constructor (models loading, optimization and warmup), in milliseconds
+    double initialization_ms = 0.;
+
+    //! @brief Time from the start of the constructor to the end of the first frame, in milliseconds. 0 before the first frame.
+    //!        The steady-state latency is the one of the "total" stage
+    double timeToFirstFrame_ms = 0.;
+
+    //! @brief Thread partitions, empty when VideoBackgroundEraser_Settings::threads_budget is 0
+    std::vector<PartitionStatistics> partitions;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Serialize the statistics
+     * @param[in] 		i_format : JSON document, or Prometheus text exposition format (metrics prefixed with vbge_)
+     * @return 		(std::string) : Serialized statistics
+     *
+     */
+    /*============================================================================*/
+    std::string to_string(StatisticsFormat i_format) const;
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_STATISTICS_HPP_ */
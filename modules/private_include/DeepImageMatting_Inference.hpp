@@ -13,10 +13,13 @@
 /*============================================================================*/
 /* Includes                                                                   */
 /*============================================================================*/
+#include <memory>
+
 #include <opencv2/opencv.hpp>
 #include <torch/script.h>
 
 #include "DeepImageMatting_Inference_Settings.hpp"
+#include "Utils_ModelRegistry.hpp"
 
 /*============================================================================*/
 /* define                                                                     */
@@ -42,6 +45,18 @@ public:
     /*============================================================================*/
     DeepImageMatting_Inference(const DeepImageMatting_Inference_Settings& i_settings);
 
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Model loaded by an instance, see ModelRegistry
+     * @param[in] 		i_settings         : user settings
+     * @return 		(ModelRegistry::Request) : Request of the model given to ModelRegistry
+     *
+     */
+    /*============================================================================*/
+    static ModelRegistry::Request get_modelRequest(const DeepImageMatting_Inference_Settings& i_settings);
+
     /*============================================================================*/
     /* Function Description                                                       */
     /*============================================================================*/
@@ -68,22 +83,86 @@ public:
     /*============================================================================*/
     /**
      * @brief         	Perform inference of DeepImageMatting
-     * @param[in] 		i_image            : Input image, RGBA packed, 4-float32 (CV_32FC4)
+     * @param[in] 		i_image            : Input image, RGB packed, CV_8UC3 (0-255) or CV_32FC3 (0-1)
+     * @param[in] 		i_trimap           : Input trimap, CV_8UC1, same size as i_image
      * @param[out]		o_alpha_prediction : Output image, alpha component (float32 -> CV_32F), same size as i_image
+     * @param[in] 		i_isBGR            : True if i_image is BGR packed, channels are swapped during preprocessing
+     *
+     */
+    /*============================================================================*/
+    int run(const cv::Mat& i_image, const cv::Mat& i_trimap, cv::Mat& o_alpha_prediction, bool i_isBGR = false);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Perform inference of DeepImageMatting on a batch of images, with a single forward
+     * @param[in] 		i_images            : Input images, RGB packed, CV_8UC3 (0-255) or CV_32FC3 (0-1), all of the same size
+     * @param[in] 		i_trimaps           : Input trimaps, CV_8UC1, same size as i_images
+     * @param[out]		o_alpha_predictions : Output images, alpha component (float32 -> CV_32F), same size as i_images.
+     *                                        Buffers already allocated with the right size and type are reused
+     * @param[in] 		i_isBGR             : True if i_images are BGR packed, channels are swapped during preprocessing
      *
      */
     /*============================================================================*/
-    int run(const cv::Mat& i_image_rgba, cv::Mat& o_alpha_prediction);
+    int run(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+            std::vector<cv::Mat>& o_alpha_predictions, bool i_isBGR = false);
 
 private:
     // Misc
     bool m_isInitialized = false;
+    // Precision the network runs at, see get_supportedPrecision()
+    InferencePrecision m_precision = InferencePrecision::FP32;
 
     // Members
-    torch::jit::script::Module m_model;
+    // Shared with the other instances using the same model, see ModelRegistry
+    std::shared_ptr<torch::jit::script::Module> m_model;
+    // Input of the network, CPU, NCHW, RGB and trimap planes. Kept from one call to the next
+    torch::Tensor m_inputTensor;
+    // Tiled inference, kept from one call to the next
+    std::vector<cv::Rect> m_tiles;
+    std::vector<cv::Mat> m_tileAlphas;
+    // Feathering weights of a tile, indexed by the ramps along y and x (see run_tiled()), for this tile size and overlap
+    cv::Mat m_tileWeights[16];
+    cv::Size m_tileWeights_tileSize;
+    int m_tileWeights_overlap = -1;
+    cv::Mat m_alphaSum;
+    cv::Mat m_weightSum;
 
     // Settings
     const DeepImageMatting_Inference_Settings m_settings;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run the network on a batch of images, in a single forward. Same parameters as run()
+     *
+     */
+    /*============================================================================*/
+    int forward(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                std::vector<cv::Mat>& o_alpha_predictions, bool i_isBGR);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run the network on overlapping tiles of an image, tiles are blended with feathered weights
+     * @param[in] 		i_image            : Input image, see run()
+     * @param[in] 		i_trimap           : Input trimap, see run()
+     * @param[out]		o_alpha_prediction : Output image, see run()
+     * @param[in] 		i_isBGR            : True if i_image is BGR packed
+     * @param[in] 		i_tileSize         : Side of the square tiles, in pixels
+     *
+     */
+    /*============================================================================*/
+    int run_tiled(const cv::Mat& i_image, const cv::Mat& i_trimap, cv::Mat& o_alpha_prediction, bool i_isBGR, int i_tileSize);
+
+    //! @brief Side of the tiles for images of this size (see tile_size and maxMemory_bytes), 0 if the image is not tiled
+    int get_tileSize(const cv::Size& i_imageSize);
+
+    //! @brief Number of images of this size which fit in a single forward, according to maxMemory_bytes
+    size_t get_maxBatchSize(const cv::Size& i_imageSize);
 };
 
 } /* namespace VBGE */
@@ -13,10 +13,14 @@
 /*============================================================================*/
 /* Includes                                                                   */
 /*============================================================================*/
+#include <memory>
+
 #include <opencv2/opencv.hpp>
 #include <torch/script.h>
 
 #include "DeepLabV3_Inference_Settings.hpp"
+#include "Utils_ModelRegistry.hpp"
+#include "Utils_GuidedUpsampling.hpp"
 
 /*============================================================================*/
 /* define                                                                     */
@@ -42,6 +46,18 @@ public:
     /*============================================================================*/
     DeepLabV3_Inference(const DeepLabV3_Inference_Settings& i_settings);
 
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Model loaded by an instance, see ModelRegistry
+     * @param[in] 		i_settings         : user settings
+     * @return 		(ModelRegistry::Request) : Request of the model given to ModelRegistry
+     *
+     */
+    /*============================================================================*/
+    static ModelRegistry::Request get_modelRequest(const DeepLabV3_Inference_Settings& i_settings);
+
     /*============================================================================*/
     /* Function Description                                                       */
     /*============================================================================*/
@@ -69,22 +85,84 @@ public:
     /*============================================================================*/
     /**
      * @brief         	Perform inference of DeepLabV3
-     * @param[in] 		i_image        : Input image, RGB packed, 3-float32 (CV_32FC3)
+     * @param[in] 		i_image        : Input image, RGB packed, CV_8UC3 (0-255) or CV_32FC3 (0-1)
      * @param[out]		o_segmentation : Output image, classes id in int32, same size as i_image
+     * @param[in] 		i_isBGR        : True if i_image is BGR packed, channels are swapped during preprocessing
+     *
+     */
+    /*============================================================================*/
+    int run(const cv::Mat& i_image, cv::Mat& o_segmentation, bool i_isBGR = false);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Perform inference of DeepLabV3 on a batch of images, with a single forward
+     * @param[in] 		i_images        : Input images, RGB packed, CV_8UC3 (0-255) or CV_32FC3 (0-1), all of the same size
+     * @param[out]		o_segmentations : Output images, classes id in int32, same size as i_images.
+     *                                    Buffers already allocated with the right size and type are reused
+     * @param[in] 		i_isBGR         : True if i_images are BGR packed, channels are swapped during preprocessing
+     *
+     */
+    /*============================================================================*/
+    int run(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& o_segmentations, bool i_isBGR = false);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Perform inference of DeepLabV3 and directly reduce the scores to a background mask.
+     *                  A pixel is background when the best score of the background classes (see
+     *                  DeepLabV3_Inference_Settings::background_classId_vector) is above the best score of the
+     *                  other classes, which is the same as testing the class given by run() against each background id.
+     *                  A tie between both groups goes to the group of the lowest of the tied class ids, as with the
+     *                  argmax of run() : both give the same mask
+     *                  The reduction is done on the inference device, by chunks of rows to limit memory usage
+     * @param[in] 		i_images          : Input images, RGB packed, CV_8UC3 (0-255) or CV_32FC3 (0-1), all of the same size
+     * @param[out]		o_backgroundMasks : Output masks, CV_8UC1, 255 for background pixels, same size as i_images.
+     *                                      Buffers already allocated with the right size and type are reused
+     * @param[in] 		i_isBGR           : True if i_images are BGR packed, channels are swapped during preprocessing
      *
      */
     /*============================================================================*/
-    int run(const cv::Mat& i_image, cv::Mat& o_segmentation);
+    int run_backgroundMask(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& o_backgroundMasks, bool i_isBGR = false);
 
 private:
     // Misc
     bool m_isInitialized = false;
+    // Precision the network runs at, see get_supportedPrecision()
+    InferencePrecision m_precision = InferencePrecision::FP32;
 
     // Members
-    torch::jit::script::Module m_model;
+    // Shared with the other instances using the same model, see ModelRegistry
+    std::shared_ptr<torch::jit::script::Module> m_model;
+    // Input of the network, CPU, NCHW, normalized. Kept from one call to the next
+    torch::Tensor m_inputTensor;
+    // Ids of the background and foreground classes, on the inference device, for a model with m_nbClasses classes
+    torch::Tensor m_backgroundIds;
+    torch::Tensor m_foregroundIds;
+    int64_t m_nbClasses = 0;
+    // With a segmentation_scale below 1 : inputs (only for scales which are not 1/k) and outputs at the resolution of the network,
+    // and the upsampling of the masks
+    std::vector<cv::Mat> m_resizedImages;
+    std::vector<cv::Mat> m_resizedOutputs;
+    GuidedUpsampling m_guidedUpsampling;
 
     // Settings
     const DeepLabV3_Inference_Settings m_settings;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Check, rescale (see DeepLabV3_Inference_Settings::segmentation_scale) and preprocess the images, then run the network
+     * @param[in] 		i_images       : Input images, see run()
+     * @param[in] 		i_isBGR        : True if i_images are BGR packed
+     * @param[out]		o_outputTensor : Scores of each class, NCHW, on the inference device, at the resolution of the network
+     *
+     */
+    /*============================================================================*/
+    int forward(const std::vector<cv::Mat>& i_images, bool i_isBGR, torch::Tensor& o_outputTensor);
 };
 
 } /* namespace VBGE */
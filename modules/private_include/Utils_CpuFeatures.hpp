@@ -0,0 +1,44 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_CpuFeatures.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_CPUFEATURES_HPP_
+#define UTILS_CPUFEATURES_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <torch/script.h>
+
+#include "Utils_InferencePrecision.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+//! @brief True if the CPU runs bfloat16 natively (AVX512-BF16 or AMX-BF16) and the OS saves the state of their registers.
+//!        Checked once, at runtime : the same binary runs on older CPUs
+bool cpu_hasBFloat16();
+
+/*============================================================================*/
+/* Function Description                                                       */
+/*============================================================================*/
+/**
+ * @brief         	Precision a network really runs at. BF16 falls back to FP32 on CPUs without native bfloat16,
+ *                  where it would be emulated and slower than FP32. CUDA devices keep BF16
+ * @param[in] 		i_precision : Precision asked in the settings
+ * @param[in] 		i_device    : Inference device
+ * @return 		(InferencePrecision) : Precision to use
+ *
+ */
+/*============================================================================*/
+InferencePrecision get_supportedPrecision(InferencePrecision i_precision, torch::DeviceType i_device);
+
+} /* namespace VBGE */
+#endif /* UTILS_CPUFEATURES_HPP_ */
@@ -0,0 +1,76 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_GuidedUpsampling.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_GUIDEDUPSAMPLING_HPP_
+#define UTILS_GUIDEDUPSAMPLING_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <opencv2/opencv.hpp>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Edge-aware upsampling of a low resolution mask, guided by the full resolution image
+ *
+ *              Fast guided filter (He and Sun, 2015) : the local linear model mask = a * luma + b is
+ *              fitted at the resolution of the mask, its coefficients are upsampled bilinearly, then
+ *              applied to the full resolution luma. The edges of the mask snap to the edges of the
+ *              image instead of the blocks of a nearest or bilinear upsampling.
+ *              Intermediate buffers are kept from one call to the next.
+ */
+/*============================================================================*/
+class GuidedUpsampling {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Upsample a binary mask to the size of the guide image
+     * @param[in] 		i_image  : Guide image, packed, CV_8UC3 (0-255) or CV_32FC3 (0-1)
+     * @param[in] 		i_isBGR  : True if i_image is BGR packed
+     * @param[in] 		i_mask   : Low resolution mask, CV_8UC1, 0 or 255
+     * @param[in] 		i_radius : Radius of the box filters, in pixels of i_mask
+     * @param[in] 		i_eps    : Regularization, on the luma in [0, 1] : edges of contrast below sqrt(i_eps) are smoothed
+     * @param[out]		o_mask   : Output mask, CV_8UC1, 0 or 255, same size as i_image. Its buffer is reused
+     * @return 		(int) : 0 on success, -1 on error
+     *
+     */
+    /*============================================================================*/
+    int run(const cv::Mat& i_image, bool i_isBGR, const cv::Mat& i_mask, int i_radius, float i_eps, cv::Mat& o_mask);
+
+private:
+    // Luma at full resolution, same depth as the image
+    cv::Mat m_luma;
+    cv::Mat m_luma_resized;
+    // Low resolution planes, CV_32F
+    cv::Mat m_luma_low;
+    cv::Mat m_mask_low;
+    cv::Mat m_product;
+    cv::Mat m_mean_luma;
+    cv::Mat m_mean_mask;
+    cv::Mat m_corr_lumaMask;
+    cv::Mat m_corr_lumaLuma;
+    cv::Mat m_a;
+    cv::Mat m_b;
+    // Coefficients at full resolution, CV_32F
+    cv::Mat m_a_full;
+    cv::Mat m_b_full;
+};
+
+} /* namespace VBGE */
+#endif /* UTILS_GUIDEDUPSAMPLING_HPP_ */
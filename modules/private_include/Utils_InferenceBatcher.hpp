@@ -0,0 +1,140 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_InferenceBatcher.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_INFERENCEBATCHER_HPP_
+#define UTILS_INFERENCEBATCHER_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Gather the inference requests of several threads into batches
+ *
+ *              Callers block in run() while their request waits in the queue. A dedicated thread
+ *              picks the request of highest priority (the oldest one among equal priorities),
+ *              and runs it together with the compatible requests (same kind, size, type and
+ *              channel order) once they fill a batch, or once the oldest of them waited
+ *              for the maximum delay. Requests of the same caller are served in order, since
+ *              the caller waits for each of them.
+ */
+/*============================================================================*/
+class InferenceBatcher {
+public:
+    //! @brief Request of one caller : a few images of the same size and type, and their outputs
+    class Request {
+    public:
+        //! @brief Kind of inference, requests of different kinds are never batched together
+        int kind = 0;
+        //! @brief Requests of higher priority are served first
+        int priority = 0;
+        //! @brief True if the images are BGR
+        bool isBGR = false;
+        //! @brief Inputs, all of the same size and type
+        std::vector<cv::Mat> images;
+        //! @brief Optional second input, one per image
+        std::vector<cv::Mat> trimaps;
+        //! @brief Outputs, one per image. Buffers already there are reused
+        std::vector<cv::Mat> outputs;
+    };
+
+    //! @brief Run a batch of compatible requests, filling their outputs. Returns 0 on success, negative on error
+    typedef std::function<int(std::vector<Request*>& io_requests)> BatchFunction;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor, starts the batching thread
+     * @param[in] 		i_batchFunction : Function running a batch, called from the batching thread only
+     * @param[in] 		i_maxBatchSize  : Maximum number of images of a batch. A single request bigger than this runs alone
+     * @param[in] 		i_maxDelay      : Maximum time a request waits for other requests
+     *
+     */
+    /*============================================================================*/
+    InferenceBatcher(const BatchFunction& i_batchFunction, size_t i_maxBatchSize, std::chrono::microseconds i_maxDelay);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Destructor, waits for the pending requests then stops the batching thread
+     *
+     */
+    /*============================================================================*/
+    ~InferenceBatcher();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Queue a request and wait until its batch ran
+     * @param[in,out]	io_request : Request, its outputs are filled
+     * @return 		(int) : Result of the batch function
+     *
+     */
+    /*============================================================================*/
+    int run(Request& io_request);
+
+    //! @brief Number of batches run, and of images in them
+    uint64_t get_nbBatches() const;
+    uint64_t get_nbImages() const;
+
+private:
+    class Pending {
+    public:
+        Request* request = nullptr;
+        std::chrono::steady_clock::time_point enqueueTime;
+        uint64_t sequence = 0;
+        bool isDone = false;
+        int result = 0;
+    };
+
+    // Settings
+    BatchFunction m_batchFunction;
+    size_t m_maxBatchSize = 1;
+    std::chrono::microseconds m_maxDelay;
+
+    // Members
+    std::mutex m_mutex;
+    std::condition_variable m_pendingCondition;
+    std::condition_variable m_doneCondition;
+    std::list<Pending*> m_pending;
+    uint64_t m_sequence = 0;
+    bool m_stop = false;
+    std::atomic<uint64_t> m_nbBatches{0};
+    std::atomic<uint64_t> m_nbImages{0};
+    std::thread m_thread;
+
+    void batch_loop();
+
+    //! @brief True if both requests can run in the same batch
+    static bool is_compatible(const Request& i_a, const Request& i_b);
+};
+
+} /* namespace VBGE */
+#endif /* UTILS_INFERENCEBATCHER_HPP_ */
@@ -0,0 +1,128 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_LatencyHistogram.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_LATENCYHISTOGRAM_HPP_
+#define UTILS_LATENCYHISTOGRAM_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Histogram of latencies with logarithmic buckets, to estimate percentiles
+ *
+ *              8 buckets per power of 2 from 1 microsecond to about 2 minutes : percentiles are
+ *              known within 5%, and adding a sample is a few relaxed atomic increments, without
+ *              lock or allocation. Samples can be added and read from any thread.
+ */
+/*============================================================================*/
+class LatencyHistogram {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor, empty histogram
+     *
+     */
+    /*============================================================================*/
+    LatencyHistogram();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Add a sample
+     * @param[in] 		i_latency : Latency
+     *
+     */
+    /*============================================================================*/
+    void add(std::chrono::steady_clock::duration i_latency);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Number of samples
+     *
+     */
+    /*============================================================================*/
+    uint64_t get_count() const;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Mean of the samples, in milliseconds. 0 without samples
+     *
+     */
+    /*============================================================================*/
+    double get_mean_ms() const;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Estimate a percentile, in milliseconds. 0 without samples
+     * @param[in] 		i_percentile : Percentile, in [0, 1]
+     *
+     */
+    /*============================================================================*/
+    double get_percentile_ms(double i_percentile) const;
+
+private:
+    static constexpr int nbBucketsPerOctave = 8;
+    static constexpr int nbBuckets = nbBucketsPerOctave*27;
+
+    std::atomic<uint64_t> m_buckets[nbBuckets];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum_ns;
+};
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Add the time spent in a scope to a LatencyHistogram
+ *
+ */
+/*============================================================================*/
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& io_histogram)
+        : m_histogram(io_histogram),
+          m_start(std::chrono::steady_clock::now())
+    {
+
+    }
+
+    ~ScopedLatency()
+    {
+        m_histogram.add(std::chrono::steady_clock::now() - m_start);
+    }
+
+private:
+    LatencyHistogram& m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} /* namespace VBGE */
+#endif /* UTILS_LATENCYHISTOGRAM_HPP_ */
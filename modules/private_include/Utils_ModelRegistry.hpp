@@ -0,0 +1,149 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_ModelRegistry.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_MODELREGISTRY_HPP_
+#define UTILS_MODELREGISTRY_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <torch/script.h>
+#if defined(__has_include)
+#if __has_include(<torch/version.h>)
+#include <torch/version.h>
+#endif
+#endif
+
+/*============================================================================*/
+/* define                                                                     */
+/*============================================================================*/
+// torch::jit::freeze() and torch::jit::optimize_for_inference() are available from libtorch 1.10
+#if defined(TORCH_VERSION_MAJOR) && (TORCH_VERSION_MAJOR > 1 || TORCH_VERSION_MINOR >= 10)
+#define VBGE_HAS_OPTIMIZE_FOR_INFERENCE 1
+#else
+#define VBGE_HAS_OPTIMIZE_FOR_INFERENCE 0
+#endif
+
+// c10::InferenceMode is available from libtorch 1.9
+#if defined(TORCH_VERSION_MAJOR) && (TORCH_VERSION_MAJOR > 1 || TORCH_VERSION_MINOR >= 9)
+#define VBGE_HAS_INFERENCE_MODE 1
+#else
+#define VBGE_HAS_INFERENCE_MODE 0
+#endif
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+//! @brief RAII guard of the forwards : no gradients, and no version counters nor views tracking when available
+#if VBGE_HAS_INFERENCE_MODE
+typedef c10::InferenceMode InferenceGuard;
+#else
+typedef torch::NoGradGuard InferenceGuard;
+#endif
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Process-wide cache of TorchScript modules, keyed by path, device, dtype and optimization
+ *
+ *              Every instance asking for the same model gets the same module : N streams share
+ *              one copy of the weights instead of loading N. The registry only keeps weak
+ *              references, a model is unloaded when its last user is destroyed. Different models
+ *              load concurrently, the same model is loaded once even when asked from several threads.
+ *
+ *              Optimized models are frozen (parameters folded as constants, conv-BN folding) and
+ *              optimized for inference (oneDNN layouts on CPU). The frozen module can be saved in a
+ *              cache directory, keyed by the path, size and modification time of the source file,
+ *              so later startups skip freezing without reading the source.
+ *
+ *              Thread safety : a shared module is read-only. forward() can be called on it from
+ *              several threads at once, as long as no caller modifies it (no training, no
+ *              change of its parameters, attributes or device) and gradients are disabled
+ *              (InferenceGuard). Each call has its own interpreter frame and its own outputs.
+ *              Per-stream state (input tensors, temporal history, workspaces) stays in the callers.
+ */
+/*============================================================================*/
+class ModelRegistry {
+public:
+
+    //! @brief Model to load
+    class Request {
+    public:
+        //! @brief Path to a PyTorch JIT binary
+        std::string       path;
+        //! @brief Device of the parameters
+        torch::DeviceType device = torch::kCPU;
+        //! @brief Type of the floating point parameters
+        torch::ScalarType dtype = torch::kFloat32;
+        //! @brief Freeze the module and optimize it for inference. Ignored before libtorch 1.10
+        bool              optimize = false;
+        //! @brief Directory of the frozen modules, empty to disable the cache. Only used when optimize is true
+        std::string       cacheDirectory;
+        //! @brief The model is quantized : the fbgemm engine is selected before it loads
+        bool              isQuantized = false;
+    };
+
+    //! @brief Process-wide instance
+    static ModelRegistry& get_instance();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Get a model, loaded on the first request
+     * @param[in] 		i_request : Model to load
+     * @return 		(std::shared_ptr<torch::jit::script::Module>) : Shared module in eval mode, nullptr if it could not be loaded
+     *
+     */
+    /*============================================================================*/
+    std::shared_ptr<torch::jit::script::Module> get_model(const Request& i_request);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Get several models, loaded in parallel
+     * @param[in] 		i_requests : Models to load
+     * @return 		(std::vector<std::shared_ptr<torch::jit::script::Module>>) : One module per request, nullptr if it could not be loaded
+     *
+     */
+    /*============================================================================*/
+    std::vector<std::shared_ptr<torch::jit::script::Module>> get_models(const std::vector<Request>& i_requests);
+
+private:
+    ModelRegistry();
+
+    using Key = std::tuple<std::string, int, int, bool>;
+
+    // Each entry has its own lock, held while its model loads
+    class Entry {
+    public:
+        std::mutex mutex;
+        std::weak_ptr<torch::jit::script::Module> model;
+    };
+
+    std::mutex m_mutex;
+    std::map<Key, std::shared_ptr<Entry>> m_entries;
+
+    //! @brief Load a model from its file, or from the cache
+    static std::shared_ptr<torch::jit::script::Module> load(const Request& i_request);
+};
+
+} /* namespace VBGE */
+#endif /* UTILS_MODELREGISTRY_HPP_ */
@@ -0,0 +1,93 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_PoolAllocator.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_POOLALLOCATOR_HPP_
+#define UTILS_POOLALLOCATOR_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "VideoBackgroundEraser_Statistics.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       cv::MatAllocator keeping released buffers to serve later allocations of the same size
+ *
+ *              Video frames allocate the same sizes again and again : buffers are taken from
+ *              the pool instead of going back to the system, which removes allocator churn and
+ *              page faults on freshly mapped memory. Thread safe.
+ *              There is a single process-wide instance, installed with cv::Mat::setDefaultAllocator(),
+ *              which is never destroyed since Mat allocated by it may outlive any owner.
+ */
+/*============================================================================*/
+class PoolAllocator : public cv::MatAllocator {
+public:
+
+    //! @brief Process-wide instance
+    static PoolAllocator& get_instance();
+
+    //! @brief Install the pool as default allocator of cv::Mat. Can be called several times
+    static void install();
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const CV_OVERRIDE;
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const CV_OVERRIDE;
+    void deallocate(cv::UMatData* data) const CV_OVERRIDE;
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Mark the end of a frame : the allocations made since the previous mark
+     *                  become the statistics of the last frame
+     * @param[in] 		i_nbFrames : number of frames processed since the previous mark
+     *
+     */
+    /*============================================================================*/
+    void mark_frame(int i_nbFrames = 1);
+
+    AllocatorStatistics get_statistics() const;
+
+    //! @brief Maximum number of bytes kept in the pool, released buffers above this limit go back to the system
+    void set_maxCachedBytes(size_t i_maxCachedBytes);
+
+private:
+    PoolAllocator();
+
+    mutable std::mutex m_mutex;
+    mutable std::unordered_map<size_t, std::vector<uchar*>> m_pool;
+    mutable size_t m_cachedBytes = 0;
+    size_t m_maxCachedBytes = size_t(2) << 30;
+
+    // Statistics
+    mutable std::atomic<uint64_t> m_nbAllocations{0};
+    mutable std::atomic<uint64_t> m_nbBytes{0};
+    mutable std::atomic<uint64_t> m_nbSystemAllocations{0};
+    uint64_t m_nbAllocations_lastMark = 0;
+    uint64_t m_nbBytes_lastMark = 0;
+    uint64_t m_nbAllocations_lastFrame = 0;
+    uint64_t m_nbBytes_lastFrame = 0;
+};
+
+} /* namespace VBGE */
+#endif /* UTILS_POOLALLOCATOR_HPP_ */
@@ -0,0 +1,71 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_Preprocessing.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_PREPROCESSING_HPP_
+#define UTILS_PREPROCESSING_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <cstdint>
+#include <cstring>
+
+#include <opencv2/opencv.hpp>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Function Description                                                       */
+/*============================================================================*/
+/**
+ * @brief         	Convert a packed 3-channel image to normalized planar float, in a single pass.
+ *                  For each plane c : o_planes[c] = (i_image[channel c] * i_scale - i_mean[c]) / i_std[c]
+ *                  Vectorized with OpenCV universal intrinsics and parallelized over rows.
+ * @param[in] 		i_image  : Input image, packed, CV_8UC3 or CV_32FC3
+ * @param[in] 		i_swapRB : If true, channels are read in reverse order (BGR input gives RGB planes)
+ * @param[in] 		i_scale  : Scale applied to the input values before normalization
+ * @param[in] 		i_mean   : Mean subtracted to each plane, after scaling
+ * @param[in] 		i_std    : Standard deviation dividing each plane, after scaling
+ * @param[out]		o_planes : Output buffer, 3 contiguous planes of i_image.rows*i_image.cols floats (CHW layout)
+ * @param[in] 		i_downscale : Integer downscale done in the same pass, same as cv::INTER_AREA : each output pixel
+ *                                is the mean of a block of i_downscale*i_downscale pixels. The planes then are
+ *                                (i_image.rows/i_downscale)*(i_image.cols/i_downscale) floats. 1 for none
+ * @return 		(int)    : 0 on success, negative if i_image has an unsupported type
+ *
+ */
+/*============================================================================*/
+int preprocess_packedToPlanar(const cv::Mat& i_image, bool i_swapRB, float i_scale,
+                              const cv::Vec3f& i_mean, const cv::Vec3f& i_std, float* o_planes, int i_downscale = 1);
+
+/*============================================================================*/
+/* Function Description                                                       */
+/*============================================================================*/
+/**
+ * @brief         	Same as above, written as bfloat16 : o_planes receives the bit patterns of the bfloat16 values,
+ *                  rounded to nearest even, ready for a torch::kBFloat16 tensor
+ *
+ */
+/*============================================================================*/
+int preprocess_packedToPlanar(const cv::Mat& i_image, bool i_swapRB, float i_scale,
+                              const cv::Vec3f& i_mean, const cv::Vec3f& i_std, uint16_t* o_planes, int i_downscale = 1);
+
+//! @brief Bit pattern of the bfloat16 nearest to i_value (round to nearest even). NaN are not handled
+inline uint16_t float_to_bfloat16(float i_value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &i_value, sizeof(bits));
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+} /* namespace VBGE */
+#endif /* UTILS_PREPROCESSING_HPP_ */
@@ -0,0 +1,96 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_Threading.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef UTILS_THREADING_HPP_
+#define UTILS_THREADING_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <cstdint>
+#include <string>
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+//! @brief Cores and torch intra-op threads of a group of threads
+class ThreadPartition {
+public:
+    //! @brief Name in the statistics
+    std::string name;
+    //! @brief First core of the partition, -1 when its threads are not pinned
+    int firstCore = -1;
+    //! @brief Number of cores of the partition
+    int nbCores = 0;
+    //! @brief Number of torch intra-op threads of the threads running in the partition, 0 to keep the default
+    int nbThreads = 0;
+};
+
+/*============================================================================*/
+/* Function Description                                                       */
+/*============================================================================*/
+/**
+ * @brief         	Run the calling thread in a partition : sets its number of torch intra-op threads, and pins it
+ *                  to the cores of the partition. The intra-op threads it starts inherit its cores.
+ *                  Only does something when the partition of the thread changes
+ * @param[in] 		i_partition : Partition
+ * @return 		(int) : 0 on success, -1 on error
+ *
+ */
+/*============================================================================*/
+int apply_threadPartition(const ThreadPartition& i_partition);
+
+/*============================================================================*/
+/* Function Description                                                       */
+/*============================================================================*/
+/**
+ * @brief         	True when the number of torch intra-op threads is a setting of each calling thread (OpenMP
+ *                  backend), false when libtorch uses its native pool, sized once for the whole process.
+ *                  Partitions with different numbers of threads can only run at the same time in the first case
+ * @return 		(bool) : True if each thread has its own intra-op threads
+ *
+ */
+/*============================================================================*/
+bool get_isTorchPoolPerThread();
+
+/*============================================================================*/
+/* Function Description                                                       */
+/*============================================================================*/
+/**
+ * @brief         	Size the OpenCV pool, and start its threads on the cores of a partition. The calling thread
+ *                  gets its cores back afterwards. A pool started before by another thread keeps its cores
+ * @param[in] 		i_partition : Partition of the OpenCV pool, nbThreads threads
+ * @return 		(int) : 0 on success, -1 on error
+ *
+ */
+/*============================================================================*/
+int start_openCVPool(const ThreadPartition& i_partition);
+
+//! @brief Busy fraction of a range of cores since reset(), from /proc/stat. Linux only
+class CoresUsage {
+public:
+    //! @brief Start measuring the cores [i_firstCore, i_firstCore + i_nbCores)
+    void reset(int i_firstCore, int i_nbCores);
+    //! @brief Fraction of the time the cores were busy since reset(), in [0, 1]. -1 if unknown
+    double get_utilization() const;
+
+private:
+    int m_firstCore = -1;
+    int m_nbCores = 0;
+    uint64_t m_busy = 0;
+    uint64_t m_total = 0;
+
+    //! @brief Busy and total jiffies of the cores, false if /proc/stat can not be read
+    bool read(uint64_t& o_busy, uint64_t& o_total) const;
+};
+
+} /* namespace VBGE */
+#endif /* UTILS_THREADING_HPP_ */
@@ -13,12 +13,26 @@
 /*============================================================================*/
 /* Includes                                                                   */
 /*============================================================================*/
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include <opencv2/opencv.hpp>
 #include <torch/script.h>
 
 #include "DeepLabV3_Inference.hpp"
 #include "DeepImageMatting_Inference.hpp"
 #include "VideoBackgroundEraser_Settings.hpp"
+#include "VideoBackgroundEraser_Frame.hpp"
+#include "VideoBackgroundEraser_Statistics.hpp"
+#include "VideoBackgroundEraser_Workspace.hpp"
+#include "VideoBackgroundEraser_SceneCutDetector.hpp"
+#include "VideoBackgroundEraser_Scheduler.hpp"
+#include "Utils_LatencyHistogram.hpp"
+#include "Utils_Threading.hpp"
 
 /*============================================================================*/
 /* define                                                                     */
@@ -39,10 +53,12 @@ public:
     /**
      * @brief         	Constructor
      * @param[in] 		i_settings         : user settings
+     * @param[in] 		i_scheduler        : Optional scheduler running the inference of several streams, nullptr to run it here
      *
      */
     /*============================================================================*/
-    VideoBackgroundEraser_Algo(const VideoBackgroundEraser_Settings& i_settings);
+    VideoBackgroundEraser_Algo(const VideoBackgroundEraser_Settings& i_settings,
+                               const std::shared_ptr<VideoBackgroundEraser_Scheduler>& i_scheduler = nullptr);
 
     /*============================================================================*/
     /* Function Description                                                       */
@@ -65,6 +81,62 @@ public:
     /*============================================================================*/
     bool get_isInitialized();
 
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Statistics of the pooled allocator
+     * @return 		(AllocatorStatistics) : Empty statistics if VideoBackgroundEraser_Settings::enable_pooledAllocator is false
+     *
+     */
+    /*============================================================================*/
+    AllocatorStatistics get_allocatorStatistics();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Number of frames processed by each path of the segmentation stage
+     * @return 		(FrameCounters) : Counters since the creation of the instance
+     *
+     */
+    /*============================================================================*/
+    FrameCounters get_frameCounters();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Indexes of the frames where a scene cut was detected since the previous call
+     * @param[out]		o_indexes : Frame indexes (VideoBackgroundEraser_Frame::index), in order
+     *
+     */
+    /*============================================================================*/
+    void get_sceneCuts(std::vector<int64_t>& o_indexes);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Latency of each stage and counters since the creation of the instance
+     * @return 		(Statistics) : Statistics
+     *
+     */
+    /*============================================================================*/
+    Statistics get_statistics();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Write the statistics to a file, replaced atomically
+     * @param[in] 		i_path   : Path of the file
+     * @param[in] 		i_format : Format of the file
+     *
+     */
+    /*============================================================================*/
+    int dump_statistics(const std::string& i_path, StatisticsFormat i_format);
+
     /*============================================================================*/
     /* Function Description                                                       */
     /*============================================================================*/
@@ -77,22 +149,137 @@ public:
     /*============================================================================*/
     int run(const cv::Mat& i_image, cv::Mat& o_image_withoutBackground);
 
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Process successive frames of a video at once. Each network runs a single forward for the batch
+     * @param[in] 		i_images                   : Input images, in temporal order, same size and type. Types are the same as run()
+     * @param[out]		o_images_withoutBackground : Output images, same order as i_images
+     *
+     */
+    /*============================================================================*/
+    int run_batch(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& o_images_withoutBackground);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	First stage of run() : segmentation with DeepLabV3 and creation of the background mask
+     * @param[in,out]	io_frame : Frame, image must be set. imageNetwork and backgroundMask are filled
+     *                  (or io_frames : frames of a batch of same size, DeepLabV3 runs a single forward)
+     *
+     * @note            Each stage keeps its own state : two different stages may run concurrently
+     *                  on two different frames, but a given stage must be called in frame order.
+     *                  The single frame overloads of run_segmentation() and run_matting() are the entry points of a
+     *                  pipeline : they run their network in the thread partition of their stage (enable_concurrentNetworks)
+     */
+    /*============================================================================*/
+    int run_segmentation(VideoBackgroundEraser_Frame& io_frame);
+    int run_segmentation(std::vector<VideoBackgroundEraser_Frame*>& io_frames);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Second stage of run() : temporal management and trimap generation
+     * @param[in,out]	io_frame : Frame processed by run_segmentation(). foregroundMask and trimap are filled
+     *
+     */
+    /*============================================================================*/
+    int run_trimap(VideoBackgroundEraser_Frame& io_frame);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Third stage of run() : Deep Image Matting and creation of the output image
+     * @param[in,out]	io_frame : Frame processed by run_trimap(). image_withoutBackground is filled
+     *                  (or io_frames : frames of a batch of same size, DeepImageMatting runs a single forward)
+     *
+     */
+    /*============================================================================*/
+    int run_matting(VideoBackgroundEraser_Frame& io_frame);
+    int run_matting(std::vector<VideoBackgroundEraser_Frame*>& io_frames);
+
 private:
     // Misc
     bool m_isInitialized = false;
+    // Start of the constructor, for the time to first frame
+    std::chrono::steady_clock::time_point m_creationTime;
 
     // Settings
     VideoBackgroundEraser_Settings m_settings;
 
     // Members
+    // Optional : when set, the forwards of both networks go through it instead of the instances below
+    std::shared_ptr<VideoBackgroundEraser_Scheduler> m_scheduler;
+    // Both models, loaded in parallel before the networks are created, which then find them in ModelRegistry
+    std::vector<std::shared_ptr<torch::jit::script::Module>> m_models;
     DeepLabV3_Inference m_deeplabv3_inference;
     cv::Mat m_image_prev;
     cv::Ptr<cv::DISOpticalFlow> m_optFLow;
-    std::list<cv::Mat> m_detections_history;
-    cv::Mat m_statusMap;
+    // Temporal management, CV_8UC2 : bit-planes of the detections history, and status of each pixel
+    cv::Mat m_temporalState;
+    uchar m_temporalVote[256];
+    int m_temporalVote_P = -1;
+    int m_temporalVote_Q = -1;
     cv::Mat m_flow;
     cv::Mat m_mapXY;
     DeepImageMatting_Inference m_deepimagematting_inference;
+    VideoBackgroundEraser_Frame m_frame;
+    std::vector<VideoBackgroundEraser_Frame> m_batchFrames;
+    VideoBackgroundEraser_Workspace m_workspace;
+    // Keyframe mode, state of the segmentation stage : mask of the last frame at keyframe_scale,
+    // background area of the last keyframe, number of frames since the last keyframe
+    cv::Ptr<cv::DISOpticalFlow> m_keyframe_optFlow;
+    cv::Mat m_keyframe_grayPrev;
+    cv::Mat m_keyframe_mask;
+    int m_keyframe_area = 0;
+    int m_keyframe_age = 0;
+    // Counters, read from any thread
+    std::atomic<uint64_t> m_nbFrames_inferred{0};
+    std::atomic<uint64_t> m_nbFrames_propagated{0};
+    std::atomic<uint64_t> m_nbKeyframes_forced{0};
+    std::atomic<uint64_t> m_nbFrames_duplicate{0};
+    std::atomic<uint64_t> m_nbSceneCuts{0};
+    // Scene cut detection, owned by the segmentation stage. Cut events wait in m_sceneCuts until they are read
+    VideoBackgroundEraser_SceneCutDetector m_sceneCutDetector;
+    std::mutex m_sceneCuts_mutex;
+    std::vector<int64_t> m_sceneCuts;
+    // Instrumentation : latency of each stage, frames out of the matting stage, pixels in the unknown band of the trimaps
+    enum Stage {
+        Stage_Total,
+        Stage_Segmentation,
+        Stage_DeepLabV3,
+        Stage_Trimap,
+        Stage_TemporalManagement,
+        Stage_Matting,
+        Stage_DeepImageMatting,
+        Stage_Count
+    };
+    LatencyHistogram m_latencies[Stage_Count];
+    std::atomic<uint64_t> m_nbFrames{0};
+    std::atomic<uint64_t> m_nbUnknownPixels{0};
+    std::atomic<uint64_t> m_nbTrimapPixels{0};
+    std::atomic<double> m_unknownRatio_lastFrame{0.};
+    double m_initialization_ms = 0.;
+    std::atomic<double> m_timeToFirstFrame_ms{0.};
+    // Threading : partitions of threads_budget, the ones the stages run in (-1 when the budget is 0), and the usage
+    // of the cores of each partition since the end of the initialization. The synchronous partition holds every torch
+    // core, for run() and run_batch()
+    std::vector<ThreadPartition> m_partitions;
+    int m_partition_segmentation = -1;
+    int m_partition_matting = -1;
+    ThreadPartition m_partition_synchronous;
+    bool m_isSynchronousWarned = false;
+    std::vector<CoresUsage> m_coresUsage;
+    // Duplicate detection : thumbnail and background mask of the last frame which was not a duplicate (segmentation stage),
+    // and its alpha (matting stage)
+    cv::Mat m_duplicate_thumbnail;
+    cv::Size m_duplicate_size;
+    cv::Mat m_duplicate_backgroundMask;
+    cv::Mat m_duplicate_alpha;
 
     /*============================================================================*/
     /* Function Description                                                       */
@@ -102,10 +289,108 @@ private:
      * @param[in] 		i_image_rgb_uint8 : Input image, RGB packed, CV_8UC3
      * @param[in] 		i_backgroundMask  : Input mask, CV_8UC1. 255 for background pixels, 0 for the foreground
      * @param[out]		o_foregroundMask  : Output mask, CV_8UC1, 255 for foreground pixels, 0 for the background
+     * @param[in] 		i_isDuplicate     : True when the image is a duplicate of the previous one : the flow is not computed,
+     *                                      only the history advances
+     * @param[in] 		i_isSceneCut      : True when the image starts a new scene : the flow is not computed,
+     *                                      the history and status restart from the current detection
      *
      */
     /*============================================================================*/
-    int temporalManagement(const cv::Mat& i_image_rgb_uint8, const cv::Mat& i_backgroundMask, cv::Mat& o_foregroundMask);
+    int temporalManagement(const cv::Mat& i_image_rgb_uint8, const cv::Mat& i_backgroundMask, cv::Mat& o_foregroundMask, bool i_isDuplicate,
+                           bool i_isSceneCut);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Compare the thumbnail of a frame with the one of the last frame which was not a duplicate
+     * @param[in,out]	io_frame : Frame, imageNetwork must be set. isDuplicate is filled
+     *
+     */
+    /*============================================================================*/
+    void detect_duplicate(VideoBackgroundEraser_Frame& io_frame);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Split threads_budget into partitions, set the torch inter-op threads and start the OpenCV pool,
+     *                  see VideoBackgroundEraser_Settings::threads_budget
+     *
+     */
+    /*============================================================================*/
+    int init_threading();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run the calling thread in the whole torch partition, for run() and run_batch() : the stages run
+     *                  one after the other, so the networks never run concurrently. Warns once with enable_concurrentNetworks
+     *
+     */
+    /*============================================================================*/
+    int apply_synchronousPartition();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run both networks on blank images at the resolutions of warmup_size, see VideoBackgroundEraser_Settings::warmup_size
+     *
+     */
+    /*============================================================================*/
+    int warmup();
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run Deep Image Matting, through the scheduler when there is one
+     * @param[in] 		i_images             : Input images, all of the same size
+     * @param[in] 		i_trimaps            : Input trimaps, one per image
+     * @param[in,out]	io_alpha_predictions : Output alphas, buffers already there are reused
+     *
+     */
+    /*============================================================================*/
+    int run_deepImageMatting(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                             std::vector<cv::Mat>& io_alpha_predictions);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Run DeepLabV3 on a batch of frames and fill their background masks
+     * @param[in,out]	io_frames : Frames, imageNetwork must be set. backgroundMask is filled
+     *
+     */
+    /*============================================================================*/
+    int infer_backgroundMasks(std::vector<VideoBackgroundEraser_Frame*>& io_frames);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Keyframe mode : run DeepLabV3 on keyframes, and warp the mask of the previous frame with
+     *                  the optical flow on the others. A keyframe is forced when the flow, the warp residual or
+     *                  the change of background area exceed their thresholds
+     * @param[in,out]	io_frame : Frame, imageNetwork must be set. backgroundMask is filled
+     *
+     */
+    /*============================================================================*/
+    int segment_keyframe(VideoBackgroundEraser_Frame& io_frame);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Push the new detections in the history, vote over the last Q frames and update the status, in a single pass
+     * @param[in] 		i_backgroundMask  : Input mask, CV_8UC1. 255 for background pixels, 0 for the foreground
+     * @param[out]		o_foregroundMask  : Output mask, CV_8UC1, 255 for foreground pixels, 0 for the background
+     *
+     */
+    /*============================================================================*/
+    void update_temporalState(const cv::Mat& i_backgroundMask, cv::Mat& o_foregroundMask);
 
     /*============================================================================*/
     /* Function Description                                                       */
@@ -119,6 +404,19 @@ private:
     /*============================================================================*/
     void compute_trimap(const cv::Mat& i_foreground, cv::Mat &o_trimap);
 
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Compute the areas where Deep Image Matting runs in roi mode : connected regions of the
+     *                  unknown band, padded by VideoBackgroundEraser_Settings::roiMatting_padding, overlapping areas merged
+     * @param[in] 		i_unknownMask : Input mask, CV_8UC1, 255 where the trimap is unknown
+     * @param[out]		o_rois        : Areas, which do not overlap
+     *
+     */
+    /*============================================================================*/
+    void compute_mattingRois(const cv::Mat& i_unknownMask, std::vector<cv::Rect>& o_rois);
+
 };
 
 } /* namespace VBGE */
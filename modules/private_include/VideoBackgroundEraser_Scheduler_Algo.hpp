@@ -0,0 +1,106 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Scheduler_Algo.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_SCHEDULER_ALGO_HPP_
+#define VIDEOBACKGROUNDERASER_SCHEDULER_ALGO_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <memory>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "DeepLabV3_Inference.hpp"
+#include "DeepImageMatting_Inference.hpp"
+#include "VideoBackgroundEraser_Scheduler.hpp"
+#include "Utils_InferenceBatcher.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+
+class VideoBackgroundEraser_Scheduler_Algo {
+public:
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Constructor, loads the networks and starts the batching threads
+     * @param[in] 		i_settings         : user settings
+     *
+     */
+    /*============================================================================*/
+    VideoBackgroundEraser_Scheduler_Algo(const VideoBackgroundEraser_Scheduler_Settings& i_settings);
+
+    /*============================================================================*/
+    /* Function Description                                                       */
+    /*============================================================================*/
+    /**
+     * @brief         	Destructor, serves the pending requests then stops the batching threads
+     *
+     */
+    /*============================================================================*/
+    ~VideoBackgroundEraser_Scheduler_Algo();
+
+    bool get_isInitialized();
+    const VideoBackgroundEraser_Scheduler_Settings& get_settings();
+
+    //! @brief See VideoBackgroundEraser_Scheduler
+    int run_segmentation(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& io_segmentations, bool i_isBGR, int i_priority);
+    int run_backgroundMask(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& io_backgroundMasks, bool i_isBGR, int i_priority);
+    int run_matting(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                    std::vector<cv::Mat>& io_alpha_predictions, bool i_isBGR, int i_priority);
+    SchedulerStatistics get_statistics();
+
+private:
+    // Misc
+    bool m_isInitialized = false;
+
+    // Settings
+    VideoBackgroundEraser_Scheduler_Settings m_settings;
+
+    // Kinds of requests, see InferenceBatcher::Request::kind
+    enum Kind {
+        Kind_Segmentation,
+        Kind_BackgroundMask,
+        Kind_Matting
+    };
+
+    // Members
+    // Both models, loaded in parallel before the networks are created, which then find them in ModelRegistry
+    std::vector<std::shared_ptr<torch::jit::script::Module>> m_models;
+    // Only used from the batching threads
+    DeepLabV3_Inference m_deeplabv3_inference;
+    DeepImageMatting_Inference m_deepimagematting_inference;
+    // Inputs and outputs of all the requests of the running batch
+    std::vector<cv::Mat> m_deeplabv3_images;
+    std::vector<cv::Mat> m_deeplabv3_outputs;
+    std::vector<cv::Mat> m_deepimagematting_images;
+    std::vector<cv::Mat> m_deepimagematting_trimaps;
+    std::vector<cv::Mat> m_deepimagematting_outputs;
+    // Declared last : destroyed first, while the networks still exist
+    std::unique_ptr<InferenceBatcher> m_deeplabv3_batcher;
+    std::unique_ptr<InferenceBatcher> m_deepimagematting_batcher;
+
+    //! @brief Batch functions, run a single forward for all the requests and split the outputs back
+    int run_deeplabv3_batch(std::vector<InferenceBatcher::Request*>& io_requests);
+    int run_deepimagematting_batch(std::vector<InferenceBatcher::Request*>& io_requests);
+
+    //! @brief Queue a request built from the arguments, and move its outputs back once served
+    int run_request(InferenceBatcher& io_batcher, int i_kind, const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>* i_trimaps,
+                    std::vector<cv::Mat>& io_outputs, bool i_isBGR, int i_priority);
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_SCHEDULER_ALGO_HPP_ */
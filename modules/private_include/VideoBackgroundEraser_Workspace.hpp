@@ -0,0 +1,131 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Workspace.hpp
+
+ */
+/*============================================================================*/
+
+#ifndef VIDEOBACKGROUNDERASER_WORKSPACE_HPP_
+#define VIDEOBACKGROUNDERASER_WORKSPACE_HPP_
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "VideoBackgroundEraser_Frame.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+/*============================================================================*/
+/* Class Description                                                          */
+/*============================================================================*/
+/**
+ * 	\brief       Intermediate buffers of VideoBackgroundEraser_Algo, kept from one frame to the next
+ *
+ *              Buffers are filled with create() or functions writing in their output : they are
+ *              only reallocated when the resolution changes. Each stage has its own buffers,
+ *              so stages running concurrently on different frames never share one.
+ */
+/*============================================================================*/
+class VideoBackgroundEraser_Workspace {
+public:
+    //! @brief Buffers of the segmentation stage
+    class Segmentation {
+    public:
+        //! @brief Headers on the images of the batch given to DeepLabV3
+        std::vector<cv::Mat> imagesNetwork;
+        //! @brief Output of DeepLabV3, classes id, CV_32SC1
+        std::vector<cv::Mat> segmentations;
+        //! @brief Mask of the pixels of a single class, CV_8UC1
+        cv::Mat classMask;
+        //! @brief Headers on the background masks of the frames of the batch
+        std::vector<cv::Mat> backgroundMasks;
+        //! @brief Keyframe mode : input image at keyframe_scale, and its CV_8U grayscale version
+        cv::Mat image_small;
+        cv::Mat image_small_uint8;
+        cv::Mat gray;
+        //! @brief Keyframe mode : optical flow to the previous frame and its coordinates map
+        cv::Mat flow;
+        cv::Mat mapXY;
+        //! @brief Keyframe mode : previous grayscale image and previous mask warped onto the current frame
+        cv::Mat warped;
+        cv::Mat warpedMask;
+        //! @brief Duplicate detection : thumbnail of the input image, and its CV_8U version
+        cv::Mat thumbnail;
+        cv::Mat thumbnail_uint8;
+        //! @brief Frames of the batch which are not duplicates
+        std::vector<VideoBackgroundEraser_Frame*> frames;
+    };
+
+    //! @brief Buffers of the trimap stage, including temporal management
+    class Trimap {
+    public:
+        //! @brief Input image converted to CV_8UC3, when it is not already CV_8U
+        cv::Mat image_rgb_uint8;
+        //! @brief Input image and masks at the scale of temporal management, when it is not 1
+        cv::Mat image_rgb_temporal;
+        cv::Mat backgroundMask_temporal;
+        cv::Mat foregroundMask_temporal;
+        //! @brief Grayscale image given to the optical flow, swapped with the previous image after each frame
+        cv::Mat image_uint8;
+        //! @brief Destination of remap(), which can not work in place without a copy
+        cv::Mat remapped;
+        //! @brief Temporary mask, CV_8UC1
+        cv::Mat mask;
+        //! @brief Foreground mask at the resolution of Deep Image Matting, CV_8UC1
+        cv::Mat foregroundMask_down;
+        //! @brief Morphological operations of compute_trimap(), CV_8UC1
+        cv::Mat dilated;
+        cv::Mat eroded;
+    };
+
+    //! @brief Buffers of the matting stage
+    class Matting {
+    public:
+        //! @brief Input images resized to the resolution of Deep Image Matting
+        std::vector<cv::Mat> imagesNetwork_down;
+        //! @brief Headers on the input images at the resolution of Deep Image Matting, one per frame
+        std::vector<cv::Mat> images_down;
+        //! @brief Headers on the images (or crops) and trimaps given to Deep Image Matting, and on its outputs
+        std::vector<cv::Mat> imagesNetwork;
+        std::vector<cv::Mat> trimaps_down;
+        std::vector<cv::Mat> alphas;
+        //! @brief Alpha at the resolution of Deep Image Matting, one per frame, CV_32FC1
+        std::vector<cv::Mat> alpha_predictions_down;
+        //! @brief Frames processed whole, or by crops around their unknown areas
+        std::vector<size_t> fullFrames;
+        std::vector<size_t> roiFrames;
+        //! @brief Areas of each frame where alpha is computed, and the crops given to Deep Image Matting
+        std::vector<std::vector<cv::Rect>> rois;
+        std::vector<cv::Rect> crops;
+        //! @brief Unknown pixels of the trimap, CV_8UC1
+        cv::Mat unknownMask;
+        //! @brief Outputs of connectedComponentsWithStats()
+        cv::Mat labels;
+        cv::Mat stats;
+        cv::Mat centroids;
+        //! @brief Alpha upscaled to the input resolution, CV_32FC1
+        cv::Mat alpha_prediction;
+        //! @brief Alpha with the same depth as the input
+        cv::Mat alpha;
+        //! @brief Temporary mask, CV_8UC1
+        cv::Mat mask;
+        //! @brief Duplicate frames of the batch whose alpha is reused, one per frame
+        std::vector<uchar> isAlphaReused;
+    };
+
+    Segmentation segmentation;
+    Trimap trimap;
+    Matting matting;
+};
+
+} /* namespace VBGE */
+#endif /* VIDEOBACKGROUNDERASER_WORKSPACE_HPP_ */
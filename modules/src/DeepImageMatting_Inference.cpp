@@ -10,11 +10,17 @@
 /*============================================================================*/
 /* Includes                                                                   */
 /*============================================================================*/
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <iomanip>
 #include <typeinfo>
 
 #include "Utils_Logging.hpp"
+#include "Utils_ModelRegistry.hpp"
+#include "Utils_CpuFeatures.hpp"
+
+#include "Utils_Preprocessing.hpp"
 
 #include "DeepImageMatting_Inference.hpp"
 
@@ -27,14 +33,58 @@
 /*============================================================================*/
 namespace VBGE {
 
+namespace {
+
+// Trimap value to its bfloat16 plane value, value/255, CV_16UC1 bit patterns
+const cv::Mat& get_trimapToBFloat16()
+{
+    static const cv::Mat lut = []() {
+        cv::Mat table(1, 256, CV_16U);
+        for(int v = 0 ; v < 256 ; ++v) {
+            table.at<uint16_t>(v) = float_to_bfloat16(v/255.f);
+        }
+        return table;
+    }();
+    return lut;
+}
+
+} /* namespace */
+
 DeepImageMatting_Inference::DeepImageMatting_Inference(const DeepImageMatting_Inference_Settings& i_settings)
     : m_settings(i_settings)
 {
-    m_model = torch::jit::load(m_settings.model_path, m_settings.inferenceDeviceType);
+    if(InferencePrecision::INT8 == m_settings.precision && torch::kCPU != m_settings.inferenceDeviceType) {
+        logging_error("InferencePrecision::INT8 only runs on torch::kCPU.");
+        return;
+    }
+    m_precision = get_supportedPrecision(m_settings.precision, m_settings.inferenceDeviceType);
+    if(m_precision != m_settings.precision) {
+        logging_info("This CPU has no native bfloat16, the network runs in FP32.");
+    }
+    m_model = ModelRegistry::get_instance().get_model(get_modelRequest(m_settings));
+    if(!m_model) {
+        logging_error("Failed to load the model.");
+        return;
+    }
 
     m_isInitialized = true;
 }
 
+ModelRegistry::Request DeepImageMatting_Inference::get_modelRequest(const DeepImageMatting_Inference_Settings& i_settings)
+{
+    const bool isQuantized = (InferencePrecision::INT8 == i_settings.precision);
+    ModelRegistry::Request request;
+    request.path = isQuantized ? i_settings.quantized_model_path : i_settings.model_path;
+    request.device = i_settings.inferenceDeviceType;
+    request.isQuantized = isQuantized;
+    if(InferencePrecision::BF16 == get_supportedPrecision(i_settings.precision, i_settings.inferenceDeviceType)) {
+        request.dtype = torch::kBFloat16;
+    }
+    request.optimize = i_settings.enable_optimizeForInference;
+    request.cacheDirectory = i_settings.optimizedModel_cacheDirectory;
+    return request;
+}
+
 DeepImageMatting_Inference::~DeepImageMatting_Inference()
 {
 
@@ -45,44 +95,268 @@ bool DeepImageMatting_Inference::get_isInitialized() {
 }
 
 
-int DeepImageMatting_Inference::run(const cv::Mat& i_image_rgba, cv::Mat& o_alpha_prediction)
+int DeepImageMatting_Inference::run(const cv::Mat& i_image, const cv::Mat& i_trimap, cv::Mat& o_alpha_prediction, bool i_isBGR)
+{
+    // Share o_alpha_prediction so its buffer is reused
+    std::vector<cv::Mat> alpha_predictions(1, o_alpha_prediction);
+    if(0 > run(std::vector<cv::Mat>(1, i_image), std::vector<cv::Mat>(1, i_trimap), alpha_predictions, i_isBGR)) {
+        return -1;
+    }
+    o_alpha_prediction = alpha_predictions[0];
+
+    return 0;
+}
+
+int DeepImageMatting_Inference::run(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                                    std::vector<cv::Mat>& o_alpha_predictions, bool i_isBGR)
 {
     if(false == get_isInitialized()) {
         logging_error("This instance was not correctly initialized.");
         return -1;
     }
-    if(CV_32FC4 != i_image_rgba.type()) {
-        logging_error("CV_32FC4 != i_image_rgba.type()");
+    if(i_images.empty()) {
+        logging_error("i_images is empty.");
+        return -1;
+    }
+    if(i_images.size() != i_trimaps.size()) {
+        logging_error("i_images.size() != i_trimaps.size()");
         return -1;
     }
+    for(size_t n = 0 ; n < i_images.size() ; ++n) {
+        if(CV_8UC3 != i_images[n].type() && CV_32FC3 != i_images[n].type()) {
+            logging_error("CV_8UC3 != i_images[n].type() && CV_32FC3 != i_images[n].type()");
+            return -1;
+        }
+        if(i_images[0].size() != i_images[n].size() || i_images[0].type() != i_images[n].type()) {
+            logging_error("All images of the batch must have the same size and type.");
+            return -1;
+        }
+        if(CV_8UC1 != i_trimaps[n].type() || i_images[n].size() != i_trimaps[n].size()) {
+            logging_error("Trimaps must be CV_8UC1 and have the same size as the images.");
+            return -1;
+        }
+    }
+
+    // Frames larger than a tile are processed tile by tile
+    const int tileSize = get_tileSize(i_images[0].size());
+    if(0 < tileSize) {
+        o_alpha_predictions.resize(i_images.size());
+        for(size_t n = 0 ; n < i_images.size() ; ++n) {
+            if(0 > run_tiled(i_images[n], i_trimaps[n], o_alpha_predictions[n], i_isBGR, tileSize)) {
+                logging_error("run_tiled() failed.");
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    // Several forwards when the whole batch does not fit in the memory cap
+    const size_t batchSize = get_maxBatchSize(i_images[0].size());
+    if(batchSize >= i_images.size()) {
+        return forward(i_images, i_trimaps, o_alpha_predictions, i_isBGR);
+    }
+    o_alpha_predictions.resize(i_images.size());
+    std::vector<cv::Mat> images, trimaps, alpha_predictions;
+    for(size_t first = 0 ; first < i_images.size() ; first += batchSize) {
+        const size_t last = std::min(i_images.size(), first + batchSize);
+        images.assign(i_images.begin() + first, i_images.begin() + last);
+        trimaps.assign(i_trimaps.begin() + first, i_trimaps.begin() + last);
+        alpha_predictions.assign(o_alpha_predictions.begin() + first, o_alpha_predictions.begin() + last);
+        if(0 > forward(images, trimaps, alpha_predictions, i_isBGR)) {
+            logging_error("forward() failed.");
+            return -1;
+        }
+        std::copy(alpha_predictions.begin(), alpha_predictions.end(), o_alpha_predictions.begin() + first);
+    }
 
+    return 0;
+}
+
+int DeepImageMatting_Inference::forward(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                                        std::vector<cv::Mat>& o_alpha_predictions, bool i_isBGR)
+{
     // We don't want to save the gradients during net.forward()
-    torch::NoGradGuard no_grad_guard;
+    InferenceGuard inference_guard;
 
     // Prepare Input
-    // Encapsulate i_src in a tensor (no deep copy) with OpenCV format NHWC
-    std::vector<int64_t> srcSize = {1, i_image_rgba.rows, i_image_rgba.cols, i_image_rgba.channels()};
-    std::vector<int64_t> srcStride = {1, static_cast<int64_t>(i_image_rgba.step1()), i_image_rgba.channels(), 1};
-    torch::Tensor srcTensor_NHWC = torch::from_blob(i_image_rgba.data, srcSize, srcStride, torch::kCPU);
-    // Permute format NHWC (OpenCV) to NCHW (PyTorch) (no deep copy)
-    torch::Tensor inputTensor_NCHW = srcTensor_NHWC.permute({0, 3, 1, 2}).to(m_settings.inferenceDeviceType);
+    // Stack all images and trimaps in a single tensor with PyTorch format NCHW, in one pass
+    const int64_t batchSize = i_images.size();
+    const int rows = i_images[0].rows;
+    const int cols = i_images[0].cols;
+    // In BF16, preprocessing writes bfloat16 directly, the input is never converted
+    const bool isBFloat16 = (InferencePrecision::BF16 == m_precision);
+    const torch::ScalarType inputType = isBFloat16 ? torch::kBFloat16 : torch::kFloat32;
+    if(false == m_inputTensor.defined() || false == m_inputTensor.sizes().equals({batchSize, 4, rows, cols})) {
+        m_inputTensor = torch::empty({batchSize, 4, rows, cols}, inputType); // /!\ Dynamic alloc, only when the size changes
+    }
+    // DeepImageMatting takes rgb in [0, 1], without mean and std normalization
+    const float scale = (CV_8U == i_images[0].depth()) ? 1.f/255.f : 1.f;
+    const cv::Vec3f zeroMean(0.f, 0.f, 0.f);
+    const cv::Vec3f unitStd(1.f, 1.f, 1.f);
+    const size_t planeSize = static_cast<size_t>(rows)*cols;
+    for(int64_t n = 0 ; n < batchSize ; ++n) {
+        // Planes 0 to 2 : rgb. Plane 3 : trimap in [0, 1]
+        if(isBFloat16) {
+            uint16_t* planes = static_cast<uint16_t*>(m_inputTensor[n].data_ptr());
+            if(0 > preprocess_packedToPlanar(i_images[n], i_isBGR, scale, zeroMean, unitStd, planes)) {
+                logging_error("preprocess_packedToPlanar() failed.");
+                return -1;
+            }
+            cv::Mat trimapPlane(rows, cols, CV_16U, planes + 3*planeSize);
+            cv::LUT(i_trimaps[n], get_trimapToBFloat16(), trimapPlane);
+        } else {
+            float* planes = m_inputTensor[n].data_ptr<float>();
+            if(0 > preprocess_packedToPlanar(i_images[n], i_isBGR, scale, zeroMean, unitStd, planes)) {
+                logging_error("preprocess_packedToPlanar() failed.");
+                return -1;
+            }
+            cv::Mat trimapPlane(rows, cols, CV_32F, planes + 3*planeSize);
+            i_trimaps[n].convertTo(trimapPlane, CV_32F, 1./255.);
+        }
+    }
+    torch::Tensor inputTensor_NCHW = m_inputTensor.to(m_settings.inferenceDeviceType);
 
     // Inference
     std::vector<torch::jit::IValue> inputs;
     inputs.push_back(inputTensor_NCHW);
     // /!\ Dynamic alloc
-    torch::Tensor neuralNet_outputTensor_CHW = m_model.forward(inputs).toTensor();
+    torch::Tensor neuralNet_outputTensor = m_model->forward(inputs).toTensor();
 
     // Prepare output
-    o_alpha_prediction.create(i_image_rgba.size(), CV_32F);
-    // Permute format CHW (PyTorch) to HWC (OpenCV) (no deep copy)
-    torch::Tensor neuralNet_outputTensor_HWC = neuralNet_outputTensor_CHW.permute({1, 2, 0});
-    // Encapsulate o_enhanced_image_rgba in a tensor (no deep copy) with OpenCV format NHWC
-    std::vector<int64_t> dstSize = {o_alpha_prediction.rows, o_alpha_prediction.cols, o_alpha_prediction.channels()};
-    std::vector<int64_t> dstStride = {static_cast<int64_t>(o_alpha_prediction.step1()), o_alpha_prediction.channels(), 1};
-    torch::Tensor dstTensor_HWC = torch::from_blob(o_alpha_prediction.data, dstSize, dstStride, torch::kCPU);
-    // Copy neuralNet_outputTensor_HWC to outputTensor_HWC
-    dstTensor_HWC.copy_(neuralNet_outputTensor_HWC, true);
+    // Each output keeps its buffer when it already has the right size and type. A bfloat16 output is converted to float by copy_()
+    torch::Tensor alphaTensor = neuralNet_outputTensor.reshape({batchSize, rows, cols});
+    o_alpha_predictions.resize(batchSize);
+    for(int64_t n = 0 ; n < batchSize ; ++n) {
+        cv::Mat& alpha_prediction = o_alpha_predictions[n];
+        alpha_prediction.create(rows, cols, CV_32F); // /!\ Dynamic alloc, only when the size changes
+        std::vector<int64_t> dstSize = {alpha_prediction.rows, alpha_prediction.cols};
+        std::vector<int64_t> dstStride = {static_cast<int64_t>(alpha_prediction.step1()), 1};
+        torch::Tensor dstTensor = torch::from_blob(alpha_prediction.data, dstSize, dstStride, torch::kCPU);
+        // Copy neuralNet_outputTensor (one alpha channel per image) to dstTensor
+        dstTensor.copy_(alphaTensor[n]);
+    }
+
+    return 0;
+}
+
+int DeepImageMatting_Inference::get_tileSize(const cv::Size& i_imageSize)
+{
+    int tileSize = m_settings.tile_size;
+    if(0 < m_settings.maxMemory_bytes && 0 < m_settings.memory_bytesPerPixel) {
+        // Largest square tile whose activations fit in the cap, multiple of 32
+        const double maxPixels = static_cast<double>(m_settings.maxMemory_bytes) / m_settings.memory_bytesPerPixel;
+        int capSize = 32*(static_cast<int>(std::sqrt(maxPixels))/32);
+        capSize = std::max(capSize, 2*std::max(0, m_settings.tile_overlap) + 32);
+        tileSize = (0 < tileSize) ? std::min(tileSize, capSize) : capSize;
+    }
+    if(0 >= tileSize || (i_imageSize.width <= tileSize && i_imageSize.height <= tileSize)) {
+        return 0;
+    }
+    return tileSize;
+}
+
+size_t DeepImageMatting_Inference::get_maxBatchSize(const cv::Size& i_imageSize)
+{
+    if(0 == m_settings.maxMemory_bytes || 0 >= m_settings.memory_bytesPerPixel) {
+        return std::numeric_limits<size_t>::max();
+    }
+    const double imageBytes = static_cast<double>(i_imageSize.area()) * m_settings.memory_bytesPerPixel;
+    return std::max<size_t>(1, static_cast<size_t>(m_settings.maxMemory_bytes / imageBytes));
+}
+
+int DeepImageMatting_Inference::run_tiled(const cv::Mat& i_image, const cv::Mat& i_trimap, cv::Mat& o_alpha_prediction,
+                                          bool i_isBGR, int i_tileSize)
+{
+    const int rows = i_image.rows;
+    const int cols = i_image.cols;
+    const int overlap = std::max(0, std::min(m_settings.tile_overlap, i_tileSize/2));
+    const cv::Size tileSize(std::min(i_tileSize, cols), std::min(i_tileSize, rows));
+
+    // Tiles of the same size, the last ones of each row and column are aligned on the image border
+    auto get_origins = [overlap](int i_length, int i_tileLength) {
+        std::vector<int> origins;
+        const int step = std::max(1, i_tileLength - overlap);
+        for(int origin = 0 ; ; origin += step) {
+            if(origin + i_tileLength >= i_length) {
+                origins.push_back(std::max(0, i_length - i_tileLength));
+                break;
+            }
+            origins.push_back(origin);
+        }
+        return origins;
+    };
+    m_tiles.clear();
+    for(int y : get_origins(rows, tileSize.height)) {
+        for(int x : get_origins(cols, tileSize.width)) {
+            m_tiles.push_back(cv::Rect(cv::Point(x, y), tileSize));
+        }
+    }
+
+    // Feathering : weights ramp up over the overlap from the tile borders, except on the image borders.
+    // Per axis, a tile has one of 4 ramps depending on which of its borders are inside the image : the weights of
+    // the 16 combinations are computed the first time they are needed, and kept while the tile size is the same
+    if(m_tileWeights_tileSize != tileSize || m_tileWeights_overlap != overlap) {
+        for(auto& tileWeight : m_tileWeights) {
+            tileWeight.release();
+        }
+        m_tileWeights_tileSize = tileSize;
+        m_tileWeights_overlap = overlap;
+    }
+    // Bit 0 : ramp at the start, bit 1 : ramp at the end
+    auto get_ramps = [](int i_origin, int i_tileLength, int i_length) {
+        return ((0 < i_origin) ? 1 : 0) | ((i_origin + i_tileLength < i_length) ? 2 : 0);
+    };
+    auto get_ramp = [overlap](int i_ramps, int i_tileLength) {
+        cv::Mat ramp(1, i_tileLength, CV_32F, cv::Scalar(1.f));
+        float* weights = ramp.ptr<float>();
+        for(int i = 0 ; i < overlap && i < i_tileLength ; ++i) {
+            const float weight = (i + 0.5f) / overlap;
+            if(0 != (i_ramps & 1)) {
+                weights[i] = std::min(weights[i], weight);
+            }
+            if(0 != (i_ramps & 2)) {
+                weights[i_tileLength - 1 - i] = std::min(weights[i_tileLength - 1 - i], weight);
+            }
+        }
+        return ramp;
+    };
+
+    // Accumulate the weighted alpha of the tiles, a batch of tiles at a time
+    m_alphaSum.create(rows, cols, CV_32F);
+    m_alphaSum.setTo(0);
+    m_weightSum.create(rows, cols, CV_32F);
+    m_weightSum.setTo(0);
+    const size_t batchSize = get_maxBatchSize(tileSize);
+    std::vector<cv::Mat> images, trimaps;
+    for(size_t first = 0 ; first < m_tiles.size() ; first += batchSize) {
+        const size_t last = std::min(m_tiles.size(), first + batchSize);
+        images.clear();
+        trimaps.clear();
+        for(size_t t = first ; t < last ; ++t) {
+            images.push_back(i_image(m_tiles[t]));
+            trimaps.push_back(i_trimap(m_tiles[t]));
+        }
+        if(0 > forward(images, trimaps, m_tileAlphas, i_isBGR)) {
+            logging_error("forward() failed.");
+            return -1;
+        }
+        for(size_t t = first ; t < last ; ++t) {
+            const cv::Rect& tile = m_tiles[t];
+            const int rampsX = get_ramps(tile.x, tile.width, cols);
+            const int rampsY = get_ramps(tile.y, tile.height, rows);
+            cv::Mat& tileWeight = m_tileWeights[4*rampsY + rampsX];
+            if(tileWeight.empty()) {
+                // /!\ Dynamic alloc, only when the tile size changes
+                tileWeight = get_ramp(rampsY, tile.height).t() * get_ramp(rampsX, tile.width);
+            }
+            cv::Mat alphaSum = m_alphaSum(tile);
+            cv::accumulateProduct(m_tileAlphas[t - first], tileWeight, alphaSum);
+            cv::Mat weightSum = m_weightSum(tile);
+            cv::add(weightSum, tileWeight, weightSum);
+        }
+    }
+
+    cv::divide(m_alphaSum, m_weightSum, o_alpha_prediction, 1., CV_32F);
 
     return 0;
 }
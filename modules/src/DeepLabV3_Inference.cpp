@@ -10,11 +10,17 @@
 /*============================================================================*/
 /* Includes                                                                   */
 /*============================================================================*/
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <iomanip>
 #include <typeinfo>
 
 #include "Utils_Logging.hpp"
+#include "Utils_ModelRegistry.hpp"
+#include "Utils_CpuFeatures.hpp"
+
+#include "Utils_Preprocessing.hpp"
 
 #include "DeepLabV3_Inference.hpp"
 
@@ -30,11 +36,42 @@ namespace VBGE {
 DeepLabV3_Inference::DeepLabV3_Inference(const DeepLabV3_Inference_Settings& i_settings)
     : m_settings(i_settings)
 {
-    m_model = torch::jit::load(m_settings.model_path, m_settings.inferenceDeviceType);
+    if(InferencePrecision::INT8 == m_settings.precision && torch::kCPU != m_settings.inferenceDeviceType) {
+        logging_error("InferencePrecision::INT8 only runs on torch::kCPU.");
+        return;
+    }
+    if(0.f >= m_settings.segmentation_scale || 1.f < m_settings.segmentation_scale) {
+        logging_error("m_settings.segmentation_scale (" << m_settings.segmentation_scale << ") must be in ]0, 1].");
+        return;
+    }
+    m_precision = get_supportedPrecision(m_settings.precision, m_settings.inferenceDeviceType);
+    if(m_precision != m_settings.precision) {
+        logging_info("This CPU has no native bfloat16, the network runs in FP32.");
+    }
+    m_model = ModelRegistry::get_instance().get_model(get_modelRequest(m_settings));
+    if(!m_model) {
+        logging_error("Failed to load the model.");
+        return;
+    }
 
     m_isInitialized = true;
 }
 
+ModelRegistry::Request DeepLabV3_Inference::get_modelRequest(const DeepLabV3_Inference_Settings& i_settings)
+{
+    const bool isQuantized = (InferencePrecision::INT8 == i_settings.precision);
+    ModelRegistry::Request request;
+    request.path = isQuantized ? i_settings.quantized_model_path : i_settings.model_path;
+    request.device = i_settings.inferenceDeviceType;
+    request.isQuantized = isQuantized;
+    if(InferencePrecision::BF16 == get_supportedPrecision(i_settings.precision, i_settings.inferenceDeviceType)) {
+        request.dtype = torch::kBFloat16;
+    }
+    request.optimize = i_settings.enable_optimizeForInference;
+    request.cacheDirectory = i_settings.optimizedModel_cacheDirectory;
+    return request;
+}
+
 DeepLabV3_Inference::~DeepLabV3_Inference()
 {
 
@@ -44,58 +81,237 @@ bool DeepLabV3_Inference::get_isInitialized() {
     return m_isInitialized;
 }
 
-int DeepLabV3_Inference::run(const cv::Mat& i_image, cv::Mat& o_segmentation)
+int DeepLabV3_Inference::run(const cv::Mat& i_image, cv::Mat& o_segmentation, bool i_isBGR)
 {
-    if(false == get_isInitialized()) {
-        logging_error("This instance was not correctly initialized.");
-        return -1;
-    }
-    if(CV_32FC3 != i_image.type()) {
-        logging_error("CV_32FC3 != i_image.type()");
+    // Share o_segmentation so its buffer is reused
+    std::vector<cv::Mat> segmentations(1, o_segmentation);
+    if(0 > run(std::vector<cv::Mat>(1, i_image), segmentations, i_isBGR)) {
         return -1;
     }
+    o_segmentation = segmentations[0];
 
-    // Normalize input image
-    cv::Scalar meanValues(m_settings.model_mean);
-    cv::Scalar stdValues(m_settings.model_std);
-    cv::Mat imageNormalized = (i_image - meanValues)/stdValues;
+    return 0;
+}
 
+int DeepLabV3_Inference::run(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& o_segmentations, bool i_isBGR)
+{
     // We don't want to save the gradients during net.forward()
-    torch::NoGradGuard no_grad_guard;
-
-    // Prepare Input
-    // Encapsulate i_src in a tensor (no deep copy) with OpenCV format NHWC
-    std::vector<int64_t> srcSize = {1, i_image.rows, i_image.cols, i_image.channels()};
-    std::vector<int64_t> srcStride = {1, static_cast<int64_t>(i_image.step1()), i_image.channels(), 1};
-    torch::Tensor srcTensor_NHWC = torch::from_blob(i_image.data, srcSize, srcStride, torch::kCPU);
-    // Permute format NHWC (OpenCV) to NCHW (PyTorch) (no deep copy)
-    torch::Tensor inputTensor_NCHW = srcTensor_NHWC.permute({0, 3, 1, 2}).to(m_settings.inferenceDeviceType);
+    InferenceGuard inference_guard;
 
-    // Inference
-    std::vector<torch::jit::IValue> inputs;
-    inputs.push_back(inputTensor_NCHW);
-    // /!\ Dynamic alloc
-    torch::Tensor neuralNet_outputTensor_NCHW = m_model.forward(inputs).toTensor().squeeze(0); // Squeeze => remove first dimension, which was Batch size (=1)
+    torch::Tensor neuralNet_outputTensor_NCHW;
+    if(0 > forward(i_images, i_isBGR, neuralNet_outputTensor_NCHW)) {
+        logging_error("forward() failed.");
+        return -1;
+    }
+    const int64_t batchSize = neuralNet_outputTensor_NCHW.sizes()[0];
 
     // Get the ID of the class with the max score
-    torch::Tensor output_predictions = neuralNet_outputTensor_NCHW.argmax(0);
+    torch::Tensor output_predictions = neuralNet_outputTensor_NCHW.argmax(1);
     // Convert from int64 to int32 to ease usage with OpenCV (there is no CV_64S)
     output_predictions = output_predictions.toType(torch::kInt32).to(torch::kCPU); // /!\ Dynamic alloc
 
     // Prepare output
-    int height = output_predictions.sizes()[0];
-    int width = output_predictions.sizes()[1];
-    o_segmentation.create(height, width, CV_32S); // /!\ Dynamic alloc
-    std::vector<int64_t> dstSize = {o_segmentation.rows, o_segmentation.cols};
-    std::vector<int64_t> dstStride = {static_cast<int64_t>(o_segmentation.step1()), 1};
+    // Each output keeps its buffer when it already has the right size and type
+    const int height = output_predictions.sizes()[1];
+    const int width = output_predictions.sizes()[2];
+    const bool isRescaled = (i_images[0].size() != cv::Size(width, height));
+    std::vector<cv::Mat>& segmentations = isRescaled ? m_resizedOutputs : o_segmentations;
     torch::TensorOptions options;
     options = options.dtype(torch::kInt32);
     options = options.device(torch::kCPU);
-    torch::Tensor segmentationTensor = torch::from_blob(o_segmentation.data, dstSize, dstStride, options);
-    // Copy neuralNet_outputTensor_NHWC to outputTensor_NHWC
-    segmentationTensor.copy_(output_predictions, true);
+    segmentations.resize(batchSize);
+    for(int64_t n = 0 ; n < batchSize ; ++n) {
+        cv::Mat& segmentation = segmentations[n];
+        segmentation.create(height, width, CV_32S); // /!\ Dynamic alloc, only when the size changes
+        std::vector<int64_t> dstSize = {segmentation.rows, segmentation.cols};
+        std::vector<int64_t> dstStride = {static_cast<int64_t>(segmentation.step1()), 1};
+        torch::Tensor segmentationTensor = torch::from_blob(segmentation.data, dstSize, dstStride, options);
+        // Copy output_predictions to segmentationTensor
+        segmentationTensor.copy_(output_predictions[n]);
+    }
+
+    // Classes can not be interpolated
+    if(isRescaled) {
+        o_segmentations.resize(batchSize);
+        for(int64_t n = 0 ; n < batchSize ; ++n) {
+            cv::resize(m_resizedOutputs[n], o_segmentations[n], i_images[0].size(), 0, 0, cv::INTER_NEAREST);
+        }
+    }
 
     return 0;
 }
 
+int DeepLabV3_Inference::run_backgroundMask(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& o_backgroundMasks, bool i_isBGR)
+{
+    // We don't want to save the gradients during net.forward()
+    InferenceGuard inference_guard;
+
+    torch::Tensor neuralNet_outputTensor_NCHW;
+    if(0 > forward(i_images, i_isBGR, neuralNet_outputTensor_NCHW)) {
+        logging_error("forward() failed.");
+        return -1;
+    }
+    const int64_t batchSize = neuralNet_outputTensor_NCHW.sizes()[0];
+    const int64_t nbClasses = neuralNet_outputTensor_NCHW.sizes()[1];
+    const int height = neuralNet_outputTensor_NCHW.sizes()[2];
+    const int width = neuralNet_outputTensor_NCHW.sizes()[3];
+
+    // Split the classes between background and foreground, only when the model changes
+    if(m_nbClasses != nbClasses) {
+        std::vector<int64_t> backgroundIds;
+        std::vector<int64_t> foregroundIds;
+        for(int64_t id = 0 ; id < nbClasses ; ++id) {
+            const auto& ids = m_settings.background_classId_vector;
+            if(ids.end() != std::find(ids.begin(), ids.end(), id)) {
+                backgroundIds.push_back(id);
+            } else {
+                foregroundIds.push_back(id);
+            }
+        }
+        if(backgroundIds.size() != m_settings.background_classId_vector.size()) {
+            logging_error("background_classId_vector contains ids which are not classes of the model (" << nbClasses << " classes).");
+            return -1;
+        }
+        auto options = torch::TensorOptions().dtype(torch::kInt64);
+        m_backgroundIds = torch::tensor(backgroundIds, options).to(m_settings.inferenceDeviceType);
+        m_foregroundIds = torch::tensor(foregroundIds, options).to(m_settings.inferenceDeviceType);
+        m_nbClasses = nbClasses;
+    }
+
+    const bool isRescaled = (i_images[0].size() != cv::Size(width, height));
+    if(0 == m_foregroundIds.numel()) {
+        o_backgroundMasks.resize(batchSize);
+        for(auto& backgroundMask : o_backgroundMasks) {
+            backgroundMask.create(i_images[0].size(), CV_8U); // /!\ Dynamic alloc, only when the size changes
+            backgroundMask.setTo(255);
+        }
+        return 0;
+    }
+    std::vector<cv::Mat>& backgroundMasks = isRescaled ? m_resizedOutputs : o_backgroundMasks;
+    backgroundMasks.resize(batchSize);
+    for(auto& backgroundMask : backgroundMasks) {
+        backgroundMask.create(height, width, CV_8U); // /!\ Dynamic alloc, only when the size changes
+    }
+
+    // Reduce by chunks of rows : the temporaries hold at most N x nbClasses x chunkRows x W scores
+    const int chunkRows = (0 >= m_settings.backgroundMask_chunkRows) ? height : std::min(height, m_settings.backgroundMask_chunkRows);
+    torch::TensorOptions options;
+    options = options.dtype(torch::kUInt8);
+    options = options.device(torch::kCPU);
+    for(int y = 0 ; y < height ; y += chunkRows) {
+        const int rows = std::min(chunkRows, height - y);
+        torch::Tensor scores = neuralNet_outputTensor_NCHW.narrow(2, y, rows);
+        // Best score of each group of classes and its class, NHW. Both id lists are sorted : on a tie within a group,
+        // max() keeps the first, which is the lowest id
+        auto background = scores.index_select(1, m_backgroundIds).max(1);
+        auto foreground = scores.index_select(1, m_foregroundIds).max(1);
+        const torch::Tensor& backgroundScore = std::get<0>(background);
+        const torch::Tensor& foregroundScore = std::get<0>(foreground);
+        // Ties between the groups go to the lowest class id, as argmax() does in run()
+        torch::Tensor isBackground = backgroundScore.gt(foregroundScore).logical_or_(
+            backgroundScore.eq(foregroundScore).logical_and_(
+                m_backgroundIds.take(std::get<1>(background)).lt(m_foregroundIds.take(std::get<1>(foreground)))));
+        // 255 for background, 0 for foreground
+        torch::Tensor masks = isBackground.to(torch::kUInt8).mul_(255).to(torch::kCPU);
+        for(int64_t n = 0 ; n < batchSize ; ++n) {
+            cv::Mat backgroundMask = backgroundMasks[n].rowRange(y, y + rows);
+            std::vector<int64_t> dstSize = {backgroundMask.rows, backgroundMask.cols};
+            std::vector<int64_t> dstStride = {static_cast<int64_t>(backgroundMask.step1()), 1};
+            torch::Tensor dstTensor = torch::from_blob(backgroundMask.data, dstSize, dstStride, options);
+            dstTensor.copy_(masks[n]);
+        }
+    }
+
+    // Back to the input resolution, the edges follow the ones of the image
+    if(isRescaled) {
+        o_backgroundMasks.resize(batchSize);
+        for(int64_t n = 0 ; n < batchSize ; ++n) {
+            if(0 > m_guidedUpsampling.run(i_images[n], i_isBGR, m_resizedOutputs[n], m_settings.segmentation_guidedRadius,
+                                          m_settings.segmentation_guidedEps, o_backgroundMasks[n])) {
+                logging_error("m_guidedUpsampling.run() failed.");
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int DeepLabV3_Inference::forward(const std::vector<cv::Mat>& i_images, bool i_isBGR, torch::Tensor& o_outputTensor)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    if(i_images.empty()) {
+        logging_error("i_images is empty.");
+        return -1;
+    }
+    for(auto& image : i_images) {
+        if(CV_8UC3 != image.type() && CV_32FC3 != image.type()) {
+            logging_error("CV_8UC3 != image.type() && CV_32FC3 != image.type()");
+            return -1;
+        }
+        if(i_images[0].size() != image.size() || i_images[0].type() != image.type()) {
+            logging_error("All images of the batch must have the same size and type.");
+            return -1;
+        }
+    }
+
+    // Rescale, the images keep their type. A scale of 1/k on a size multiple of k is done by the preprocessing,
+    // in the same pass as the normalization. Other scales are resized first
+    const std::vector<cv::Mat>* images = &i_images;
+    int downscale = 1;
+    if(1.f > m_settings.segmentation_scale) {
+        const int factor = cvRound(1.f / m_settings.segmentation_scale);
+        if(1e-3f > std::abs(1.f/factor - m_settings.segmentation_scale)
+           && 0 == i_images[0].cols % factor && 0 == i_images[0].rows % factor) {
+            downscale = factor;
+        } else {
+            const cv::Size size(std::max(1, cvRound(i_images[0].cols*m_settings.segmentation_scale)),
+                                std::max(1, cvRound(i_images[0].rows*m_settings.segmentation_scale)));
+            m_resizedImages.resize(i_images.size());
+            for(size_t n = 0 ; n < i_images.size() ; ++n) {
+                cv::resize(i_images[n], m_resizedImages[n], size, 0, 0, cv::INTER_AREA); // /!\ Dynamic alloc, only when the size changes
+            }
+            images = &m_resizedImages;
+        }
+    }
+
+    // Prepare Input
+    // Normalize and stack all images in a single tensor with PyTorch format NCHW, in one pass
+    const int64_t batchSize = images->size();
+    const int rows = (*images)[0].rows / downscale;
+    const int cols = (*images)[0].cols / downscale;
+    // In BF16, preprocessing writes bfloat16 directly, the input is never converted
+    const bool isBFloat16 = (InferencePrecision::BF16 == m_precision);
+    const torch::ScalarType inputType = isBFloat16 ? torch::kBFloat16 : torch::kFloat32;
+    if(false == m_inputTensor.defined() || false == m_inputTensor.sizes().equals({batchSize, 3, rows, cols})) {
+        m_inputTensor = torch::empty({batchSize, 3, rows, cols}, inputType); // /!\ Dynamic alloc, only when the size changes
+    }
+    const float scale = (CV_8U == i_images[0].depth()) ? 1.f/255.f : 1.f;
+    for(int64_t n = 0 ; n < batchSize ; ++n) {
+        void* planes = m_inputTensor[n].data_ptr();
+        const int result = isBFloat16
+                           ? preprocess_packedToPlanar((*images)[n], i_isBGR, scale, m_settings.model_mean, m_settings.model_std,
+                                                       static_cast<uint16_t*>(planes), downscale)
+                           : preprocess_packedToPlanar((*images)[n], i_isBGR, scale, m_settings.model_mean, m_settings.model_std,
+                                                       static_cast<float*>(planes), downscale);
+        if(0 > result) {
+            logging_error("preprocess_packedToPlanar() failed.");
+            return -1;
+        }
+    }
+    torch::Tensor inputTensor_NCHW = m_inputTensor.to(m_settings.inferenceDeviceType);
+
+    // Inference
+    std::vector<torch::jit::IValue> inputs;
+    inputs.push_back(inputTensor_NCHW);
+    // /!\ Dynamic alloc
+    o_outputTensor = m_model->forward(inputs).toTensor();
+
+    return 0;
+}
+
+
 } /* namespace VBGE */
@@ -0,0 +1,201 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_ImageDirectory.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Utils_Logging.hpp"
+
+#include "FrameSink_ImageDirectory.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+FrameSink_ImageDirectory::FrameSink_ImageDirectory(const FrameSink_ImageDirectory_Settings& i_settings)
+    : m_settings(i_settings)
+{
+    if(m_settings.directory_path.empty()) {
+        logging_error("m_settings.directory_path is empty.");
+        return;
+    }
+    // A bad path fails here rather than at the first frame
+    struct stat status;
+    if(0 != stat(m_settings.directory_path.c_str(), &status) || !S_ISDIR(status.st_mode)) {
+        logging_error(m_settings.directory_path << " is not a directory.");
+        return;
+    }
+    if(0 != access(m_settings.directory_path.c_str(), W_OK)) {
+        logging_error(m_settings.directory_path << " is not writable.");
+        return;
+    }
+
+    if(".png" == m_settings.extension) {
+        m_encoderParams = {cv::IMWRITE_PNG_COMPRESSION, m_settings.png_compression,
+                           cv::IMWRITE_PNG_STRATEGY, m_settings.png_strategy};
+    }
+
+    const int nbWorkers = std::max(1, m_settings.nbWorkers);
+    for(int i = 0 ; i < nbWorkers ; ++i) {
+        m_workers.push_back(std::thread(&FrameSink_ImageDirectory::worker_loop, this));
+    }
+
+    m_isInitialized = true;
+}
+
+FrameSink_ImageDirectory::~FrameSink_ImageDirectory()
+{
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_jobAvailable.notify_all();
+    for(auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+bool FrameSink_ImageDirectory::get_isInitialized()
+{
+    return m_isInitialized;
+}
+
+int FrameSink_ImageDirectory::write(int64_t i_index, cv::Mat&& io_image)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    if(io_image.empty()) {
+        logging_error("io_image is empty.");
+        return -1;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(false == m_hasStarted) {
+        m_hasStarted = true;
+        m_startTime = std::chrono::steady_clock::now();
+    }
+
+    // Backpressure : wait for the workers to catch up
+    const size_t maxPendingFrames = std::max(1, m_settings.maxPendingFrames);
+    m_jobDone.wait(lock, [this, maxPendingFrames]() {
+        return m_hasFailed || m_jobs.size() + m_nbJobsInProgress < maxPendingFrames;
+    });
+    if(m_hasFailed) {
+        logging_error("A previous write failed.");
+        return -1;
+    }
+
+    Job job;
+    job.index = i_index;
+    job.image = std::move(io_image);
+    m_jobs.push_back(std::move(job));
+    lock.unlock();
+    m_jobAvailable.notify_one();
+
+    return 0;
+}
+
+int FrameSink_ImageDirectory::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDone.wait(lock, [this]() {
+        return m_jobs.empty() && 0 == m_nbJobsInProgress;
+    });
+    return m_hasFailed ? -1 : 0;
+}
+
+FrameSink::Statistics FrameSink_ImageDirectory::get_statistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics = m_statistics;
+    if(0. < statistics.elapsedSeconds) {
+        statistics.framesPerSecond = statistics.nbFrames / statistics.elapsedSeconds;
+        statistics.megabytesPerSecond = statistics.nbBytes / (1024. * 1024. * statistics.elapsedSeconds);
+    }
+    return statistics;
+}
+
+void FrameSink_ImageDirectory::worker_loop()
+{
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this]() {
+                return m_stop || !m_jobs.empty();
+            });
+            if(m_jobs.empty()) {
+                // m_stop is set and there is nothing left to write
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_nbJobsInProgress;
+        }
+
+        const auto begin = std::chrono::steady_clock::now();
+        uint64_t nbBytes = 0;
+        const bool success = write_image(job, nbBytes);
+        const auto end = std::chrono::steady_clock::now();
+        // Release the image before signaling, so its memory is freed before new frames are accepted
+        job.image.release();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_nbJobsInProgress;
+            if(success) {
+                m_statistics.nbFrames++;
+                m_statistics.nbBytes += nbBytes;
+                m_statistics.encodeSeconds += std::chrono::duration<double>(end - begin).count();
+                m_statistics.elapsedSeconds = std::chrono::duration<double>(end - m_startTime).count();
+            } else {
+                m_hasFailed = true;
+            }
+        }
+        m_jobDone.notify_all();
+    }
+}
+
+bool FrameSink_ImageDirectory::write_image(const Job& i_job, uint64_t& o_nbBytes)
+{
+    std::ostringstream oss;
+    oss << m_settings.directory_path << "/" << std::setw(8) << std::setfill('0') << (i_job.index + m_settings.index_offset) << m_settings.extension;
+    const std::string path = oss.str();
+
+    // Encode in memory, then write in one go
+    std::vector<uchar> buffer;
+    if(false == cv::imencode(m_settings.extension, i_job.image, buffer, m_encoderParams)) {
+        logging_error("Failed to encode : " << path);
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    if(false == file.good()) {
+        logging_error("Failed to write : " << path);
+        return false;
+    }
+
+    o_nbBytes = buffer.size();
+    return true;
+}
+
+} /* namespace VBGE */
@@ -0,0 +1,337 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_Raw.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Utils_Logging.hpp"
+
+#include "FrameSink_Raw.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+static_assert(64 == sizeof(RawFileHeader), "RawFileHeader is part of the file format");
+static_assert(24 == sizeof(RawFrameEntry), "RawFrameEntry is part of the file format");
+// frameCount is stored through an atomic in the mapping, readers of other processes see plain memory : the atomic
+// must be the bare value, without a lock living in this process only
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "std::atomic<uint64_t> must have the size of uint64_t");
+static_assert(2 == ATOMIC_LLONG_LOCK_FREE, "std::atomic<uint64_t> must always be lock-free");
+
+const uint64_t g_pageSize = 4096;
+// Entries of the frame table per expected frame : the table can not grow, the frames can
+const uint64_t g_tableFactor = 4;
+
+uint64_t align_toPage(uint64_t i_size)
+{
+    return (i_size + g_pageSize - 1) / g_pageSize * g_pageSize;
+}
+
+// Write a whole buffer to a file descriptor, retrying on partial writes
+bool write_all(int i_file, const uchar* i_data, size_t i_size)
+{
+    while(0 < i_size) {
+        const ssize_t written = ::write(i_file, i_data, i_size);
+        if(0 > written) {
+            if(EINTR == errno) {
+                continue;
+            }
+            return false;
+        }
+        i_data += written;
+        i_size -= written;
+    }
+    return true;
+}
+
+} /* namespace */
+
+FrameSink_Raw::FrameSink_Raw(const FrameSink_Raw_Settings& i_settings)
+    : m_settings(i_settings)
+{
+    if(m_settings.path.empty()) {
+        logging_error("m_settings.path is empty.");
+        return;
+    }
+
+    m_isStdout = ("-" == m_settings.path);
+    if(m_isStdout) {
+        // The logs go to the standard error, the standard output only carries frames
+        std::cout.flush();
+        m_coutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+    } else if(0 >= m_settings.maxFrames) {
+        logging_error("m_settings.maxFrames (" << m_settings.maxFrames << ") must be positive.");
+        return;
+    }
+
+    m_isInitialized = true;
+}
+
+FrameSink_Raw::~FrameSink_Raw()
+{
+    if(nullptr != m_map) {
+        // Only the written frames are kept
+        const uint64_t frameCount = reinterpret_cast<std::atomic<uint64_t>*>(&m_header->frameCount)->load();
+        const off_t size = m_header->headerSize + frameCount*m_header->frameStride;
+        munmap(m_map, m_mapSize);
+        if(0 != ftruncate(m_file, size)) {
+            logging_error("Failed to truncate " << m_settings.path << " : " << std::strerror(errno));
+        }
+    }
+    if(0 <= m_file) {
+        close(m_file);
+    }
+    if(nullptr != m_coutBuffer) {
+        std::cout.rdbuf(m_coutBuffer);
+    }
+}
+
+bool FrameSink_Raw::get_isInitialized()
+{
+    return m_isInitialized;
+}
+
+int FrameSink_Raw::write(int64_t i_index, cv::Mat&& io_image)
+{
+    return write(i_index, -1., std::move(io_image));
+}
+
+int FrameSink_Raw::write(int64_t i_index, double i_timestamp_ms, cv::Mat&& io_image)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    if(CV_8UC4 != io_image.type()) {
+        logging_error("CV_8UC4 != io_image.type()");
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_hasFailed) {
+        logging_error("A previous write failed.");
+        return -1;
+    }
+    const auto begin = std::chrono::steady_clock::now();
+    if(false == m_hasStarted) {
+        m_hasStarted = true;
+        m_startTime = begin;
+    }
+
+    uint64_t nbBytes = 0;
+    const bool success = m_isStdout ? write_stdout(io_image, nbBytes) : write_file(i_index, i_timestamp_ms, io_image, nbBytes);
+    // The frame is copied, its buffer goes back to its owner
+    io_image.release();
+    if(false == success) {
+        m_hasFailed = true;
+        return -1;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    m_statistics.nbFrames++;
+    m_statistics.nbBytes += nbBytes;
+    m_statistics.encodeSeconds += std::chrono::duration<double>(end - begin).count();
+    m_statistics.elapsedSeconds = std::chrono::duration<double>(end - m_startTime).count();
+
+    return 0;
+}
+
+int FrameSink_Raw::flush()
+{
+    // Frames are written synchronously : in the page cache once write() returns, and visible to the readers of the mapping
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hasFailed ? -1 : 0;
+}
+
+FrameSink::Statistics FrameSink_Raw::get_statistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics = m_statistics;
+    if(0. < statistics.elapsedSeconds) {
+        statistics.framesPerSecond = statistics.nbFrames / statistics.elapsedSeconds;
+        statistics.megabytesPerSecond = statistics.nbBytes / (1024. * 1024. * statistics.elapsedSeconds);
+    }
+    return statistics;
+}
+
+bool FrameSink_Raw::create_file(const cv::Size& i_size)
+{
+    const uint64_t nbFrames = m_settings.maxFrames;
+    const uint64_t capacity = g_tableFactor*nbFrames;
+    const uint64_t headerSize = align_toPage(sizeof(RawFileHeader) + capacity*sizeof(RawFrameEntry));
+    const uint64_t frameSize = static_cast<uint64_t>(i_size.width) * i_size.height * 4;
+    const uint64_t frameStride = align_toPage(frameSize);
+    const uint64_t fileSize = headerSize + nbFrames*frameStride;
+
+    m_file = open(m_settings.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(0 > m_file) {
+        logging_error("Failed to open " << m_settings.path << " : " << std::strerror(errno));
+        return false;
+    }
+    if(0 != ftruncate(m_file, fileSize)) {
+        logging_error("Failed to resize " << m_settings.path << " to " << fileSize << " bytes : " << std::strerror(errno));
+        return false;
+    }
+    if(m_settings.enable_preallocation) {
+        const int result = posix_fallocate(m_file, 0, fileSize);
+        if(0 != result) {
+            logging_error("Failed to reserve " << fileSize << " bytes for " << m_settings.path << " : " << std::strerror(result));
+            return false;
+        }
+    }
+    void* map = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    if(MAP_FAILED == map) {
+        logging_error("Failed to map " << m_settings.path << " : " << std::strerror(errno));
+        return false;
+    }
+    m_map = static_cast<uchar*>(map);
+    m_mapSize = fileSize;
+    m_size = i_size;
+
+    // The header is complete before the first frame is published
+    m_header = reinterpret_cast<RawFileHeader*>(m_map);
+    m_entries = reinterpret_cast<RawFrameEntry*>(m_map + sizeof(RawFileHeader));
+    std::memcpy(m_header->magic, "VBGERAW1", sizeof(m_header->magic));
+    m_header->version = 1;
+    m_header->headerSize = static_cast<uint32_t>(headerSize);
+    m_header->width = i_size.width;
+    m_header->height = i_size.height;
+    m_header->channels = 4;
+    std::memcpy(m_header->layout, m_settings.isBGR ? "BGRA" : "RGBA", sizeof(m_header->layout));
+    m_header->frameSize = frameSize;
+    m_header->frameStride = frameStride;
+    m_header->capacity = capacity;
+    reinterpret_cast<std::atomic<uint64_t>*>(&m_header->frameCount)->store(0, std::memory_order_release);
+
+    logging_info("Writing " << m_settings.path << " : " << nbFrames << " frames of " << i_size << ", " << fileSize
+                 << " bytes, up to " << capacity << " frames");
+    return true;
+}
+
+bool FrameSink_Raw::grow_file()
+{
+    // Doubles the frames, up to the capacity of the frame table
+    const uint64_t nbFrames = (m_mapSize - m_header->headerSize) / m_header->frameStride;
+    const uint64_t nbFrames_new = std::min<uint64_t>(m_header->capacity, 2*nbFrames);
+    const uint64_t fileSize = m_header->headerSize + nbFrames_new*m_header->frameStride;
+    if(0 != ftruncate(m_file, fileSize)) {
+        logging_error("Failed to resize " << m_settings.path << " to " << fileSize << " bytes : " << std::strerror(errno));
+        return false;
+    }
+    if(m_settings.enable_preallocation) {
+        const int result = posix_fallocate(m_file, m_mapSize, fileSize - m_mapSize);
+        if(0 != result) {
+            logging_error("Failed to reserve " << fileSize << " bytes for " << m_settings.path << " : " << std::strerror(result));
+            return false;
+        }
+    }
+    // The written frames are already in the file, the new mapping sees them
+    munmap(m_map, m_mapSize);
+    m_header = nullptr;
+    m_entries = nullptr;
+    void* map = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+    if(MAP_FAILED == map) {
+        m_map = nullptr;
+        logging_error("Failed to map " << m_settings.path << " : " << std::strerror(errno));
+        return false;
+    }
+    m_map = static_cast<uchar*>(map);
+    m_mapSize = fileSize;
+    m_header = reinterpret_cast<RawFileHeader*>(m_map);
+    m_entries = reinterpret_cast<RawFrameEntry*>(m_map + sizeof(RawFileHeader));
+
+    logging_info("Growing " << m_settings.path << " to " << nbFrames_new << " frames, " << fileSize << " bytes");
+    return true;
+}
+
+bool FrameSink_Raw::write_file(int64_t i_index, double i_timestamp_ms, const cv::Mat& i_image, uint64_t& o_nbBytes)
+{
+    if(nullptr == m_map && false == create_file(i_image.size())) {
+        return false;
+    }
+    if(m_size != i_image.size()) {
+        logging_error("Frame " << i_index << " is " << i_image.size() << ", the file is " << m_size);
+        return false;
+    }
+    std::atomic<uint64_t>& frameCount = *reinterpret_cast<std::atomic<uint64_t>*>(&m_header->frameCount);
+    const uint64_t n = frameCount.load(std::memory_order_relaxed);
+    if(n >= m_header->capacity) {
+        logging_error(m_settings.path << " is full, " << m_header->capacity << " frames (see FrameSink_Raw_Settings::maxFrames).");
+        return false;
+    }
+    const uint64_t offset = m_header->headerSize + n*m_header->frameStride;
+    if(offset + m_header->frameStride > m_mapSize && false == grow_file()) {
+        return false;
+    }
+
+    // Frame, then its entry, then the count : readers never see a frame before it is complete
+    uchar* frame = m_map + offset;
+    const size_t rowSize = i_image.cols * i_image.elemSize();
+    if(i_image.isContinuous()) {
+        std::memcpy(frame, i_image.data, m_header->frameSize);
+    } else {
+        for(int y = 0 ; y < i_image.rows ; ++y) {
+            std::memcpy(frame + y*rowSize, i_image.ptr(y), rowSize);
+        }
+    }
+    RawFrameEntry& entry = m_entries[n];
+    entry.offset = offset;
+    entry.index = i_index;
+    entry.timestamp_ms = i_timestamp_ms;
+    frameCount.store(n + 1, std::memory_order_release);
+
+    o_nbBytes = m_header->frameSize;
+    return true;
+}
+
+bool FrameSink_Raw::write_stdout(const cv::Mat& i_image, uint64_t& o_nbBytes)
+{
+    if(m_size.area() == 0) {
+        m_size = i_image.size();
+        logging_info("Streaming " << m_size << " " << (m_settings.isBGR ? "bgra" : "rgba") << " frames on the standard output, read them with : "
+                     << "ffmpeg -f rawvideo -pix_fmt " << (m_settings.isBGR ? "bgra" : "rgba") << " -s " << m_size.width << "x" << m_size.height << " -i -");
+    }
+    if(m_size != i_image.size()) {
+        logging_error("The frame is " << i_image.size() << ", the stream is " << m_size);
+        return false;
+    }
+
+    const size_t rowSize = i_image.cols * i_image.elemSize();
+    bool success = true;
+    if(i_image.isContinuous()) {
+        success = write_all(STDOUT_FILENO, i_image.data, rowSize*i_image.rows);
+    } else {
+        for(int y = 0 ; y < i_image.rows && success ; ++y) {
+            success = write_all(STDOUT_FILENO, i_image.ptr(y), rowSize);
+        }
+    }
+    if(false == success) {
+        logging_error("Failed to write on the standard output : " << std::strerror(errno));
+        return false;
+    }
+
+    o_nbBytes = rowSize*i_image.rows;
+    return true;
+}
+
+} /* namespace VBGE */
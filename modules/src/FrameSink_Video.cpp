@@ -0,0 +1,340 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        FrameSink_Video.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <pthread.h>
+#endif
+
+#include "Utils_Logging.hpp"
+
+#include "FrameSink_Video.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+// Single quoted for the shell
+std::string quote(const std::string& i_argument)
+{
+    std::string quoted = "'";
+    for(char c : i_argument) {
+        if('\'' == c) {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+// Encoder and pixel format of the video, for a codec
+void get_encoder(VideoCodec i_codec, bool i_isAlpha, std::string& o_encoder, std::string& o_pixelFormat)
+{
+    switch(i_codec) {
+    case VideoCodec::PNG:
+        o_encoder = "png";
+        o_pixelFormat = i_isAlpha ? "gray" : "rgba";
+        break;
+    case VideoCodec::FFV1:
+        o_encoder = "ffv1 -level 3";
+        o_pixelFormat = i_isAlpha ? "gray" : "bgra";
+        break;
+    default:
+        o_encoder = "qtrle";
+        o_pixelFormat = i_isAlpha ? "gray" : "argb";
+        break;
+    }
+}
+
+// FFmpeg command line reading raw frames on its standard input
+std::string get_command(const FrameSink_Video_Settings& i_settings, const cv::Size& i_size, bool i_isAlpha)
+{
+    std::string encoder, pixelFormat;
+    get_encoder(i_settings.codec, i_isAlpha, encoder, pixelFormat);
+    std::ostringstream command;
+    command << quote(i_settings.ffmpeg_path) << " -hide_banner -loglevel error -y"
+            << " -f rawvideo -pix_fmt " << (i_isAlpha ? "gray" : (i_settings.isBGR ? "bgra" : "rgba"))
+            << " -s " << i_size.width << "x" << i_size.height
+            << " -framerate " << std::setprecision(12) << i_settings.fps << " -i -"
+            << " -an -c:v " << encoder << " -pix_fmt " << pixelFormat
+            << " " << quote(i_isAlpha ? i_settings.alpha_path : i_settings.path);
+    return command.str();
+}
+
+bool write_plane(FILE* io_pipe, const cv::Mat& i_plane, uint64_t& io_nbBytes)
+{
+    const size_t rowSize = i_plane.cols * i_plane.elemSize();
+    if(i_plane.isContinuous()) {
+        const size_t size = rowSize * i_plane.rows;
+        io_nbBytes += size;
+        return size == std::fwrite(i_plane.data, 1, size, io_pipe);
+    }
+    for(int y = 0 ; y < i_plane.rows ; ++y) {
+        if(rowSize != std::fwrite(i_plane.ptr(y), 1, rowSize, io_pipe)) {
+            return false;
+        }
+        io_nbBytes += rowSize;
+    }
+    return true;
+}
+
+} /* namespace */
+
+FrameSink_Video::FrameSink_Video(const FrameSink_Video_Settings& i_settings)
+    : m_settings(i_settings)
+{
+    if(m_settings.path.empty()) {
+        logging_error("m_settings.path is empty.");
+        return;
+    }
+    if(0. >= m_settings.fps) {
+        logging_error("m_settings.fps (" << m_settings.fps << ") must be positive.");
+        return;
+    }
+
+    m_thread = std::thread(&FrameSink_Video::encode_loop, this);
+
+    m_isInitialized = true;
+}
+
+FrameSink_Video::~FrameSink_Video()
+{
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_jobAvailable.notify_all();
+    if(m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool FrameSink_Video::get_isInitialized()
+{
+    return m_isInitialized;
+}
+
+int FrameSink_Video::write(int64_t i_index, cv::Mat&& io_image)
+{
+    return write(i_index, -1., std::move(io_image));
+}
+
+int FrameSink_Video::write(int64_t i_index, double i_timestamp_ms, cv::Mat&& io_image)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    if(CV_8UC4 != io_image.type()) {
+        logging_error("CV_8UC4 != io_image.type()");
+        return -1;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(false == m_hasStarted) {
+        m_hasStarted = true;
+        m_startTime = std::chrono::steady_clock::now();
+    }
+
+    // Backpressure : wait for the encoder to catch up
+    const size_t maxPendingFrames = std::max(1, m_settings.maxPendingFrames);
+    m_jobDone.wait(lock, [this, maxPendingFrames]() {
+        return m_hasFailed || m_jobs.size() + (m_isJobInProgress ? 1 : 0) < maxPendingFrames;
+    });
+    if(m_hasFailed) {
+        logging_error("A previous write failed.");
+        return -1;
+    }
+
+    Job job;
+    job.index = i_index;
+    job.timestamp_ms = i_timestamp_ms;
+    job.image = std::move(io_image);
+    m_jobs.push_back(std::move(job));
+    lock.unlock();
+    m_jobAvailable.notify_one();
+
+    return 0;
+}
+
+int FrameSink_Video::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobDone.wait(lock, [this]() {
+        return m_jobs.empty() && false == m_isJobInProgress;
+    });
+    return m_hasFailed ? -1 : 0;
+}
+
+FrameSink::Statistics FrameSink_Video::get_statistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics = m_statistics;
+    if(0. < statistics.elapsedSeconds) {
+        statistics.framesPerSecond = statistics.nbFrames / statistics.elapsedSeconds;
+        statistics.megabytesPerSecond = statistics.nbBytes / (1024. * 1024. * statistics.elapsedSeconds);
+    }
+    return statistics;
+}
+
+void FrameSink_Video::encode_loop()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    // An encoder which exits closes its pipe : fwrite() then fails with EPIPE instead of the process being killed
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this]() {
+                return m_stop || !m_jobs.empty();
+            });
+            if(m_jobs.empty()) {
+                // m_stop is set and there is nothing left to write
+                break;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_isJobInProgress = true;
+        }
+
+        const auto begin = std::chrono::steady_clock::now();
+        uint64_t nbBytes = 0;
+        bool success = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            success = (false == m_hasFailed);
+        }
+        // After a failure, the remaining frames are dropped
+        if(success) {
+            success = encode_image(job, nbBytes);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        // Release the image before signaling, so its memory is freed before new frames are accepted
+        job.image.release();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isJobInProgress = false;
+            if(success) {
+                m_statistics.nbFrames++;
+                m_statistics.nbBytes += nbBytes;
+                m_statistics.encodeSeconds += std::chrono::duration<double>(end - begin).count();
+                m_statistics.elapsedSeconds = std::chrono::duration<double>(end - m_startTime).count();
+            } else {
+                m_hasFailed = true;
+            }
+        }
+        m_jobDone.notify_all();
+    }
+
+    if(false == close_encoders()) {
+        logging_error("Failed to finalize " << m_settings.path);
+    }
+}
+
+bool FrameSink_Video::encode_image(const Job& i_job, uint64_t& o_nbBytes)
+{
+    if(nullptr == m_video && false == open_encoders(i_job.image.size())) {
+        return false;
+    }
+    if(m_size != i_job.image.size()) {
+        logging_error("Frame " << i_job.index << " is " << i_job.image.size() << ", the video is " << m_size);
+        return false;
+    }
+
+    if(0 > m_firstIndex) {
+        m_firstIndex = i_job.index;
+        m_firstTimestamp_ms = i_job.timestamp_ms;
+    } else if(i_job.index <= m_lastIndex) {
+        logging_error("Frame " << i_job.index << " comes after frame " << m_lastIndex << ", frames must be written in order.");
+        return false;
+    } else if(i_job.index != m_lastIndex + 1) {
+        logging_warning("Frames " << m_lastIndex + 1 << " to " << i_job.index - 1 << " are missing from " << m_settings.path
+                        << ", the frames around them fill their time.");
+    }
+    m_lastIndex = i_job.index;
+
+    // Frame of the video the image starts at : from its timestamp, else from its index. The image is repeated
+    // up to there, and dropped when the video is already past it
+    int64_t videoIndex = i_job.index - m_firstIndex;
+    if(0. <= i_job.timestamp_ms && 0. <= m_firstTimestamp_ms) {
+        videoIndex = std::llround((i_job.timestamp_ms - m_firstTimestamp_ms) * m_settings.fps / 1000.);
+    }
+    const int64_t nbCopies = std::max<int64_t>(0, videoIndex - m_nbVideoFrames + 1);
+    if(0 < nbCopies && nullptr != m_alpha) {
+        cv::extractChannel(i_job.image, m_alphaPlane, 3); // /!\ Dynamic alloc, only when the size changes
+    }
+    for(int64_t i = 0 ; i < nbCopies ; ++i) {
+        if(false == write_plane(m_video, i_job.image, o_nbBytes)) {
+            logging_error("Failed to give frame " << i_job.index << " to the encoder of " << m_settings.path);
+            return false;
+        }
+        if(nullptr != m_alpha && false == write_plane(m_alpha, m_alphaPlane, o_nbBytes)) {
+            logging_error("Failed to give frame " << i_job.index << " to the encoder of " << m_settings.alpha_path);
+            return false;
+        }
+    }
+    m_nbVideoFrames += nbCopies;
+
+    return true;
+}
+
+bool FrameSink_Video::open_encoders(const cv::Size& i_size)
+{
+    m_size = i_size;
+    const std::string command = get_command(m_settings, m_size, false);
+    m_video = popen(command.c_str(), "w");
+    if(nullptr == m_video) {
+        logging_error("Failed to start : " << command);
+        return false;
+    }
+    if(!m_settings.alpha_path.empty()) {
+        const std::string alphaCommand = get_command(m_settings, m_size, true);
+        m_alpha = popen(alphaCommand.c_str(), "w");
+        if(nullptr == m_alpha) {
+            logging_error("Failed to start : " << alphaCommand);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FrameSink_Video::close_encoders()
+{
+    bool success = true;
+    for(FILE** pipe : {&m_video, &m_alpha}) {
+        if(nullptr != *pipe) {
+            // Waits for the encoder, which writes the end of the container
+            success = (0 == pclose(*pipe)) && success;
+            *pipe = nullptr;
+        }
+    }
+    return success;
+}
+
+} /* namespace VBGE */
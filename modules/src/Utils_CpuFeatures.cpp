@@ -0,0 +1,80 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_CpuFeatures.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "Utils_Logging.hpp"
+
+#include "Utils_CpuFeatures.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+#if defined(__x86_64__) || defined(__i386__)
+uint64_t get_xcr0()
+{
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+}
+
+bool detect_bfloat16()
+{
+    unsigned int eax, ebx, ecx, edx;
+    // XGETBV must be enabled to read which registers the OS saves
+    if(0 == __get_cpuid(1, &eax, &ebx, &ecx, &edx) || 0 == (ecx & (1u << 27))) {
+        return false;
+    }
+    const uint64_t xcr0 = get_xcr0();
+    if(0 == __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    // AMX-BF16 : CPUID.(7,0).EDX[22], tile registers saved by the OS (XCR0 bits 17 and 18)
+    const bool hasAmx = (0 != (edx & (1u << 22))) && (0x60000 == (xcr0 & 0x60000));
+    // AVX512-BF16 : CPUID.(7,1).EAX[5], on top of AVX512F (CPUID.(7,0).EBX[16]), zmm registers saved by the OS (XCR0 bits 1, 2, 5, 6 and 7)
+    const bool hasAvx512f = (0 != (ebx & (1u << 16))) && (0xE6 == (xcr0 & 0xE6));
+    bool hasAvx512Bf16 = false;
+    if(hasAvx512f && 0 != __get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx)) {
+        hasAvx512Bf16 = (0 != (eax & (1u << 5)));
+    }
+    return hasAmx || hasAvx512Bf16;
+}
+#else
+bool detect_bfloat16()
+{
+    return false;
+}
+#endif
+
+} /* namespace */
+
+bool cpu_hasBFloat16()
+{
+    static const bool hasBFloat16 = detect_bfloat16();
+    return hasBFloat16;
+}
+
+InferencePrecision get_supportedPrecision(InferencePrecision i_precision, torch::DeviceType i_device)
+{
+    if(InferencePrecision::BF16 == i_precision && torch::kCPU == i_device && false == cpu_hasBFloat16()) {
+        return InferencePrecision::FP32;
+    }
+    return i_precision;
+}
+
+} /* namespace VBGE */
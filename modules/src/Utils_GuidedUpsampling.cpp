@@ -0,0 +1,100 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_GuidedUpsampling.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include "Utils_Logging.hpp"
+
+#include "Utils_GuidedUpsampling.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+// o_mask = (a * luma * scale + b > 0.5) ? 255 : 0, a and b at the resolution of the luma
+template<typename T>
+void apply_coefficients(const cv::Mat& i_luma, float i_scale, const cv::Mat& i_a, const cv::Mat& i_b, cv::Mat& o_mask)
+{
+    cv::parallel_for_(cv::Range(0, i_luma.rows), [&](const cv::Range& i_range) {
+        for(int y = i_range.start ; y < i_range.end ; ++y) {
+            const T* luma = i_luma.ptr<T>(y);
+            const float* a = i_a.ptr<float>(y);
+            const float* b = i_b.ptr<float>(y);
+            uchar* mask = o_mask.ptr<uchar>(y);
+            for(int x = 0 ; x < i_luma.cols ; ++x) {
+                mask[x] = (a[x]*(luma[x]*i_scale) + b[x] > 0.5f) ? 255 : 0;
+            }
+        }
+    });
+}
+
+} /* namespace */
+
+int GuidedUpsampling::run(const cv::Mat& i_image, bool i_isBGR, const cv::Mat& i_mask, int i_radius, float i_eps, cv::Mat& o_mask)
+{
+    if(CV_8UC3 != i_image.type() && CV_32FC3 != i_image.type()) {
+        logging_error("CV_8UC3 != i_image.type() && CV_32FC3 != i_image.type()");
+        return -1;
+    }
+    if(CV_8UC1 != i_mask.type() || i_mask.empty()) {
+        logging_error("i_mask must be a non empty CV_8UC1 mask.");
+        return -1;
+    }
+    if(0 >= i_radius || 0.f >= i_eps) {
+        logging_error("i_radius (" << i_radius << ") and i_eps (" << i_eps << ") must be positive.");
+        return -1;
+    }
+    const float scale = (CV_8U == i_image.depth()) ? 1.f/255.f : 1.f;
+    const cv::Size size_low = i_mask.size();
+
+    // Guide : luma at full resolution, and averaged down to the resolution of the mask
+    cv::cvtColor(i_image, m_luma, i_isBGR ? cv::COLOR_BGR2GRAY : cv::COLOR_RGB2GRAY); // /!\ Dynamic alloc, only when the size changes
+    cv::resize(m_luma, m_luma_resized, size_low, 0, 0, cv::INTER_AREA);
+    m_luma_resized.convertTo(m_luma_low, CV_32F, scale);
+    i_mask.convertTo(m_mask_low, CV_32F, 1./255.);
+
+    // Local linear model mask = a * luma + b, fitted over boxes of radius i_radius
+    const cv::Size box(2*i_radius + 1, 2*i_radius + 1);
+    cv::boxFilter(m_luma_low, m_mean_luma, CV_32F, box);
+    cv::boxFilter(m_mask_low, m_mean_mask, CV_32F, box);
+    cv::multiply(m_luma_low, m_mask_low, m_product);
+    cv::boxFilter(m_product, m_corr_lumaMask, CV_32F, box);
+    cv::multiply(m_luma_low, m_luma_low, m_product);
+    cv::boxFilter(m_product, m_corr_lumaLuma, CV_32F, box);
+    // a = cov(luma, mask) / (var(luma) + eps), b = mean(mask) - a * mean(luma)
+    cv::multiply(m_mean_luma, m_mean_mask, m_product);
+    cv::subtract(m_corr_lumaMask, m_product, m_a);
+    cv::multiply(m_mean_luma, m_mean_luma, m_product);
+    cv::subtract(m_corr_lumaLuma, m_product, m_product);
+    m_product += i_eps;
+    cv::divide(m_a, m_product, m_a);
+    cv::multiply(m_a, m_mean_luma, m_product);
+    cv::subtract(m_mean_mask, m_product, m_b);
+    // Each pixel averages the models of the boxes it belongs to
+    cv::boxFilter(m_a, m_a, CV_32F, box);
+    cv::boxFilter(m_b, m_b, CV_32F, box);
+
+    // Coefficients at full resolution, applied to the full resolution luma
+    cv::resize(m_a, m_a_full, i_image.size(), 0, 0, cv::INTER_LINEAR);
+    cv::resize(m_b, m_b_full, i_image.size(), 0, 0, cv::INTER_LINEAR);
+    o_mask.create(i_image.size(), CV_8UC1); // /!\ Dynamic alloc, only when the size changes
+    if(CV_8U == m_luma.depth()) {
+        apply_coefficients<uchar>(m_luma, scale, m_a_full, m_b_full, o_mask);
+    } else {
+        apply_coefficients<float>(m_luma, scale, m_a_full, m_b_full, o_mask);
+    }
+
+    return 0;
+}
+
+} /* namespace VBGE */
@@ -0,0 +1,160 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_InferenceBatcher.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+
+#include "Utils_Logging.hpp"
+
+#include "Utils_InferenceBatcher.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+InferenceBatcher::InferenceBatcher(const BatchFunction& i_batchFunction, size_t i_maxBatchSize, std::chrono::microseconds i_maxDelay)
+    : m_batchFunction(i_batchFunction),
+      m_maxBatchSize(std::max<size_t>(1, i_maxBatchSize)),
+      m_maxDelay(i_maxDelay)
+{
+    m_thread = std::thread(&InferenceBatcher::batch_loop, this);
+}
+
+InferenceBatcher::~InferenceBatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_pendingCondition.notify_one();
+    if(m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+int InferenceBatcher::run(Request& io_request)
+{
+    if(io_request.images.empty()) {
+        logging_error("io_request.images is empty.");
+        return -1;
+    }
+
+    Pending pending;
+    pending.request = &io_request;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(m_stop) {
+        logging_error("The batching thread is stopped.");
+        return -1;
+    }
+    pending.enqueueTime = std::chrono::steady_clock::now();
+    pending.sequence = m_sequence++;
+    m_pending.push_back(&pending);
+    m_pendingCondition.notify_one();
+
+    m_doneCondition.wait(lock, [&pending]() { return pending.isDone; });
+
+    return pending.result;
+}
+
+uint64_t InferenceBatcher::get_nbBatches() const
+{
+    return m_nbBatches;
+}
+
+uint64_t InferenceBatcher::get_nbImages() const
+{
+    return m_nbImages;
+}
+
+bool InferenceBatcher::is_compatible(const Request& i_a, const Request& i_b)
+{
+    return i_a.kind == i_b.kind && i_a.isBGR == i_b.isBGR
+           && i_a.images[0].size() == i_b.images[0].size() && i_a.images[0].type() == i_b.images[0].type()
+           && i_a.trimaps.empty() == i_b.trimaps.empty();
+}
+
+void InferenceBatcher::batch_loop()
+{
+    // Highest priority first, then oldest first
+    auto isBefore = [](const Pending* i_a, const Pending* i_b) {
+        if(i_a->request->priority != i_b->request->priority) {
+            return i_a->request->priority > i_b->request->priority;
+        }
+        return i_a->sequence < i_b->sequence;
+    };
+
+    std::vector<Pending*> candidates;
+    std::vector<Pending*> batch;
+    std::vector<Request*> requests;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true) {
+        m_pendingCondition.wait(lock, [this]() { return m_stop || !m_pending.empty(); });
+        if(m_pending.empty()) {
+            // Stopped, and every request was served
+            break;
+        }
+
+        // Requests compatible with the first one to serve
+        const Pending* leader = *std::min_element(m_pending.begin(), m_pending.end(), isBefore);
+        candidates.clear();
+        size_t nbImages = 0;
+        std::chrono::steady_clock::time_point oldestTime = leader->enqueueTime;
+        for(auto pending : m_pending) {
+            if(is_compatible(*leader->request, *pending->request)) {
+                candidates.push_back(pending);
+                nbImages += pending->request->images.size();
+                oldestTime = std::min(oldestTime, pending->enqueueTime);
+            }
+        }
+
+        // Wait for more requests until the batch is full or the oldest request waited long enough.
+        // Any new request wakes the thread up, and the selection starts again
+        const std::chrono::steady_clock::time_point deadline = oldestTime + m_maxDelay;
+        if(false == m_stop && nbImages < m_maxBatchSize && std::chrono::steady_clock::now() < deadline) {
+            m_pendingCondition.wait_until(lock, deadline);
+            continue;
+        }
+
+        // Fill the batch in order of priority, the first request always goes in
+        std::sort(candidates.begin(), candidates.end(), isBefore);
+        batch.clear();
+        requests.clear();
+        size_t batchSize = 0;
+        for(auto pending : candidates) {
+            const size_t size = pending->request->images.size();
+            if(!batch.empty() && batchSize + size > m_maxBatchSize) {
+                continue;
+            }
+            batch.push_back(pending);
+            requests.push_back(pending->request);
+            batchSize += size;
+            m_pending.remove(pending);
+        }
+
+        // Run without the lock, new requests keep coming in meanwhile
+        lock.unlock();
+        const int result = m_batchFunction(requests);
+        m_nbBatches++;
+        m_nbImages += batchSize;
+        lock.lock();
+
+        for(auto pending : batch) {
+            pending->result = result;
+            pending->isDone = true;
+        }
+        m_doneCondition.notify_all();
+    }
+}
+
+} /* namespace VBGE */
@@ -0,0 +1,93 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_LatencyHistogram.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+#include <cmath>
+
+#include "Utils_LatencyHistogram.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+constexpr int LatencyHistogram::nbBucketsPerOctave;
+constexpr int LatencyHistogram::nbBuckets;
+
+LatencyHistogram::LatencyHistogram()
+{
+    for(auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum_ns.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::add(std::chrono::steady_clock::duration i_latency)
+{
+    const int64_t ns = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(i_latency).count());
+    // Bucket i holds latencies in [2^(i/8), 2^((i+1)/8)) microseconds
+    const double us = ns * 1e-3;
+    int bucket = 0;
+    if(1. < us) {
+        bucket = std::min(nbBuckets - 1, static_cast<int>(nbBucketsPerOctave * std::log2(us)));
+    }
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum_ns.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::get_count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::get_mean_ms() const
+{
+    const uint64_t count = get_count();
+    if(0 == count) {
+        return 0.;
+    }
+    return m_sum_ns.load(std::memory_order_relaxed) * 1e-6 / count;
+}
+
+double LatencyHistogram::get_percentile_ms(double i_percentile) const
+{
+    // Samples added while reading may be missed, the total is computed from the buckets themselves
+    uint64_t counts[nbBuckets];
+    uint64_t total = 0;
+    for(int i = 0 ; i < nbBuckets ; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if(0 == total) {
+        return 0.;
+    }
+
+    // Rank of the percentile, then the bucket holding it
+    const double p = std::max(0., std::min(1., i_percentile));
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * total)));
+    uint64_t cumulated = 0;
+    int bucket = nbBuckets - 1;
+    for(int i = 0 ; i < nbBuckets ; ++i) {
+        cumulated += counts[i];
+        if(cumulated >= rank) {
+            bucket = i;
+            break;
+        }
+    }
+
+    // Geometric center of the bucket
+    return std::exp2((bucket + 0.5) / nbBucketsPerOctave) * 1e-3;
+}
+
+} /* namespace VBGE */
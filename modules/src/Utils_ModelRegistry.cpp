@@ -0,0 +1,208 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_ModelRegistry.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <sstream>
+
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "Utils_Logging.hpp"
+
+#include "Utils_ModelRegistry.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+// Key of a source file in the cache : FNV-1a hash of its absolute path, size and modification time, in hexadecimal.
+// The content is not read, so a large model costs nothing at startup. Empty if the file can not be found
+std::string get_sourceKey(const std::string& i_path)
+{
+    struct stat status;
+    char absolutePath[PATH_MAX];
+    if(0 != stat(i_path.c_str(), &status) || nullptr == realpath(i_path.c_str(), absolutePath)) {
+        return std::string();
+    }
+    std::ostringstream key;
+    key << absolutePath << "|" << status.st_size << "|" << status.st_mtime;
+#if defined(__linux__)
+    key << "." << status.st_mtim.tv_nsec;
+#endif
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char c : key.str()) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream hex;
+    hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return hex.str();
+}
+
+// Path of the frozen module in the cache : the source key, and everything the frozen graph depends on
+std::string get_cachePath(const ModelRegistry::Request& i_request, const std::string& i_sourceKey)
+{
+    std::ostringstream path;
+    path << i_request.cacheDirectory << "/" << i_sourceKey << "_" << c10::DeviceTypeName(i_request.device, true)
+         << "_" << c10::toString(i_request.dtype);
+#if defined(TORCH_VERSION)
+    path << "_torch" << TORCH_VERSION;
+#endif
+    path << ".pt";
+    return path.str();
+}
+
+bool file_exists(const std::string& i_path)
+{
+    return std::ifstream(i_path).good();
+}
+
+} /* namespace */
+
+ModelRegistry::ModelRegistry()
+{
+
+}
+
+ModelRegistry& ModelRegistry::get_instance()
+{
+    static ModelRegistry instance;
+    return instance;
+}
+
+std::shared_ptr<torch::jit::script::Module> ModelRegistry::get_model(const Request& i_request)
+{
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::shared_ptr<Entry>& slot = m_entries[Key(i_request.path, static_cast<int>(i_request.device),
+                                                     static_cast<int>(i_request.dtype), i_request.optimize)];
+        if(!slot) {
+            slot = std::make_shared<Entry>();
+        }
+        entry = slot;
+    }
+
+    // Only the requests for this model wait while it loads
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    std::shared_ptr<torch::jit::script::Module> model = entry->model.lock();
+    if(model) {
+        return model;
+    }
+
+    model = load(i_request);
+    entry->model = model;
+
+    return model;
+}
+
+std::vector<std::shared_ptr<torch::jit::script::Module>> ModelRegistry::get_models(const std::vector<Request>& i_requests)
+{
+    std::vector<std::future<std::shared_ptr<torch::jit::script::Module>>> futures;
+    for(size_t i = 1 ; i < i_requests.size() ; ++i) {
+        futures.push_back(std::async(std::launch::async, [this, &i_requests, i]() { return get_model(i_requests[i]); }));
+    }
+
+    // The first model loads on the calling thread
+    std::vector<std::shared_ptr<torch::jit::script::Module>> models;
+    if(!i_requests.empty()) {
+        models.push_back(get_model(i_requests[0]));
+    }
+    for(auto& future : futures) {
+        models.push_back(future.get());
+    }
+    return models;
+}
+
+std::shared_ptr<torch::jit::script::Module> ModelRegistry::load(const Request& i_request)
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<torch::jit::script::Module> model;
+    try {
+        // The quantized engine is process-wide, and must match the one the model was quantized for
+        if(i_request.isQuantized && at::QEngine::FBGEMM != at::globalContext().qEngine()) {
+            const auto& engines = at::globalContext().supportedQEngines();
+            if(engines.end() == std::find(engines.begin(), engines.end(), at::QEngine::FBGEMM)) {
+                logging_error("The fbgemm quantized engine is not available, " << i_request.path << " can not run.");
+                return nullptr;
+            }
+            at::globalContext().setQEngine(at::QEngine::FBGEMM);
+        }
+#if VBGE_HAS_OPTIMIZE_FOR_INFERENCE
+        if(i_request.optimize) {
+            std::string cachePath;
+            if(!i_request.cacheDirectory.empty()) {
+                const std::string sourceKey = get_sourceKey(i_request.path);
+                if(sourceKey.empty()) {
+                    logging_error("Failed to stat " << i_request.path);
+                    return nullptr;
+                }
+                cachePath = get_cachePath(i_request, sourceKey);
+            }
+
+            torch::jit::script::Module frozen;
+            if(!cachePath.empty() && file_exists(cachePath)) {
+                frozen = torch::jit::load(cachePath, i_request.device);
+                logging_info("Loaded the frozen module of " << i_request.path << " from " << cachePath);
+            } else {
+                torch::jit::script::Module source = torch::jit::load(i_request.path, i_request.device);
+                if(torch::kFloat32 != i_request.dtype) {
+                    source.to(i_request.dtype);
+                }
+                source.eval();
+                frozen = torch::jit::freeze(source);
+                if(!cachePath.empty()) {
+                    // Written aside then renamed, a concurrent startup never reads a partial file
+                    const std::string tmpPath = cachePath + ".tmp";
+                    frozen.save(tmpPath);
+                    if(0 != std::rename(tmpPath.c_str(), cachePath.c_str())) {
+                        logging_error("Failed to rename " << tmpPath << " to " << cachePath);
+                    }
+                }
+            }
+            // The optimized graph holds device specific layouts which are not serialized : it is rebuilt at each load,
+            // the cache saves the freezing
+            // /!\ Dynamic alloc
+            model = std::make_shared<torch::jit::script::Module>(torch::jit::optimize_for_inference(frozen));
+        } else
+#endif
+        {
+            if(i_request.optimize) {
+                logging_info("torch::jit::optimize_for_inference() needs libtorch 1.10 or later, " << i_request.path << " is not optimized.");
+            }
+            // /!\ Dynamic alloc
+            model = std::make_shared<torch::jit::script::Module>(torch::jit::load(i_request.path, i_request.device));
+            if(torch::kFloat32 != i_request.dtype) {
+                model->to(i_request.dtype);
+            }
+            model->eval();
+        }
+    } catch(const c10::Error& e) {
+        logging_error("Failed to load " << i_request.path << " : " << e.what());
+        return nullptr;
+    }
+    const double duration_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    logging_info("Loaded " << i_request.path << " in " << duration_ms << " ms");
+
+    return model;
+}
+
+} /* namespace VBGE */
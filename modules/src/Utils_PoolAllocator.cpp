@@ -0,0 +1,149 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_PoolAllocator.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+
+#include "Utils_Logging.hpp"
+
+#include "Utils_PoolAllocator.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+PoolAllocator::PoolAllocator()
+{
+
+}
+
+PoolAllocator& PoolAllocator::get_instance()
+{
+    // Never destroyed : Mat allocated by the pool may be released during static destruction
+    static PoolAllocator* instance = new PoolAllocator();
+    return *instance;
+}
+
+void PoolAllocator::install()
+{
+    cv::Mat::setDefaultAllocator(&get_instance());
+}
+
+cv::UMatData* PoolAllocator::allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                                      cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    // Same layout as the standard allocator of OpenCV
+    size_t total = CV_ELEM_SIZE(type);
+    for(int i = dims-1 ; i >= 0 ; i--) {
+        if(step) {
+            if(data0 && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uchar* data = static_cast<uchar*>(data0);
+    if(!data) {
+        m_nbAllocations++;
+        m_nbBytes += total;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_pool.find(total);
+            if(it != m_pool.end() && !it->second.empty()) {
+                data = it->second.back();
+                it->second.pop_back();
+                m_cachedBytes -= total;
+            }
+        }
+        if(!data) {
+            m_nbSystemAllocations++;
+            data = static_cast<uchar*>(cv::fastMalloc(total));
+        }
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if(data0) {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+
+    return u;
+}
+
+bool PoolAllocator::allocate(cv::UMatData* u, cv::AccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return nullptr != u;
+}
+
+void PoolAllocator::deallocate(cv::UMatData* u) const
+{
+    if(!u) {
+        return;
+    }
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if(!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        bool isCached = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_cachedBytes + u->size <= m_maxCachedBytes) {
+                m_pool[u->size].push_back(u->origdata);
+                m_cachedBytes += u->size;
+                isCached = true;
+            }
+        }
+        if(!isCached) {
+            cv::fastFree(u->origdata);
+        }
+        u->origdata = 0;
+    }
+    delete u;
+}
+
+void PoolAllocator::mark_frame(int i_nbFrames)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint64_t nbAllocations = m_nbAllocations;
+    const uint64_t nbBytes = m_nbBytes;
+    const uint64_t nbFrames = std::max(1, i_nbFrames);
+    m_nbAllocations_lastFrame = (nbAllocations - m_nbAllocations_lastMark) / nbFrames;
+    m_nbBytes_lastFrame = (nbBytes - m_nbBytes_lastMark) / nbFrames;
+    m_nbAllocations_lastMark = nbAllocations;
+    m_nbBytes_lastMark = nbBytes;
+}
+
+AllocatorStatistics PoolAllocator::get_statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    AllocatorStatistics statistics;
+    statistics.nbAllocations = m_nbAllocations;
+    statistics.nbBytes = m_nbBytes;
+    statistics.nbSystemAllocations = m_nbSystemAllocations;
+    statistics.nbAllocations_lastFrame = m_nbAllocations_lastFrame;
+    statistics.nbBytes_lastFrame = m_nbBytes_lastFrame;
+    statistics.cachedBytes = m_cachedBytes;
+    return statistics;
+}
+
+void PoolAllocator::set_maxCachedBytes(size_t i_maxCachedBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxCachedBytes = i_maxCachedBytes;
+}
+
+} /* namespace VBGE */
@@ -0,0 +1,220 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_Preprocessing.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "Utils_Logging.hpp"
+
+#include "Utils_Preprocessing.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+// Stores of the normalized values : float, or bfloat16 bit patterns
+inline void store_value(float* o_dst, float i_value)
+{
+    *o_dst = i_value;
+}
+
+inline void store_value(uint16_t* o_dst, float i_value)
+{
+    *o_dst = float_to_bfloat16(i_value);
+}
+
+#if CV_SIMD
+inline void store_values(float* o_dst, const cv::v_float32& i_values)
+{
+    cv::v_store(o_dst, i_values);
+}
+
+inline void store_values(uint16_t* o_dst, const cv::v_float32& i_values)
+{
+    // Round to nearest even, then keep the 16 high bits, as float_to_bfloat16()
+    cv::v_uint32 bits = cv::v_reinterpret_as_u32(i_values);
+    const cv::v_uint32 lsb = (bits >> 16) & cv::vx_setall_u32(1);
+    bits = (bits + cv::vx_setall_u32(0x7FFF) + lsb) >> 16;
+    cv::v_pack_store(reinterpret_cast<ushort*>(o_dst), bits);
+}
+
+// Widen 8-bit values to float and store a*value+b
+template<typename Dst>
+inline void store_normalized(const cv::v_uint8& i_values, const cv::v_float32& i_a, const cv::v_float32& i_b, Dst* o_dst)
+{
+    constexpr int nlanes = cv::v_float32::nlanes;
+    cv::v_uint16 values16[2];
+    cv::v_expand(i_values, values16[0], values16[1]);
+    for(int i = 0 ; i < 2 ; ++i) {
+        cv::v_uint32 values32_lo, values32_hi;
+        cv::v_expand(values16[i], values32_lo, values32_hi);
+        store_values(o_dst + (2*i)*nlanes,     cv::v_fma(cv::v_cvt_f32(cv::v_reinterpret_as_s32(values32_lo)), i_a, i_b));
+        store_values(o_dst + (2*i + 1)*nlanes, cv::v_fma(cv::v_cvt_f32(cv::v_reinterpret_as_s32(values32_hi)), i_a, i_b));
+    }
+}
+#endif
+
+template<typename Dst>
+void preprocess_row(const uchar* i_src, int i_cols, const float i_a[3], const float i_b[3], Dst* o_dst[3])
+{
+    int x = 0;
+#if CV_SIMD
+    constexpr int nlanes = cv::v_uint8::nlanes;
+    const cv::v_float32 a0 = cv::vx_setall_f32(i_a[0]), b0 = cv::vx_setall_f32(i_b[0]);
+    const cv::v_float32 a1 = cv::vx_setall_f32(i_a[1]), b1 = cv::vx_setall_f32(i_b[1]);
+    const cv::v_float32 a2 = cv::vx_setall_f32(i_a[2]), b2 = cv::vx_setall_f32(i_b[2]);
+    for( ; x <= i_cols - nlanes ; x += nlanes) {
+        cv::v_uint8 c0, c1, c2;
+        cv::v_load_deinterleave(i_src + 3*x, c0, c1, c2);
+        store_normalized(c0, a0, b0, o_dst[0] + x);
+        store_normalized(c1, a1, b1, o_dst[1] + x);
+        store_normalized(c2, a2, b2, o_dst[2] + x);
+    }
+#endif
+    for( ; x < i_cols ; ++x) {
+        for(int c = 0 ; c < 3 ; ++c) {
+            store_value(o_dst[c] + x, i_src[3*x + c] * i_a[c] + i_b[c]);
+        }
+    }
+}
+
+template<typename Dst>
+void preprocess_row(const float* i_src, int i_cols, const float i_a[3], const float i_b[3], Dst* o_dst[3])
+{
+    int x = 0;
+#if CV_SIMD
+    constexpr int nlanes = cv::v_float32::nlanes;
+    const cv::v_float32 a0 = cv::vx_setall_f32(i_a[0]), b0 = cv::vx_setall_f32(i_b[0]);
+    const cv::v_float32 a1 = cv::vx_setall_f32(i_a[1]), b1 = cv::vx_setall_f32(i_b[1]);
+    const cv::v_float32 a2 = cv::vx_setall_f32(i_a[2]), b2 = cv::vx_setall_f32(i_b[2]);
+    for( ; x <= i_cols - nlanes ; x += nlanes) {
+        cv::v_float32 c0, c1, c2;
+        cv::v_load_deinterleave(i_src + 3*x, c0, c1, c2);
+        store_values(o_dst[0] + x, cv::v_fma(c0, a0, b0));
+        store_values(o_dst[1] + x, cv::v_fma(c1, a1, b1));
+        store_values(o_dst[2] + x, cv::v_fma(c2, a2, b2));
+    }
+#endif
+    for( ; x < i_cols ; ++x) {
+        for(int c = 0 ; c < 3 ; ++c) {
+            store_value(o_dst[c] + x, i_src[3*x + c] * i_a[c] + i_b[c]);
+        }
+    }
+}
+
+template<typename T, typename Dst>
+void preprocess_image(const cv::Mat& i_image, const float i_a[3], const float i_b[3], const int i_plane[3], Dst* o_planes)
+{
+    const int rows = i_image.rows;
+    const int cols = i_image.cols;
+    const size_t planeSize = static_cast<size_t>(rows) * cols;
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& i_range) {
+        for(int y = i_range.start ; y < i_range.end ; ++y) {
+            // Source channel c is written in plane i_plane[c]
+            Dst* dst[3];
+            for(int c = 0 ; c < 3 ; ++c) {
+                dst[c] = o_planes + i_plane[c]*planeSize + static_cast<size_t>(y)*cols;
+            }
+            preprocess_row(i_image.ptr<T>(y), cols, i_a, i_b, dst);
+        }
+    });
+}
+
+// Same as preprocess_image(), on the sums of the i_factor*i_factor blocks of the image : i_a also divides by the block area
+template<typename T, typename Dst>
+void preprocess_image_area(const cv::Mat& i_image, int i_factor, const float i_a[3], const float i_b[3], const int i_plane[3],
+                           Dst* o_planes)
+{
+    const int rows = i_image.rows / i_factor;
+    const int cols = i_image.cols / i_factor;
+    const size_t planeSize = static_cast<size_t>(rows) * cols;
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& i_range) {
+        // Sums of a row of blocks, packed. On the stack up to 4K at a quarter of the resolution
+        cv::AutoBuffer<float, 4096> buffer(3*cols);
+        float* sums = buffer.data();
+        for(int y = i_range.start ; y < i_range.end ; ++y) {
+            std::fill(sums, sums + 3*cols, 0.f);
+            for(int dy = 0 ; dy < i_factor ; ++dy) {
+                const T* src = i_image.ptr<T>(y*i_factor + dy);
+                for(int x = 0 ; x < cols ; ++x) {
+                    for(int dx = 0 ; dx < i_factor ; ++dx) {
+                        const T* pixel = src + 3*(x*i_factor + dx);
+                        sums[3*x]     += pixel[0];
+                        sums[3*x + 1] += pixel[1];
+                        sums[3*x + 2] += pixel[2];
+                    }
+                }
+            }
+            Dst* dst[3];
+            for(int c = 0 ; c < 3 ; ++c) {
+                dst[c] = o_planes + i_plane[c]*planeSize + static_cast<size_t>(y)*cols;
+            }
+            preprocess_row(sums, cols, i_a, i_b, dst);
+        }
+    });
+}
+
+template<typename Dst>
+int preprocess(const cv::Mat& i_image, bool i_swapRB, float i_scale, const cv::Vec3f& i_mean, const cv::Vec3f& i_std, Dst* o_planes,
+               int i_downscale)
+{
+    if(1 > i_downscale || i_image.rows < i_downscale || i_image.cols < i_downscale) {
+        logging_error("Downscale factor " << i_downscale << " invalid for an image of " << i_image.size());
+        return -1;
+    }
+
+    // (v*scale - mean)/std is computed as v*a + b, per source channel. The mean of a block is its sum over its area
+    const int plane[3] = {i_swapRB ? 2 : 0, 1, i_swapRB ? 0 : 2};
+    const float area = static_cast<float>(i_downscale*i_downscale);
+    float a[3], b[3];
+    for(int c = 0 ; c < 3 ; ++c) {
+        a[c] = i_scale / (i_std[plane[c]] * area);
+        b[c] = -i_mean[plane[c]] / i_std[plane[c]];
+    }
+
+    if(1 < i_downscale) {
+        switch(i_image.type()) {
+        case CV_8UC3: preprocess_image_area<uchar>(i_image, i_downscale, a, b, plane, o_planes); return 0;
+        case CV_32FC3: preprocess_image_area<float>(i_image, i_downscale, a, b, plane, o_planes); return 0;
+        default: break;
+        }
+    }
+    switch(i_image.type()) {
+    case CV_8UC3: preprocess_image<uchar>(i_image, a, b, plane, o_planes); break;
+    case CV_32FC3: preprocess_image<float>(i_image, a, b, plane, o_planes); break;
+    default:
+        logging_error("Unsupported image type (" << cv::typeToString(i_image.type()) << "). Supported types are CV_8UC3 and CV_32FC3");
+        return -1;
+    }
+
+    return 0;
+}
+
+} /* namespace */
+
+int preprocess_packedToPlanar(const cv::Mat& i_image, bool i_swapRB, float i_scale,
+                              const cv::Vec3f& i_mean, const cv::Vec3f& i_std, float* o_planes, int i_downscale)
+{
+    return preprocess(i_image, i_swapRB, i_scale, i_mean, i_std, o_planes, i_downscale);
+}
+
+int preprocess_packedToPlanar(const cv::Mat& i_image, bool i_swapRB, float i_scale,
+                              const cv::Vec3f& i_mean, const cv::Vec3f& i_std, uint16_t* o_planes, int i_downscale)
+{
+    return preprocess(i_image, i_swapRB, i_scale, i_mean, i_std, o_planes, i_downscale);
+}
+
+} /* namespace VBGE */
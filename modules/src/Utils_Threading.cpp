@@ -0,0 +1,165 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        Utils_Threading.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <opencv2/opencv.hpp>
+#include <torch/script.h>
+
+#include "Utils_Logging.hpp"
+
+#include "Utils_Threading.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+// Partition the calling thread runs in
+thread_local ThreadPartition t_partition;
+thread_local bool t_hasPartition = false;
+
+#if defined(__linux__)
+int set_affinity(int i_firstCore, int i_nbCores)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for(int core = i_firstCore ; core < i_firstCore + i_nbCores ; ++core) {
+        CPU_SET(core, &cpus);
+    }
+    if(0 != pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+        logging_error("pthread_setaffinity_np() failed for cores " << i_firstCore << " to " << i_firstCore + i_nbCores - 1);
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+} /* namespace */
+
+int apply_threadPartition(const ThreadPartition& i_partition)
+{
+    if(t_hasPartition && i_partition.firstCore == t_partition.firstCore && i_partition.nbCores == t_partition.nbCores
+       && i_partition.nbThreads == t_partition.nbThreads) {
+        return 0;
+    }
+    t_partition = i_partition;
+    t_hasPartition = true;
+
+    // With OpenMP, the number of threads is a setting of the calling thread : each partition has its own team
+    if(0 < i_partition.nbThreads) {
+        at::set_num_threads(i_partition.nbThreads);
+    }
+    if(0 <= i_partition.firstCore) {
+#if defined(__linux__)
+        return set_affinity(i_partition.firstCore, i_partition.nbCores);
+#else
+        logging_error("Thread pinning is only supported on Linux.");
+        return -1;
+#endif
+    }
+    return 0;
+}
+
+bool get_isTorchPoolPerThread()
+{
+    // "ATen parallel backend: OpenMP" or "ATen parallel backend: native thread pool"
+    return std::string::npos != at::get_parallel_info().find("parallel backend: OpenMP");
+}
+
+int start_openCVPool(const ThreadPartition& i_partition)
+{
+    cv::setNumThreads(i_partition.nbThreads);
+    if(0 > i_partition.firstCore) {
+        return 0;
+    }
+#if defined(__linux__)
+    cpu_set_t cpus;
+    if(0 != pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+        logging_error("pthread_getaffinity_np() failed.");
+        return -1;
+    }
+    if(0 > set_affinity(i_partition.firstCore, i_partition.nbCores)) {
+        return -1;
+    }
+    // The pool starts its threads at the first parallel loop, they inherit the cores of the calling thread
+    cv::parallel_for_(cv::Range(0, i_partition.nbThreads), [](const cv::Range&) {});
+    if(0 != pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+        logging_error("pthread_setaffinity_np() failed.");
+        return -1;
+    }
+    return 0;
+#else
+    logging_error("Thread pinning is only supported on Linux.");
+    return -1;
+#endif
+}
+
+void CoresUsage::reset(int i_firstCore, int i_nbCores)
+{
+    m_firstCore = i_firstCore;
+    m_nbCores = i_nbCores;
+    if(false == read(m_busy, m_total)) {
+        m_nbCores = 0;
+    }
+}
+
+double CoresUsage::get_utilization() const
+{
+    uint64_t busy = 0, total = 0;
+    if(0 >= m_nbCores || false == read(busy, total) || total <= m_total) {
+        return -1.;
+    }
+    return static_cast<double>(busy - m_busy) / (total - m_total);
+}
+
+bool CoresUsage::read(uint64_t& o_busy, uint64_t& o_total) const
+{
+    // Lines "cpuN user nice system idle iowait irq softirq steal ...", in jiffies
+    std::ifstream file("/proc/stat");
+    if(false == file.is_open()) {
+        return false;
+    }
+    o_busy = 0;
+    o_total = 0;
+    std::string line;
+    while(std::getline(file, line)) {
+        int core = -1;
+        if(0 != line.compare(0, 3, "cpu") || 1 != std::sscanf(line.c_str(), "cpu%d", &core)) {
+            continue;
+        }
+        if(core < m_firstCore || core >= m_firstCore + m_nbCores) {
+            continue;
+        }
+        std::istringstream fields(line.substr(line.find(' ')));
+        uint64_t value = 0;
+        for(int i = 0 ; i < 8 && (fields >> value) ; ++i) {
+            o_total += value;
+            // idle and iowait
+            if(3 != i && 4 != i) {
+                o_busy += value;
+            }
+        }
+    }
+    return true;
+}
+
+} /* namespace VBGE */
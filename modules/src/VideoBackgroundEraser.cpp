@@ -29,6 +29,12 @@ VideoBackgroundEraser::VideoBackgroundEraser(const VideoBackgroundEraser_Setting
     m_algo.reset(new VideoBackgroundEraser_Algo(i_settings));
 }
 
+VideoBackgroundEraser::VideoBackgroundEraser(const VideoBackgroundEraser_Settings& i_settings,
+                                             const std::shared_ptr<VideoBackgroundEraser_Scheduler>& i_scheduler)
+{
+    m_algo.reset(new VideoBackgroundEraser_Algo(i_settings, i_scheduler));
+}
+
 VideoBackgroundEraser::~VideoBackgroundEraser()
 {
     m_algo.reset();
@@ -39,6 +45,26 @@ bool VideoBackgroundEraser::get_isInitialized()
     return m_algo->get_isInitialized();
 }
 
+FrameCounters VideoBackgroundEraser::get_frameCounters()
+{
+    return m_algo->get_frameCounters();
+}
+
+void VideoBackgroundEraser::get_sceneCuts(std::vector<int64_t>& o_indexes)
+{
+    m_algo->get_sceneCuts(o_indexes);
+}
+
+Statistics VideoBackgroundEraser::get_statistics()
+{
+    return m_algo->get_statistics();
+}
+
+AllocatorStatistics VideoBackgroundEraser::get_allocatorStatistics()
+{
+    return m_algo->get_allocatorStatistics();
+}
+
 int VideoBackgroundEraser::run(const cv::Mat& i_image, cv::Mat& o_image_withoutBackground)
 {
     if(false == m_algo->get_isInitialized()) {
@@ -65,4 +91,95 @@ int VideoBackgroundEraser::run(const cv::Mat& i_image, cv::Mat& o_image_withoutB
     return 0;
 }
 
+int VideoBackgroundEraser::run_batch(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& o_images_withoutBackground)
+{
+    if(false == m_algo->get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+
+    // Tests on i_images
+    if(i_images.empty()) {
+        logging_error("i_images is empty.");
+        return -1;
+    }
+    for(auto& image : i_images) {
+        if(image.empty()) {
+            logging_error("An image of i_images is empty.");
+            return -1;
+        }
+        if(3 != image.channels()) {
+            logging_error("An image of i_images does not have 3 channels.");
+            return -1;
+        }
+        if(i_images[0].size() != image.size() || i_images[0].type() != image.type()) {
+            logging_error("All images of i_images must have the same size and type.");
+            return -1;
+        }
+    }
+
+    // Actual call to algorithm
+    if(0 > m_algo->run_batch(i_images, o_images_withoutBackground)) {
+        logging_error("m_algo->run_batch() failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+int VideoBackgroundEraser::run_segmentation(VideoBackgroundEraser_Frame& io_frame)
+{
+    if(false == m_algo->get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+
+    // Tests on io_frame.image
+    if(io_frame.image.empty()) {
+        logging_error("io_frame.image is empty.");
+        return -1;
+    }
+    if(3 != io_frame.image.channels()) {
+        logging_error("io_frame.image does not have 3 channels.");
+        return -1;
+    }
+
+    if(0 > m_algo->run_segmentation(io_frame)) {
+        logging_error("m_algo->run_segmentation() failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+int VideoBackgroundEraser::run_trimap(VideoBackgroundEraser_Frame& io_frame)
+{
+    if(false == m_algo->get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+
+    if(0 > m_algo->run_trimap(io_frame)) {
+        logging_error("m_algo->run_trimap() failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+int VideoBackgroundEraser::run_matting(VideoBackgroundEraser_Frame& io_frame)
+{
+    if(false == m_algo->get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+
+    if(0 > m_algo->run_matting(io_frame)) {
+        logging_error("m_algo->run_matting() failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
 } /* namespace VBGE */
@@ -10,13 +10,21 @@
 /*============================================================================*/
 /* Includes                                                                   */
 /*============================================================================*/
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <limits>
+#include <thread>
 #include <iomanip>
 #include <typeinfo>
 
+#include <opencv2/core/hal/intrin.hpp>
+
 #include "Utils_Logging.hpp"
 
 #include "VideoBackgroundEraser_Algo.hpp"
+#include "Utils_PoolAllocator.hpp"
+#include "Utils_Threading.hpp"
 
 /*============================================================================*/
 /* Defines                                                                  */
@@ -27,18 +35,131 @@
 /*============================================================================*/
 namespace VBGE {
 
-VideoBackgroundEraser_Algo::VideoBackgroundEraser_Algo(const VideoBackgroundEraser_Settings &i_settings)
-    : m_settings(i_settings),
+namespace {
+
+// Coordinates map of remap() from a dense flow : map(x, y) = (x + flow_x, y + flow_y)
+void flowToMap(const cv::Mat& i_flow, cv::Mat& o_mapXY)
+{
+    o_mapXY.create(i_flow.size(), CV_32FC2);
+    cv::parallel_for_(cv::Range(0, i_flow.rows), [&](const cv::Range& i_range) {
+        for(int y = i_range.start ; y < i_range.end ; ++y) {
+            const float* flow = i_flow.ptr<float>(y);
+            float* mapXY = o_mapXY.ptr<float>(y);
+            int x = 0;
+#if CV_SIMD
+            constexpr int nlanes = cv::v_float32::nlanes;
+            float offsets[nlanes];
+            for(int i = 0 ; i < nlanes ; ++i) {
+                offsets[i] = static_cast<float>(i);
+            }
+            cv::v_float32 vx = cv::vx_load(offsets);
+            const cv::v_float32 vy = cv::vx_setall_f32(static_cast<float>(y));
+            const cv::v_float32 step = cv::vx_setall_f32(static_cast<float>(nlanes));
+            for( ; x <= i_flow.cols - nlanes ; x += nlanes) {
+                cv::v_float32 fx, fy;
+                cv::v_load_deinterleave(flow + 2*x, fx, fy);
+                cv::v_store_interleave(mapXY + 2*x, fx + vx, fy + vy);
+                vx = vx + step;
+            }
+#endif
+            for( ; x < i_flow.cols ; ++x) {
+                mapXY[2*x] = flow[2*x] + x;
+                mapXY[2*x + 1] = flow[2*x + 1] + y;
+            }
+        }
+    });
+}
+
+// With a scheduler, the networks are the ones of the scheduler : same models from ModelRegistry, same background classes
+VideoBackgroundEraser_Settings with_schedulerSettings(const VideoBackgroundEraser_Settings& i_settings,
+                                                      const std::shared_ptr<VideoBackgroundEraser_Scheduler>& i_scheduler)
+{
+    VideoBackgroundEraser_Settings settings = i_settings;
+    if(i_scheduler) {
+        settings.deeplabv3_inference = i_scheduler->get_settings().deeplabv3_inference;
+        settings.deepimagematting_inference = i_scheduler->get_settings().deepimagematting_inference;
+    }
+    return settings;
+}
+
+// Both models in parallel. With a scheduler they are already loaded, by the scheduler
+std::vector<std::shared_ptr<torch::jit::script::Module>> load_models(const VideoBackgroundEraser_Settings& i_settings, bool i_hasScheduler)
+{
+    if(i_hasScheduler) {
+        return std::vector<std::shared_ptr<torch::jit::script::Module>>();
+    }
+    std::vector<ModelRegistry::Request> requests;
+    requests.push_back(DeepLabV3_Inference::get_modelRequest(i_settings.deeplabv3_inference));
+    requests.push_back(DeepImageMatting_Inference::get_modelRequest(i_settings.deepimagematting_inference));
+    return ModelRegistry::get_instance().get_models(requests);
+}
+
+double get_elapsed_ms(const std::chrono::steady_clock::time_point& i_start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - i_start).count();
+}
+
+} /* namespace */
+
+VideoBackgroundEraser_Algo::VideoBackgroundEraser_Algo(const VideoBackgroundEraser_Settings &i_settings,
+                                                       const std::shared_ptr<VideoBackgroundEraser_Scheduler>& i_scheduler)
+    : m_creationTime(std::chrono::steady_clock::now()),
+      m_settings(with_schedulerSettings(i_settings, i_scheduler)),
+      m_scheduler(i_scheduler),
+      m_models(load_models(m_settings, static_cast<bool>(i_scheduler))),
       m_deeplabv3_inference(m_settings.deeplabv3_inference),
-      m_deepimagematting_inference(m_settings.deepimagematting_inference)
+      m_deepimagematting_inference(m_settings.deepimagematting_inference),
+      m_sceneCutDetector(m_settings.sceneCut_threshold)
 {
 
     if(false == m_deeplabv3_inference.get_isInitialized()) {
         logging_error("m_deeplabv3_inference was not correctly initialized.");
         return;
     }
+    if(false == m_deepimagematting_inference.get_isInitialized()) {
+        logging_error("m_deepimagematting_inference was not correctly initialized.");
+        return;
+    }
+    if(m_scheduler && false == m_scheduler->get_isInitialized()) {
+        logging_error("m_scheduler was not correctly initialized.");
+        return;
+    }
+
+    switch(m_settings.opticalFlow_preset) {
+    case cv::DISOpticalFlow::PRESET_ULTRAFAST:
+    case cv::DISOpticalFlow::PRESET_FAST:
+    case cv::DISOpticalFlow::PRESET_MEDIUM: break;
+    default:
+        logging_error("Unknown m_settings.opticalFlow_preset (" << m_settings.opticalFlow_preset << ").");
+        return;
+    }
+    m_optFLow = cv::DISOpticalFlow::create(m_settings.opticalFlow_preset);
+    // The segmentation stage has its own instance, stages may run concurrently
+    m_keyframe_optFlow = cv::DISOpticalFlow::create(m_settings.opticalFlow_preset);
+
+    if(m_settings.enable_pooledAllocator) {
+        PoolAllocator::install();
+    }
+
+    if(0 > init_threading()) {
+        logging_error("init_threading() failed.");
+        return;
+    }
 
-    m_optFLow = cv::DISOpticalFlow::create(cv::DISOpticalFlow::PRESET_MEDIUM);
+    if(0 > warmup()) {
+        logging_error("warmup() failed.");
+        return;
+    }
+
+    m_initialization_ms = get_elapsed_ms(m_creationTime);
+    logging_info("Initialized in " << m_initialization_ms << " ms");
+
+    m_coresUsage.resize(m_partitions.size());
+    for(size_t i = 0 ; i < m_partitions.size() ; ++i) {
+        if(0 <= m_partitions[i].firstCore) {
+            m_coresUsage[i].reset(m_partitions[i].firstCore, m_partitions[i].nbCores);
+        }
+    }
 
     m_isInitialized = true;
 }
@@ -52,82 +173,677 @@ bool VideoBackgroundEraser_Algo::get_isInitialized() {
     return m_isInitialized;
 }
 
+FrameCounters VideoBackgroundEraser_Algo::get_frameCounters()
+{
+    FrameCounters counters;
+    counters.nbFrames_inferred = m_nbFrames_inferred;
+    counters.nbFrames_propagated = m_nbFrames_propagated;
+    counters.nbKeyframes_forced = m_nbKeyframes_forced;
+    counters.nbFrames_duplicate = m_nbFrames_duplicate;
+    counters.nbSceneCuts = m_nbSceneCuts;
+    return counters;
+}
+
+Statistics VideoBackgroundEraser_Algo::get_statistics()
+{
+    static const char* stageNames[Stage_Count] = {"total", "segmentation", "deeplabv3", "trimap", "temporalManagement",
+                                                  "matting", "deepimagematting"};
+
+    Statistics statistics;
+    for(int stage = 0 ; stage < Stage_Count ; ++stage) {
+        const LatencyHistogram& histogram = m_latencies[stage];
+        StageStatistics stageStatistics;
+        stageStatistics.name = stageNames[stage];
+        stageStatistics.nbCalls = histogram.get_count();
+        stageStatistics.latency_mean_ms = histogram.get_mean_ms();
+        stageStatistics.latency_p50_ms = histogram.get_percentile_ms(0.50);
+        stageStatistics.latency_p95_ms = histogram.get_percentile_ms(0.95);
+        stageStatistics.latency_p99_ms = histogram.get_percentile_ms(0.99);
+        statistics.stages.push_back(stageStatistics);
+    }
+    statistics.nbFrames = m_nbFrames;
+    statistics.frameCounters = get_frameCounters();
+    statistics.allocator = get_allocatorStatistics();
+    const uint64_t nbTrimapPixels = m_nbTrimapPixels;
+    statistics.unknownRatio = (0 == nbTrimapPixels) ? 0. : static_cast<double>(m_nbUnknownPixels) / nbTrimapPixels;
+    statistics.unknownRatio_lastFrame = m_unknownRatio_lastFrame;
+    statistics.initialization_ms = m_initialization_ms;
+    statistics.timeToFirstFrame_ms = m_timeToFirstFrame_ms;
+
+    // Time spent in the networks of each partition over the time since the initialization
+    const double running_ms = get_elapsed_ms(m_creationTime) - m_initialization_ms;
+    const LatencyHistogram& deeplabv3 = m_latencies[Stage_DeepLabV3];
+    const LatencyHistogram& deepimagematting = m_latencies[Stage_DeepImageMatting];
+    const double deeplabv3_ms = deeplabv3.get_mean_ms() * deeplabv3.get_count();
+    const double deepimagematting_ms = deepimagematting.get_mean_ms() * deepimagematting.get_count();
+    for(size_t i = 0 ; i < m_partitions.size() ; ++i) {
+        const ThreadPartition& partition = m_partitions[i];
+        PartitionStatistics partitionStatistics;
+        partitionStatistics.name = partition.name;
+        partitionStatistics.firstCore = partition.firstCore;
+        partitionStatistics.nbCores = partition.nbCores;
+        partitionStatistics.nbThreads = partition.nbThreads;
+        double busy_ms = -1.;
+        if(static_cast<int>(i) == m_partition_segmentation && static_cast<int>(i) == m_partition_matting) {
+            busy_ms = deeplabv3_ms + deepimagematting_ms;
+        } else if(static_cast<int>(i) == m_partition_segmentation) {
+            busy_ms = deeplabv3_ms;
+        } else if(static_cast<int>(i) == m_partition_matting) {
+            busy_ms = deepimagematting_ms;
+        }
+        if(0. <= busy_ms && 0. < running_ms) {
+            partitionStatistics.busyRatio = busy_ms / running_ms;
+        }
+        if(0 <= partition.firstCore) {
+            partitionStatistics.cpuUtilization = m_coresUsage[i].get_utilization();
+        }
+        statistics.partitions.push_back(partitionStatistics);
+    }
+
+    return statistics;
+}
+
+int VideoBackgroundEraser_Algo::dump_statistics(const std::string& i_path, StatisticsFormat i_format)
+{
+    // Written to a temporary file then renamed, readers never see a partial file
+    const std::string tmpPath = i_path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::out | std::ios::trunc);
+        if(false == file.is_open()) {
+            logging_error("Failed to open " << tmpPath);
+            return -1;
+        }
+        file << get_statistics().to_string(i_format);
+        if(false == file.good()) {
+            logging_error("Failed to write " << tmpPath);
+            return -1;
+        }
+    }
+    if(0 != std::rename(tmpPath.c_str(), i_path.c_str())) {
+        logging_error("Failed to rename " << tmpPath << " to " << i_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+void VideoBackgroundEraser_Algo::get_sceneCuts(std::vector<int64_t>& o_indexes)
+{
+    std::lock_guard<std::mutex> lock(m_sceneCuts_mutex);
+    o_indexes.clear();
+    std::swap(o_indexes, m_sceneCuts);
+}
+
+AllocatorStatistics VideoBackgroundEraser_Algo::get_allocatorStatistics()
+{
+    if(false == m_settings.enable_pooledAllocator) {
+        return AllocatorStatistics();
+    }
+    return PoolAllocator::get_instance().get_statistics();
+}
+
 int VideoBackgroundEraser_Algo::run(const cv::Mat& i_image, cv::Mat& o_image_withoutBackground)
 {
     if(false == get_isInitialized()) {
         logging_error("This instance was not correctly initialized.");
         return -1;
     }
+    if(0 > apply_synchronousPartition()) {
+        logging_error("apply_synchronousPartition() failed.");
+        return -1;
+    }
+
+    // Run the three stages one after the other on the same frame
+    m_frame.index++;
+    m_frame.image = i_image;
+    // Write directly in the caller's buffer when possible
+    m_frame.image_withoutBackground = o_image_withoutBackground;
+    // Batch overloads : the single frame ones switch to the partition of their stage
+    std::vector<VideoBackgroundEraser_Frame*> frames(1, &m_frame);
+    if(0 > run_segmentation(frames)) {
+        logging_error("run_segmentation() failed.");
+        return -1;
+    }
+    if(0 > run_trimap(m_frame)) {
+        logging_error("run_trimap() failed.");
+        return -1;
+    }
+    if(0 > run_matting(frames)) {
+        logging_error("run_matting() failed.");
+        return -1;
+    }
+
+    o_image_withoutBackground = m_frame.image_withoutBackground;
+    // Release reference on input and output, so they are not shared with the next call
+    m_frame.image.release();
+    m_frame.image_withoutBackground.release();
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Algo::run_batch(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& o_images_withoutBackground)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    if(0 > apply_synchronousPartition()) {
+        logging_error("apply_synchronousPartition() failed.");
+        return -1;
+    }
+
+    // Frames keep their buffers from one batch to the next
+    m_batchFrames.resize(i_images.size());
+    std::vector<VideoBackgroundEraser_Frame*> frames;
+    for(size_t n = 0 ; n < i_images.size() ; ++n) {
+        m_batchFrames[n].index = ++m_frame.index;
+        m_batchFrames[n].image = i_images[n];
+        frames.push_back(&m_batchFrames[n]);
+    }
+
+    // DeepLabV3 runs once for the whole batch
+    if(0 > run_segmentation(frames)) {
+        logging_error("run_segmentation() failed.");
+        return -1;
+    }
+    // Temporal management needs the frames one after the other, in order
+    for(auto frame : frames) {
+        if(0 > run_trimap(*frame)) {
+            logging_error("run_trimap() failed.");
+            return -1;
+        }
+    }
+    // Deep Image Matting runs once for the whole batch
+    if(0 > run_matting(frames)) {
+        logging_error("run_matting() failed.");
+        return -1;
+    }
+
+    o_images_withoutBackground.resize(i_images.size());
+    for(size_t n = 0 ; n < i_images.size() ; ++n) {
+        o_images_withoutBackground[n] = m_batchFrames[n].image_withoutBackground;
+        // Release reference on input and output, so they are not shared with the next call
+        m_batchFrames[n].image.release();
+        m_batchFrames[n].image_withoutBackground.release();
+    }
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Algo::run_segmentation(VideoBackgroundEraser_Frame& io_frame)
+{
+    if(0 <= m_partition_segmentation && 0 > apply_threadPartition(m_partitions[m_partition_segmentation])) {
+        logging_error("apply_threadPartition() failed.");
+        return -1;
+    }
+    std::vector<VideoBackgroundEraser_Frame*> frames(1, &io_frame);
+    return run_segmentation(frames);
+}
+
+int VideoBackgroundEraser_Algo::run_segmentation(std::vector<VideoBackgroundEraser_Frame*>& io_frames)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    ScopedLatency latency(m_latencies[Stage_Segmentation]);
+    const auto start = std::chrono::steady_clock::now();
+    for(auto frame : io_frames) {
+        frame->segmentationStart = start;
+    }
+    if(m_settings.deeplabv3_inference.background_classId_vector.empty()) {
+        logging_error("m_settings.deeplabv3_inference.background_classId_vector is empty.");
+        return -1;
+    }
 
-    cv::Mat imageFloat;
-    if(CV_32F != i_image.depth()) {
+    for(auto frame : io_frames) {
+        const cv::Mat& i_image = frame->image;
+        cv::Mat& imageNetwork = frame->imageNetwork;
+        // CV_8U and CV_32F are read directly by the networks preprocessing
         switch(i_image.depth()) {
-        case CV_8U: i_image.convertTo(imageFloat, CV_32F, 1./255.); break;
-        case CV_16U: i_image.convertTo(imageFloat, CV_32F, 1./65535.); break;
+        case CV_8U:
+        case CV_32F: imageNetwork = i_image; break;
+        case CV_16U:
+            // Never convert into imageNetwork, it may share the data of a previous input
+            i_image.convertTo(frame->imageNetwork_buffer, CV_32F, 1./65535.);
+            imageNetwork = frame->imageNetwork_buffer;
+            break;
         default:
             logging_error("Unsuported input image depth (" << cv::typeToString(i_image.depth()) << "). Supported depths are CV_32F, CV_16U and CV_8U");
             return -1;
         }
+
+        CV_Assert(CV_8UC3 == imageNetwork.type() || CV_32FC3 == imageNetwork.type());
+
+        frame->isSceneCut = false;
+        if(m_settings.enable_sceneCutDetection) {
+            if(0 > m_sceneCutDetector.run(imageNetwork, frame->isSceneCut)) {
+                logging_error("m_sceneCutDetector.run() failed.");
+                return -1;
+            }
+            if(frame->isSceneCut) {
+                logging_info("Scene cut at frame " << frame->index);
+                m_nbSceneCuts++;
+                std::lock_guard<std::mutex> lock(m_sceneCuts_mutex);
+                m_sceneCuts.push_back(frame->index);
+            }
+        }
+
+        frame->isDuplicate = false;
+        if(m_settings.enable_duplicateDetection) {
+            detect_duplicate(*frame);
+        }
+    }
+
+    // Only the frames which are not duplicates are segmented
+    std::vector<VideoBackgroundEraser_Frame*>& frames = m_workspace.segmentation.frames;
+    frames.clear();
+    for(auto frame : io_frames) {
+        if(false == frame->isDuplicate) {
+            frames.push_back(frame);
+        }
+    }
+
+    if(frames.empty()) {
+        // Nothing to segment
+    } else if(1 < m_settings.keyframe_interval) {
+        // Keyframe decisions depend on the previous frame : frames are processed one after the other
+        for(auto frame : frames) {
+            if(0 > segment_keyframe(*frame)) {
+                logging_error("segment_keyframe() failed.");
+                return -1;
+            }
+        }
+    } else if(0 > infer_backgroundMasks(frames)) {
+        logging_error("infer_backgroundMasks() failed.");
+        return -1;
+    }
+    frames.clear();
+
+    // Duplicates take the mask of the last frame which was not a duplicate, in order
+    if(m_settings.enable_duplicateDetection) {
+        for(auto frame : io_frames) {
+            if(frame->isDuplicate) {
+                m_duplicate_backgroundMask.copyTo(frame->backgroundMask);
+                m_nbFrames_duplicate++;
+            } else {
+                frame->backgroundMask.copyTo(m_duplicate_backgroundMask);
+            }
+        }
+    }
+
+    if(m_settings.enable_pooledAllocator) {
+        PoolAllocator::get_instance().mark_frame(static_cast<int>(io_frames.size()));
+    }
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Algo::init_threading()
+{
+    const int budget = m_settings.threads_budget;
+    if(0 >= budget) {
+        return 0;
+    }
+    if(0.f > m_settings.threads_openCVRatio || 1.f <= m_settings.threads_openCVRatio) {
+        logging_error("m_settings.threads_openCVRatio (" << m_settings.threads_openCVRatio << ") must be in [0, 1[.");
+        return -1;
+    }
+    if(m_settings.enable_concurrentNetworks
+       && (0.f >= m_settings.threads_segmentationRatio || 1.f <= m_settings.threads_segmentationRatio)) {
+        logging_error("m_settings.threads_segmentationRatio (" << m_settings.threads_segmentationRatio << ") must be in ]0, 1[.");
+        return -1;
+    }
+    const int nbSystemCores = static_cast<int>(std::thread::hardware_concurrency());
+    if(m_settings.enable_threadPinning
+       && (0 > m_settings.threads_firstCore || (0 < nbSystemCores && m_settings.threads_firstCore + budget > nbSystemCores))) {
+        logging_error("Cores " << m_settings.threads_firstCore << " to " << m_settings.threads_firstCore + budget - 1
+                      << " are not all available, the system has " << nbSystemCores << " cores.");
+        return -1;
+    }
+
+    // Torch cores first, then the OpenCV ones. With a single core, every partition shares it
+    const int nbOpenCV = (1 == budget) ? 1 : std::min(budget - 1, std::max(1, cvRound(budget*m_settings.threads_openCVRatio)));
+    const int nbTorch = (1 == budget) ? 1 : budget - nbOpenCV;
+    auto add_partition = [this](const char* i_name, int i_offset, int i_nbCores) {
+        ThreadPartition partition;
+        partition.name = i_name;
+        partition.firstCore = m_settings.enable_threadPinning ? m_settings.threads_firstCore + i_offset : -1;
+        partition.nbCores = i_nbCores;
+        partition.nbThreads = i_nbCores;
+        m_partitions.push_back(partition);
+    };
+    // Whole torch share, for the stages run one after the other by run() and run_batch()
+    m_partition_synchronous.name = "torch";
+    m_partition_synchronous.firstCore = m_settings.enable_threadPinning ? m_settings.threads_firstCore : -1;
+    m_partition_synchronous.nbCores = nbTorch;
+    m_partition_synchronous.nbThreads = nbTorch;
+    const bool isTorchPoolPerThread = get_isTorchPoolPerThread();
+    if(m_settings.enable_concurrentNetworks && 1 < nbTorch && isTorchPoolPerThread) {
+        const int nbSegmentation = std::min(nbTorch - 1, std::max(1, cvRound(nbTorch*m_settings.threads_segmentationRatio)));
+        add_partition("segmentation", 0, nbSegmentation);
+        add_partition("matting", nbSegmentation, nbTorch - nbSegmentation);
+        m_partition_segmentation = 0;
+        m_partition_matting = 1;
     } else {
-        imageFloat = i_image;
+        if(m_settings.enable_concurrentNetworks && false == isTorchPoolPerThread) {
+            logging_warning("libtorch runs its native thread pool, sized for the whole process : both networks share a single torch partition.");
+        } else if(m_settings.enable_concurrentNetworks) {
+            logging_info("A single torch core : both networks share it.");
+        }
+        add_partition("torch", 0, nbTorch);
+        m_partition_segmentation = 0;
+        m_partition_matting = 0;
+    }
+    add_partition("opencv", (1 == budget) ? 0 : nbTorch, nbOpenCV);
+
+    // Process-wide, and only accepted before the first inter-op work : a later instance keeps the first setting
+    if(0 < m_settings.threads_torchInterOp) {
+        try {
+            at::set_num_interop_threads(m_settings.threads_torchInterOp);
+        } catch(const c10::Error&) {
+            logging_info("The number of torch inter-op threads was already set, " << at::get_num_interop_threads() << " threads.");
+        }
+    }
+    if(0 > start_openCVPool(m_partitions.back())) {
+        logging_error("start_openCVPool() failed.");
+        return -1;
+    }
+
+    for(auto& partition : m_partitions) {
+        logging_info("Thread partition " << partition.name << " : " << partition.nbThreads << " threads"
+                     << (0 <= partition.firstCore ? " on cores " + std::to_string(partition.firstCore) + " to "
+                         + std::to_string(partition.firstCore + partition.nbCores - 1) : std::string()));
+    }
+
+    // The warmup runs its forwards from this thread : it gets the whole torch share, as run() does
+    if(0 > apply_threadPartition(m_partition_synchronous)) {
+        logging_error("apply_threadPartition() failed.");
+        return -1;
+    }
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Algo::apply_synchronousPartition()
+{
+    if(0 > m_partition_segmentation) {
+        return 0;
+    }
+    if(m_partition_segmentation != m_partition_matting && false == m_isSynchronousWarned) {
+        logging_warning("enable_concurrentNetworks only applies to stages run from their own threads (VideoBackgroundEraser_Pipeline) : "
+                        "run() and run_batch() use the whole torch partition.");
+        m_isSynchronousWarned = true;
+    }
+    return apply_threadPartition(m_partition_synchronous);
+}
+
+int VideoBackgroundEraser_Algo::warmup()
+{
+    const cv::Size size = m_settings.warmup_size;
+    if(0 >= size.area() || 0 >= m_settings.warmup_nbIterations) {
+        return 0;
+    }
+    const auto start = std::chrono::steady_clock::now();
+
+    // Same paths, types and resolutions as the frames : the JIT specializes its graphs on the shapes it saw.
+    // The outputs are not used
+    std::vector<cv::Mat> images(1, cv::Mat::zeros(size, CV_8UC3)); // /!\ Dynamic alloc
+    std::vector<cv::Mat> outputs;
+    const float scale = m_settings.imageMatting_scale;
+    const cv::Size size_down(cvRound(size.width*scale), cvRound(size.height*scale));
+    std::vector<cv::Mat> images_down(1, cv::Mat::zeros(size_down, CV_8UC3)); // /!\ Dynamic alloc
+    std::vector<cv::Mat> trimaps_down(1, cv::Mat(size_down, CV_8UC1, cv::Scalar(128))); // /!\ Dynamic alloc
+    std::vector<cv::Mat> alphas;
+    for(int i = 0 ; i < m_settings.warmup_nbIterations ; ++i) {
+        int result = 0;
+        if(m_scheduler) {
+            result = m_settings.enable_fusedBackgroundMask
+                     ? m_scheduler->run_backgroundMask(images, outputs, m_settings.input_isBGR, m_settings.scheduler_priority)
+                     : m_scheduler->run_segmentation(images, outputs, m_settings.input_isBGR, m_settings.scheduler_priority);
+        } else {
+            result = m_settings.enable_fusedBackgroundMask
+                     ? m_deeplabv3_inference.run_backgroundMask(images, outputs, m_settings.input_isBGR)
+                     : m_deeplabv3_inference.run(images, outputs, m_settings.input_isBGR);
+        }
+        if(0 > result) {
+            logging_error("DeepLabV3 warmup failed.");
+            return -1;
+        }
+        if(0 > run_deepImageMatting(images_down, trimaps_down, alphas)) {
+            logging_error("DeepImageMatting warmup failed.");
+            return -1;
+        }
+    }
+    logging_info("Warmup at " << size << " in " << get_elapsed_ms(start) << " ms");
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Algo::run_deepImageMatting(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                                                     std::vector<cv::Mat>& io_alpha_predictions)
+{
+    if(m_scheduler) {
+        return m_scheduler->run_matting(i_images, i_trimaps, io_alpha_predictions, m_settings.input_isBGR, m_settings.scheduler_priority);
     }
+    return m_deepimagematting_inference.run(i_images, i_trimaps, io_alpha_predictions, m_settings.input_isBGR);
+}
 
-    CV_Assert(CV_32FC3 == imageFloat.type());
+int VideoBackgroundEraser_Algo::infer_backgroundMasks(std::vector<VideoBackgroundEraser_Frame*>& io_frames)
+{
+    ScopedLatency latency(m_latencies[Stage_DeepLabV3]);
+    auto& workspace = m_workspace.segmentation;
+    std::vector<cv::Mat>& imagesNetwork = workspace.imagesNetwork;
+    imagesNetwork.clear();
+    for(auto frame : io_frames) {
+        imagesNetwork.push_back(frame->imageNetwork);
+    }
+
+    // DeepLabV3 directly reduces its scores to the background mask, written in the buffers of the frames
+    if(m_settings.enable_fusedBackgroundMask) {
+        std::vector<cv::Mat>& backgroundMasks = workspace.backgroundMasks;
+        backgroundMasks.resize(io_frames.size());
+        for(size_t n = 0 ; n < io_frames.size() ; ++n) {
+            backgroundMasks[n] = io_frames[n]->backgroundMask;
+        }
+        const int result = m_scheduler
+                           ? m_scheduler->run_backgroundMask(imagesNetwork, backgroundMasks, m_settings.input_isBGR, m_settings.scheduler_priority)
+                           : m_deeplabv3_inference.run_backgroundMask(imagesNetwork, backgroundMasks, m_settings.input_isBGR);
+        if(0 > result) {
+            logging_error("run_backgroundMask() failed.");
+            return -1;
+        }
+        for(size_t n = 0 ; n < io_frames.size() ; ++n) {
+            io_frames[n]->backgroundMask = backgroundMasks[n];
+            backgroundMasks[n].release();
+        }
+
+        m_nbFrames_inferred += io_frames.size();
+        return 0;
+    }
 
     // Run segmentation with DeepLabV3 to create a mask of the background
-    cv::Mat segmentation;
-    m_deeplabv3_inference.run(imageFloat, segmentation);
+    std::vector<cv::Mat>& segmentations = workspace.segmentations;
+    const int result = m_scheduler
+                       ? m_scheduler->run_segmentation(imagesNetwork, segmentations, m_settings.input_isBGR, m_settings.scheduler_priority)
+                       : m_deeplabv3_inference.run(imagesNetwork, segmentations, m_settings.input_isBGR);
+    if(0 > result) {
+        logging_error("DeepLabV3 run() failed.");
+        return -1;
+    }
 
     // Debug display
 //    {
 //        cv::Mat segmentation_uint8;
-//        segmentation.convertTo(segmentation_uint8, CV_8U, 50);
+//        segmentations[0].convertTo(segmentation_uint8, CV_8U, 50);
 //        cv::Mat segmentationColor;
 //        cv::applyColorMap(segmentation_uint8, segmentationColor, cv::COLORMAP_HSV);
 //        cv::imshow("segmentationColor", segmentationColor);
 //    }
 //    {
 //        cv::Mat segmentation_uint8;
-//        segmentation.convertTo(segmentation_uint8, CV_8U);
+//        segmentations[0].convertTo(segmentation_uint8, CV_8U);
 //        cv::cvtColor(segmentation_uint8, segmentation_uint8, cv::COLOR_GRAY2BGR);
 //        cv::imshow("segmentation_uint8", segmentation_uint8);
 //    }
 
     // Create background mask
-    cv::Mat backgroundMask;
-    if(m_settings.deeplabv3_inference.background_classId_vector.empty()) {
-        logging_error("m_settings.deeplabv3_inference.background_classId_vector is empty.");
-        return -1;
+    for(size_t n = 0 ; n < io_frames.size() ; ++n) {
+        const cv::Mat& segmentation = segmentations[n];
+        cv::Mat& backgroundMask = io_frames[n]->backgroundMask;
+        bool isFirstClass = true;
+        for(auto& background_id : m_settings.deeplabv3_inference.background_classId_vector) {
+            if(isFirstClass) {
+                cv::compare(segmentation, background_id, backgroundMask, cv::CMP_EQ);
+                isFirstClass = false;
+            } else {
+                cv::compare(segmentation, background_id, workspace.classMask, cv::CMP_EQ);
+                cv::bitwise_or(backgroundMask, workspace.classMask, backgroundMask);
+            }
+        }
     }
-    for(auto& background_id : m_settings.deeplabv3_inference.background_classId_vector) {
-        if(backgroundMask.empty()) {
-            backgroundMask = (segmentation == background_id);
-        } else {
-            backgroundMask = backgroundMask | (segmentation == background_id);
+
+    m_nbFrames_inferred += io_frames.size();
+
+    return 0;
+}
+
+void VideoBackgroundEraser_Algo::detect_duplicate(VideoBackgroundEraser_Frame& io_frame)
+{
+    auto& workspace = m_workspace.segmentation;
+
+    // The mean absolute difference of small thumbnails ignores noise and compression artifacts, and costs a single
+    // pass over the image
+    const cv::Mat& imageNetwork = io_frame.imageNetwork;
+    const int width = std::max(1, std::min(imageNetwork.cols, m_settings.duplicate_thumbnailWidth));
+    const int height = std::max(1, cvRound(static_cast<double>(width) * imageNetwork.rows / imageNetwork.cols));
+    cv::resize(imageNetwork, workspace.thumbnail, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    const cv::Mat* thumbnail = &workspace.thumbnail;
+    if(CV_8U != workspace.thumbnail.depth()) {
+        workspace.thumbnail.convertTo(workspace.thumbnail_uint8, CV_8U, 255.);
+        thumbnail = &workspace.thumbnail_uint8;
+    }
+
+    // The first frame, or the first after a resolution change, is never a duplicate
+    if(m_duplicate_size == imageNetwork.size() && m_duplicate_thumbnail.size() == thumbnail->size()) {
+        const double difference = cv::norm(*thumbnail, m_duplicate_thumbnail, cv::NORM_L1) / (thumbnail->total() * thumbnail->channels());
+        io_frame.isDuplicate = (difference <= m_settings.duplicate_maxDifference);
+    }
+
+    // Frames are compared with the last frame which was not a duplicate, so a slow fade is never skipped entirely
+    if(false == io_frame.isDuplicate) {
+        thumbnail->copyTo(m_duplicate_thumbnail);
+        m_duplicate_size = imageNetwork.size();
+    }
+}
+
+int VideoBackgroundEraser_Algo::segment_keyframe(VideoBackgroundEraser_Frame& io_frame)
+{
+    auto& workspace = m_workspace.segmentation;
+
+    // Grayscale image at keyframe_scale, for the optical flow
+    const float scale = std::max(0.01f, std::min(1.f, m_settings.keyframe_scale));
+    const cv::Mat& imageNetwork = io_frame.imageNetwork;
+    const cv::Size size(std::max(1, cvRound(imageNetwork.cols*scale)), std::max(1, cvRound(imageNetwork.rows*scale)));
+    cv::resize(imageNetwork, workspace.image_small, size, 0, 0, cv::INTER_AREA);
+    const cv::Mat* image_small_uint8 = &workspace.image_small;
+    if(CV_8U != workspace.image_small.depth()) {
+        workspace.image_small.convertTo(workspace.image_small_uint8, CV_8U, 255.);
+        image_small_uint8 = &workspace.image_small_uint8;
+    }
+    cv::Mat& gray = workspace.gray;
+    cv::cvtColor(*image_small_uint8, gray, m_settings.input_isBGR ? cv::COLOR_BGR2GRAY : cv::COLOR_RGB2GRAY);
+
+    bool isKeyframe = m_keyframe_mask.empty() || m_keyframe_grayPrev.size() != gray.size()
+                      || ++m_keyframe_age >= m_settings.keyframe_interval;
+    // The flow is meaningless across a scene cut
+    if(io_frame.isSceneCut && false == isKeyframe) {
+        logging_info("Forced keyframe : scene cut");
+        isKeyframe = true;
+        m_nbKeyframes_forced++;
+    }
+    if(false == isKeyframe) {
+        // Flow from the current frame to the previous one
+        m_keyframe_optFlow->calc(gray, m_keyframe_grayPrev, workspace.flow);
+        flowToMap(workspace.flow, workspace.mapXY);
+
+        // Mean L1 norm of the flow, in pixels at the input resolution
+        const double meanFlow = cv::norm(workspace.flow, cv::NORM_L1) / (workspace.flow.total() * scale);
+        // Mean difference between the current frame and the previous one warped onto it, in [0, 1]
+        cv::remap(m_keyframe_grayPrev, workspace.warped, workspace.mapXY, cv::noArray(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+        const double residual = cv::norm(workspace.warped, gray, cv::NORM_L1) / (gray.total() * 255.);
+        // Change of the background area since the keyframe, in ratio of the frame area
+        cv::remap(m_keyframe_mask, workspace.warpedMask, workspace.mapXY, cv::noArray(), cv::INTER_NEAREST, cv::BORDER_REPLICATE);
+        const double areaChange = std::abs(cv::countNonZero(workspace.warpedMask) - m_keyframe_area) / static_cast<double>(gray.total());
+
+        if(meanFlow > m_settings.keyframe_maxMeanFlow || residual > m_settings.keyframe_maxResidual
+           || areaChange > m_settings.keyframe_maxAreaChange) {
+            logging_info("Forced keyframe : mean flow " << meanFlow << ", residual " << residual << ", area change " << areaChange);
+            isKeyframe = true;
+            m_nbKeyframes_forced++;
         }
     }
 
-    // Prepare intermediary data
-    cv::Mat foregroundMask;
-    cv::Mat image_rgb_uint8;
-    imageFloat.convertTo(image_rgb_uint8, CV_8U, 255.);
+    if(isKeyframe) {
+        std::vector<VideoBackgroundEraser_Frame*> frames(1, &io_frame);
+        if(0 > infer_backgroundMasks(frames)) {
+            logging_error("infer_backgroundMasks() failed.");
+            return -1;
+        }
+        cv::resize(io_frame.backgroundMask, m_keyframe_mask, size, 0, 0, cv::INTER_NEAREST);
+        m_keyframe_area = cv::countNonZero(m_keyframe_mask);
+        m_keyframe_age = 0;
+    } else {
+        // Propagate the mask of the previous frame
+        std::swap(m_keyframe_mask, workspace.warpedMask);
+        cv::resize(m_keyframe_mask, io_frame.backgroundMask, imageNetwork.size(), 0, 0, cv::INTER_NEAREST);
+        m_nbFrames_propagated++;
+    }
+
+    // The current image becomes the previous one, the buffer of the previous one is reused for the next frame
+    std::swap(m_keyframe_grayPrev, gray);
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Algo::run_trimap(VideoBackgroundEraser_Frame& io_frame)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    ScopedLatency latency(m_latencies[Stage_Trimap]);
+
+    auto& workspace = m_workspace.trimap;
+    const cv::Mat& i_image = io_frame.image;
+    const cv::Mat& backgroundMask = io_frame.backgroundMask;
+    cv::Mat& foregroundMask = io_frame.foregroundMask;
 
     // Run temporal processing to try and keep consistency between successive frames
     if(m_settings.enable_temporalManagement) {
-        if(0 > temporalManagement(image_rgb_uint8, backgroundMask, foregroundMask)) {
+        // Prepare intermediary data
+        const cv::Mat* image_rgb_uint8 = &i_image;
+        switch(i_image.depth()) {
+        case CV_8U: break;
+        case CV_16U: i_image.convertTo(workspace.image_rgb_uint8, CV_8U, 1./257.); image_rgb_uint8 = &workspace.image_rgb_uint8; break;
+        default: i_image.convertTo(workspace.image_rgb_uint8, CV_8U, 255.); image_rgb_uint8 = &workspace.image_rgb_uint8; break;
+        }
+        ScopedLatency temporalLatency(m_latencies[Stage_TemporalManagement]);
+        if(0 > temporalManagement(*image_rgb_uint8, backgroundMask, foregroundMask, io_frame.isDuplicate, io_frame.isSceneCut)) {
             logging_error("temporalManagement() failed.");
             return -1;
         }
     } else {
-        foregroundMask = 0 == backgroundMask;
+        cv::compare(backgroundMask, 0, foregroundMask, cv::CMP_EQ);
     }
 
     // Generate trimap
-    cv::Mat trimap;
+    cv::Mat& trimap = io_frame.trimap;
+    cv::Mat& trimap_down = io_frame.trimap_down;
     {
         // Downscale
         const float scale = m_settings.imageMatting_scale;
-        cv::Mat foregroundMask_down, trimap_down;
+        cv::Mat& foregroundMask_down = workspace.foregroundMask_down;
         cv::resize(foregroundMask, foregroundMask_down, cv::Size(), scale, scale, cv::INTER_NEAREST);
         // Generate trimap
         compute_trimap(foregroundMask_down, trimap_down);
@@ -135,143 +851,403 @@ int VideoBackgroundEraser_Algo::run(const cv::Mat& i_image, cv::Mat& o_image_wit
         cv::resize(trimap_down, trimap, foregroundMask.size(), 0, 0, cv::INTER_NEAREST);
     }
 
-    // Convert image rgb with trimap to make a rgba image
-    cv::Mat imageFloat_rgba;
-    std::vector<cv::Mat> image_rgba_planar;
-    cv::split(imageFloat, image_rgba_planar);
-    image_rgba_planar.push_back(cv::Mat());
-    trimap.convertTo(image_rgba_planar.back(), CV_32F, 1./255.);
-    cv::merge(image_rgba_planar, imageFloat_rgba);
+    return 0;
+}
 
+int VideoBackgroundEraser_Algo::run_matting(VideoBackgroundEraser_Frame& io_frame)
+{
+    if(0 <= m_partition_matting && 0 > apply_threadPartition(m_partitions[m_partition_matting])) {
+        logging_error("apply_threadPartition() failed.");
+        return -1;
+    }
+    std::vector<VideoBackgroundEraser_Frame*> frames(1, &io_frame);
+    return run_matting(frames);
+}
 
-    // Run Deep Image Matting
-    cv::Mat alpha_prediction;
-    {
-        // Downscale
-        const float scale = m_settings.imageMatting_scale;
-        cv::Mat imageFloat_rgba_down;
-        cv::Mat alpha_prediction_down;
-        cv::resize(imageFloat_rgba, imageFloat_rgba_down, cv::Size(), scale, scale, cv::INTER_AREA);
-        // Run DIM
-        m_deepimagematting_inference.run(imageFloat_rgba_down, alpha_prediction_down);
-        // Upscale
-        cv::resize(alpha_prediction_down, alpha_prediction, imageFloat_rgba.size(), 0, 0, cv::INTER_CUBIC);
+int VideoBackgroundEraser_Algo::run_matting(std::vector<VideoBackgroundEraser_Frame*>& io_frames)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    ScopedLatency latency(m_latencies[Stage_Matting]);
+
+    auto& workspace = m_workspace.matting;
+    const size_t nbFrames = io_frames.size();
+
+    // Duplicates reuse the alpha of the last frame which was not a duplicate, as long as there is one
+    std::vector<uchar>& isAlphaReused = workspace.isAlphaReused;
+    isAlphaReused.assign(nbFrames, 0);
+    if(m_settings.enable_duplicateDetection) {
+        bool hasAlpha = (m_duplicate_alpha.size() == io_frames[0]->image.size() && m_duplicate_alpha.depth() == io_frames[0]->image.depth());
+        for(size_t n = 0 ; n < nbFrames ; ++n) {
+            isAlphaReused[n] = (io_frames[n]->isDuplicate && hasAlpha) ? 1 : 0;
+            hasAlpha = hasAlpha || (false == io_frames[n]->isDuplicate);
+        }
+    }
+
+    std::vector<cv::Mat>& images_down = workspace.images_down;
+    std::vector<cv::Mat>& alpha_predictions_down = workspace.alpha_predictions_down;
+    workspace.imagesNetwork_down.resize(nbFrames);
+    images_down.resize(nbFrames);
+    alpha_predictions_down.resize(nbFrames);
+    workspace.rois.resize(nbFrames);
+    for(size_t n = 0 ; n < nbFrames ; ++n) {
+        if(isAlphaReused[n]) {
+            continue;
+        }
+        // Downscale, the trimap is already at the right scale
+        const cv::Mat& trimap_down = io_frames[n]->trimap_down;
+        if(trimap_down.size() != io_frames[n]->imageNetwork.size()) {
+            cv::resize(io_frames[n]->imageNetwork, workspace.imagesNetwork_down[n], trimap_down.size(), 0, 0, cv::INTER_AREA);
+            images_down[n] = workspace.imagesNetwork_down[n];
+        } else {
+            images_down[n] = io_frames[n]->imageNetwork;
+        }
+    }
+
+    // Deep Image Matting is only useful where the trimap is unknown : select what goes through the network
+    std::vector<size_t>& fullFrames = workspace.fullFrames;
+    std::vector<size_t>& roiFrames = workspace.roiFrames;
+    fullFrames.clear();
+    roiFrames.clear();
+    cv::Size cropSize(0, 0);
+    for(size_t n = 0 ; n < nbFrames ; ++n) {
+        const cv::Mat& trimap_down = io_frames[n]->trimap_down;
+        std::vector<cv::Rect>& rois = workspace.rois[n];
+        rois.clear();
+        if(isAlphaReused[n]) {
+            continue;
+        }
+        cv::compare(trimap_down, 128, workspace.unknownMask, cv::CMP_EQ);
+        const int nbUnknownPixels = cv::countNonZero(workspace.unknownMask);
+        m_nbUnknownPixels += nbUnknownPixels;
+        m_nbTrimapPixels += trimap_down.total();
+        m_unknownRatio_lastFrame = static_cast<double>(nbUnknownPixels) / trimap_down.total();
+        if(0 == nbUnknownPixels) {
+            // No unknown pixel, which includes an empty foreground : alpha is the trimap itself
+            trimap_down.convertTo(alpha_predictions_down[n], CV_32F, 1./255.);
+            continue;
+        }
+
+        if(m_settings.enable_roiMatting) {
+            compute_mattingRois(workspace.unknownMask, rois);
+            // Crops of a batch share the same size, rounded up so the input tensor is rarely reallocated
+            cv::Size frameCropSize(0, 0);
+            for(auto& roi : rois) {
+                frameCropSize.width = std::max(frameCropSize.width, roi.width);
+                frameCropSize.height = std::max(frameCropSize.height, roi.height);
+            }
+            frameCropSize.width = std::min(trimap_down.cols, 32*((frameCropSize.width + 31)/32));
+            frameCropSize.height = std::min(trimap_down.rows, 32*((frameCropSize.height + 31)/32));
+            // Fall back to the whole frame when the crops would cover most of it
+            const double cropsArea = static_cast<double>(rois.size()) * frameCropSize.area();
+            if(cropsArea <= m_settings.roiMatting_maxAreaRatio * trimap_down.total()) {
+                cropSize.width = std::max(cropSize.width, frameCropSize.width);
+                cropSize.height = std::max(cropSize.height, frameCropSize.height);
+                roiFrames.push_back(n);
+                continue;
+            }
+            rois.clear();
+        }
+        fullFrames.push_back(n);
     }
 
-    // Post process alpha_prediction
-    alpha_prediction.setTo(0, 0 == trimap);
-    alpha_prediction.setTo(255, 255 == trimap);
+    std::vector<cv::Mat>& imagesNetwork = workspace.imagesNetwork;
+    std::vector<cv::Mat>& trimaps_down = workspace.trimaps_down;
+    std::vector<cv::Mat>& alphas = workspace.alphas;
 
-    // Replace alpha in image_rgba_planar with alpha_prediction
-    image_rgba_planar[3] = alpha_prediction;
-    cv::Mat image_withoutBackground;
-    cv::merge(image_rgba_planar, image_withoutBackground);
+    // Run Deep Image Matting on whole frames
+    if(!fullFrames.empty()) {
+        ScopedLatency dimLatency(m_latencies[Stage_DeepImageMatting]);
+        imagesNetwork.clear();
+        trimaps_down.clear();
+        alphas.clear();
+        for(auto n : fullFrames) {
+            imagesNetwork.push_back(images_down[n]);
+            trimaps_down.push_back(io_frames[n]->trimap_down);
+            // Written in place
+            alphas.push_back(alpha_predictions_down[n]);
+        }
+        if(0 > run_deepImageMatting(imagesNetwork, trimaps_down, alphas)) {
+            logging_error("run_deepImageMatting() failed.");
+            return -1;
+        }
+        for(size_t i = 0 ; i < fullFrames.size() ; ++i) {
+            alpha_predictions_down[fullFrames[i]] = alphas[i];
+        }
+    }
+
+    // Run Deep Image Matting on the crops around the unknown areas, all frames in a single forward
+    if(!roiFrames.empty()) {
+        ScopedLatency dimLatency(m_latencies[Stage_DeepImageMatting]);
+        imagesNetwork.clear();
+        trimaps_down.clear();
+        // Still shares the alpha of the full frames above : the forward must not write into them
+        alphas.clear();
+        std::vector<cv::Rect>& crops = workspace.crops;
+        crops.clear();
+        for(auto n : roiFrames) {
+            const cv::Mat& trimap_down = io_frames[n]->trimap_down;
+            for(auto& roi : workspace.rois[n]) {
+                // Same size for every crop, centered on the roi and kept inside the image
+                cv::Rect crop(roi.x + roi.width/2 - cropSize.width/2, roi.y + roi.height/2 - cropSize.height/2,
+                              cropSize.width, cropSize.height);
+                crop.x = std::max(0, std::min(crop.x, trimap_down.cols - crop.width));
+                crop.y = std::max(0, std::min(crop.y, trimap_down.rows - crop.height));
+                crops.push_back(crop);
+                imagesNetwork.push_back(images_down[n](crop));
+                trimaps_down.push_back(trimap_down(crop));
+            }
+        }
+        if(0 > run_deepImageMatting(imagesNetwork, trimaps_down, alphas)) {
+            logging_error("run_deepImageMatting() failed.");
+            return -1;
+        }
+
+        // Paste the unknown pixels of each roi, the others come from the trimap
+        size_t idx = 0;
+        for(auto n : roiFrames) {
+            const cv::Mat& trimap_down = io_frames[n]->trimap_down;
+            cv::Mat& alpha_prediction_down = alpha_predictions_down[n];
+            trimap_down.convertTo(alpha_prediction_down, CV_32F, 1./255.);
+            for(auto& roi : workspace.rois[n]) {
+                const cv::Rect& crop = crops[idx];
+                cv::compare(trimap_down(roi), 128, workspace.unknownMask, cv::CMP_EQ);
+                alphas[idx](roi - crop.tl()).copyTo(alpha_prediction_down(roi), workspace.unknownMask);
+                ++idx;
+            }
+        }
+    }
+
+    for(size_t n = 0 ; n < io_frames.size() ; ++n) {
+        const cv::Mat& i_image = io_frames[n]->image;
+        const cv::Mat& trimap = io_frames[n]->trimap;
+        cv::Mat& o_image_withoutBackground = io_frames[n]->image_withoutBackground;
+        const int fromTo[] = {0, 3};
+
+        // Duplicate : the previous alpha is attached to the new colors
+        if(isAlphaReused[n]) {
+            cv::cvtColor(i_image, o_image_withoutBackground, cv::COLOR_RGB2RGBA);
+            cv::mixChannels(&m_duplicate_alpha, 1, &o_image_withoutBackground, 1, fromTo, 1);
+            continue;
+        }
 
-    // Facultative conversion to the same depth as input
-    if(CV_32F != i_image.depth()) {
+        // Upscale
+        cv::Mat& alpha_prediction = workspace.alpha_prediction;
+        cv::resize(alpha_predictions_down[n], alpha_prediction, trimap.size(), 0, 0, cv::INTER_CUBIC);
+
+        // Post process alpha_prediction
+        cv::compare(trimap, 0, workspace.mask, cv::CMP_EQ);
+        alpha_prediction.setTo(0, workspace.mask);
+        cv::compare(trimap, 255, workspace.mask, cv::CMP_EQ);
+        alpha_prediction.setTo(1, workspace.mask);
+
+        // Convert alpha to the same depth as input
+        double alphaScale = 1.;
         switch(i_image.depth()) {
-        case CV_8U: image_withoutBackground.convertTo(o_image_withoutBackground, CV_8U, 255.); break;
-        case CV_16U: image_withoutBackground.convertTo(o_image_withoutBackground, CV_16U, 65535.); break;
+        case CV_8U: alphaScale = 255.; break;
+        case CV_16U: alphaScale = 65535.; break;
+        case CV_32F: alphaScale = 1.; break;
         default:
             logging_error("Unsuported input image depth (" << cv::typeToString(i_image.depth()) << "). Supported depths are CV_32F, CV_16U and CV_8U");
             return -1;
         }
-    } else {
-        o_image_withoutBackground = image_withoutBackground;
+        cv::Mat& alpha = workspace.alpha;
+        alpha_prediction.convertTo(alpha, i_image.depth(), alphaScale);
+
+        // Add alpha to the input image, without converting its colors
+        cv::cvtColor(i_image, o_image_withoutBackground, cv::COLOR_RGB2RGBA);
+        cv::mixChannels(&alpha, 1, &o_image_withoutBackground, 1, fromTo, 1);
+
+        // Keep alpha for the next duplicates, the previous buffer is reused for the next frame
+        if(m_settings.enable_duplicateDetection) {
+            std::swap(m_duplicate_alpha, alpha);
+        }
+    }
+
+    // Do not keep references on the frames
+    images_down.clear();
+    imagesNetwork.clear();
+    trimaps_down.clear();
+
+    // End-to-end latency of each frame, whether the stages ran one after the other or in a pipeline
+    const auto end = std::chrono::steady_clock::now();
+    for(auto frame : io_frames) {
+        m_latencies[Stage_Total].add(end - frame->segmentationStart);
+    }
+
+    // Periodic dump of the statistics, each time the number of frames crosses a multiple of the interval
+    const uint64_t nbFrames_prev = m_nbFrames.fetch_add(nbFrames);
+    if(0 == nbFrames_prev) {
+        m_timeToFirstFrame_ms = get_elapsed_ms(m_creationTime);
+        logging_info("Time to first frame : " << m_timeToFirstFrame_ms << " ms");
+    }
+    const uint64_t interval = static_cast<uint64_t>(std::max(1, m_settings.statistics_dumpInterval));
+    if(!m_settings.statistics_dumpPath.empty() && nbFrames_prev/interval != (nbFrames_prev + nbFrames)/interval) {
+        if(0 > dump_statistics(m_settings.statistics_dumpPath, m_settings.statistics_dumpFormat)) {
+            logging_error("dump_statistics() failed.");
+        }
     }
 
     return 0;
 }
 
 
-int VideoBackgroundEraser_Algo::temporalManagement(const cv::Mat& i_image_rgb_uint8, const cv::Mat& i_backgroundMask, cv::Mat& o_foregroundMask)
+int VideoBackgroundEraser_Algo::temporalManagement(const cv::Mat& i_image_rgb_uint8, const cv::Mat& i_backgroundMask, cv::Mat& o_foregroundMask,
+                                                   bool i_isDuplicate, bool i_isSceneCut)
 {
-    cv::Mat image_uint8;
-    cv::cvtColor(i_image_rgb_uint8, image_uint8, cv::COLOR_BGR2GRAY);
-    cv::Mat foregroundDetection = 0 == i_backgroundMask;
+    auto& workspace = m_workspace.trimap;
 
-    constexpr int nbPQ = 1;
-    constexpr int P[nbPQ] = {2};//, 2};
-    constexpr int Q[nbPQ] = {3};//, 8};
-    uint sumQ = 0;
-    for(int i = 0 ; i < nbPQ ; ++i) {
-        sumQ += Q[i];
+    // Optical flow and temporal state work at temporal_scale, only the final mask is upscaled
+    const float scale = std::max(0.01f, std::min(1.f, m_settings.temporal_scale));
+    const bool isScaled = (1.f != scale);
+    const cv::Mat* image_rgb_uint8 = &i_image_rgb_uint8;
+    const cv::Mat* backgroundMask = &i_backgroundMask;
+    cv::Mat* foregroundMask = &o_foregroundMask;
+    if(isScaled) {
+        const cv::Size size(std::max(1, cvRound(i_image_rgb_uint8.cols*scale)), std::max(1, cvRound(i_image_rgb_uint8.rows*scale)));
+        cv::resize(i_image_rgb_uint8, workspace.image_rgb_temporal, size, 0, 0, cv::INTER_AREA);
+        cv::resize(i_backgroundMask, workspace.backgroundMask_temporal, size, 0, 0, cv::INTER_NEAREST);
+        image_rgb_uint8 = &workspace.image_rgb_temporal;
+        backgroundMask = &workspace.backgroundMask_temporal;
+        foregroundMask = &workspace.foregroundMask_temporal;
     }
 
-    if(!m_image_prev.empty()) {
+    cv::Mat& image_uint8 = workspace.image_uint8;
+    cv::cvtColor(*image_rgb_uint8, image_uint8, cv::COLOR_BGR2GRAY);
+
+    const bool hasState = (!m_image_prev.empty() && m_image_prev.size() == image_uint8.size());
+    if(hasState && i_isSceneCut) {
+
+        // The history can not be warped across a scene cut : the flow is not computed,
+        // the state restarts from the current detection, which is the output of this frame
+        m_temporalState.create(image_uint8.size(), CV_8UC2);
+        foregroundMask->create(backgroundMask->size(), CV_8U);
+        cv::compare(*backgroundMask, 0, *foregroundMask, cv::CMP_EQ);
+        // History gets the current detection as its only bit, status is confirmed where detected
+        m_temporalState.setTo(0);
+        m_temporalState.setTo(cv::Scalar(1, 1), *foregroundMask);
+
+    } else if(hasState && i_isDuplicate) {
+
+        // Same image as the previous one : the flow is null, the history advances as if the frame was processed
+        update_temporalState(*backgroundMask, *foregroundMask);
+
+    } else if(hasState) {
 
         // Compute optical flow betwen previous and current image
         m_optFLow->calc(image_uint8, m_image_prev, m_flow);
 
         // Convert flow to coordinates map
-        m_mapXY.create(m_flow.size(), m_flow.type());
-        for(int y = 0 ; y < m_flow.rows ; ++y) {
-            for(int x = 0 ; x < m_flow.cols ; ++x) {
-                auto& f = m_flow.at<cv::Vec2f>(y, x);
-                m_mapXY.at<cv::Vec2f>(y, x) = {f(0) + x, f(1) + y};
-            }
-        }
+        flowToMap(m_flow, m_mapXY);
 
-        // Remap past detections onto current referential
-        for(auto& detections : m_detections_history) {
-            cv::remap(detections, detections, m_mapXY, cv::noArray(), cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar(0));
-        }
-        cv::remap(m_statusMap, m_statusMap, m_mapXY, cv::noArray(), cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar(0));
+        // Remap past detections and status onto current referential, both at once
+        // remap() can not work in place, the result is swapped with the source buffer
+        cv::remap(m_temporalState, workspace.remapped, m_mapXY, cv::noArray(), cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar(0));
+        std::swap(m_temporalState, workspace.remapped);
+
+        // Add the new detections to the history, vote and update the status, in a single pass
+        update_temporalState(*backgroundMask, *foregroundMask);
+
+    } else {
+        // Empty history and status
+        m_temporalState.create(image_uint8.size(), CV_8UC2);
+        m_temporalState.setTo(0);
+
+        foregroundMask->create(backgroundMask->size(), CV_8U);
+        foregroundMask->setTo(0);
+    }
 
-        // Populate detections_history with new foregroundDetection
-        {
-            cv::Mat newDetection = cv::Mat::zeros(foregroundDetection.size(), CV_8U);
-            newDetection.setTo(1, foregroundDetection);
-            m_detections_history.push_front(newDetection);
-            // Ensure we don't have too many detections
-            while(m_detections_history.size() > sumQ) {
-                m_detections_history.pop_back();
+    if(isScaled) {
+        cv::resize(*foregroundMask, o_foregroundMask, i_backgroundMask.size(), 0, 0, cv::INTER_NEAREST);
+    }
+
+    // The current image becomes the previous one, the buffer of the previous one is reused for the next frame
+    std::swap(m_image_prev, image_uint8);
+
+    return 0;
+}
+
+void VideoBackgroundEraser_Algo::update_temporalState(const cv::Mat& i_backgroundMask, cv::Mat& o_foregroundMask)
+{
+    // A detection is valid if it was seen more than P times in the last Q frames :
+    // the vote only depends on the Q bits of history, it is read from a table
+    const int Q = std::max(1, std::min(8, m_settings.temporal_Q));
+    const int P = m_settings.temporal_P;
+    if(m_temporalVote_P != P || m_temporalVote_Q != Q) {
+        for(int bits = 0 ; bits < 256 ; ++bits) {
+            int nbDetections = 0;
+            for(int b = bits ; 0 != b ; b >>= 1) {
+                nbDetections += b & 1;
             }
+            m_temporalVote[bits] = (nbDetections > P) ? 1 : 0;
         }
+        m_temporalVote_P = P;
+        m_temporalVote_Q = Q;
+    }
+    const uchar historyMask = static_cast<uchar>((1 << Q) - 1);
+    // A confirmed pixel stays foreground this number of frames after its last confirmation
+    constexpr uchar maxStatus = 2;
 
-        // Sum detections, the value in sumDetections will be the number of times
-        // this pixel was detected as foreground in the past images
-        cv::Mat confirmedDetection;
-        {
-            cv::Mat sumDetections[2] = {cv::Mat::zeros(foregroundDetection.size(), CV_8U),
-                                        cv::Mat::zeros(foregroundDetection.size(), CV_8U)};
-            int idx = 0;
-            int counter = 0;
-            for(auto& detections : m_detections_history) {
-                sumDetections[idx] = sumDetections[idx] + detections;
-                if(++counter >= Q[idx]) {
-                    ++idx;
-                    counter = 0;
+    o_foregroundMask.create(i_backgroundMask.size(), CV_8U);
+    cv::parallel_for_(cv::Range(0, i_backgroundMask.rows), [&](const cv::Range& i_range) {
+        for(int y = i_range.start ; y < i_range.end ; ++y) {
+            const uchar* backgroundMask = i_backgroundMask.ptr<uchar>(y);
+            uchar* state = m_temporalState.ptr<uchar>(y);
+            uchar* foregroundMask = o_foregroundMask.ptr<uchar>(y);
+            for(int x = 0 ; x < i_backgroundMask.cols ; ++x) {
+                // Channel 0 : history, bit i is the detection of i frames ago
+                const uchar history = static_cast<uchar>(((state[2*x] << 1) | (0 == backgroundMask[x])) & historyMask);
+                // Channel 1 : status, 1 when confirmed, increased each frame without confirmation, 0 once too old
+                uchar status = state[2*x + 1];
+                if(m_temporalVote[history]) {
+                    status = 1;
+                } else if(0 != status) {
+                    status = (status < maxStatus) ? status + 1 : 0;
                 }
-            }
-
-            // A detection is valid if it was seen more than P times in the last Q frames
-            confirmedDetection = sumDetections[0] > P[0];
-            for(int i = 1 ; i < nbPQ ; ++i) {
-                confirmedDetection = confirmedDetection & (sumDetections[i] > P[i]);
+                state[2*x] = history;
+                state[2*x + 1] = status;
+                // Effective foreground is when status is valid
+                foregroundMask[x] = (0 != status) ? 255 : 0;
             }
         }
+    });
+}
 
-        // Update status map
-        m_statusMap.setTo(1, confirmedDetection);
-        // Increase values of statusMap which were once confirmed but have not been seen recently
-        cv::add(m_statusMap, 1, m_statusMap, (0 == confirmedDetection) & (0 != m_statusMap));
-        // Remove the old confirmed values which have not been seen for too long
-        m_statusMap.setTo(0, m_statusMap > 2);
-
-        // Effective foreground is when statusMap is valid and we also add the current foreground detection
-        o_foregroundMask = (0 != m_statusMap);
-
-    } else {
-        m_statusMap = cv::Mat::zeros(image_uint8.size(), CV_8U);
+void VideoBackgroundEraser_Algo::compute_mattingRois(const cv::Mat& i_unknownMask, std::vector<cv::Rect>& o_rois)
+{
+    auto& workspace = m_workspace.matting;
+    const cv::Rect imageRect(0, 0, i_unknownMask.cols, i_unknownMask.rows);
+    const int padding = std::max(0, m_settings.roiMatting_padding);
 
-        o_foregroundMask.create(foregroundDetection.size(), CV_8U);
-        o_foregroundMask.setTo(0);
+    // One padded box per connected region of the unknown band
+    const int nbLabels = cv::connectedComponentsWithStats(i_unknownMask, workspace.labels, workspace.stats, workspace.centroids, 8, CV_32S);
+    o_rois.clear();
+    for(int label = 1 ; label < nbLabels ; ++label) {
+        const int* stats = workspace.stats.ptr<int>(label);
+        cv::Rect roi(stats[cv::CC_STAT_LEFT], stats[cv::CC_STAT_TOP], stats[cv::CC_STAT_WIDTH], stats[cv::CC_STAT_HEIGHT]);
+        roi.x -= padding;
+        roi.y -= padding;
+        roi.width += 2*padding;
+        roi.height += 2*padding;
+        o_rois.push_back(roi & imageRect);
     }
 
-    image_uint8.copyTo(m_image_prev);
-
-    return 0;
+    // Merge overlapping boxes, so that each pixel is pasted once
+    bool isMerged = true;
+    while(isMerged) {
+        isMerged = false;
+        for(size_t i = 0 ; i < o_rois.size() && !isMerged ; ++i) {
+            for(size_t j = i + 1 ; j < o_rois.size() && !isMerged ; ++j) {
+                if(0 < (o_rois[i] & o_rois[j]).area()) {
+                    o_rois[i] |= o_rois[j];
+                    o_rois.erase(o_rois.begin() + j);
+                    isMerged = true;
+                }
+            }
+        }
+    }
 }
 
 void VideoBackgroundEraser_Algo::compute_trimap(const cv::Mat& i_foreground, cv::Mat &o_trimap)
@@ -280,16 +1256,19 @@ void VideoBackgroundEraser_Algo::compute_trimap(const cv::Mat& i_foreground, cv:
     constexpr int kSize = 3;
     constexpr int dilate_iterations = 1;
     constexpr int erode_iterations = 15;
-    auto kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(kSize, kSize));
-    cv::Mat dilated;
+    static const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(kSize, kSize));
+    auto& workspace = m_workspace.trimap;
+    cv::Mat& dilated = workspace.dilated;
     cv::dilate(i_foreground, dilated, kernel, cv::Point(-1, -1), dilate_iterations);
-    cv::Mat eroded;
+    cv::Mat& eroded = workspace.eroded;
     cv::erode(i_foreground, eroded, kernel, cv::Point(-1, -1), erode_iterations);
 
     o_trimap.create(i_foreground.size(), CV_8U);
     o_trimap.setTo(128);
-    o_trimap.setTo(255, eroded >= 255);
-    o_trimap.setTo(0, dilated <= 0);
+    cv::compare(eroded, 255, workspace.mask, cv::CMP_GE);
+    o_trimap.setTo(255, workspace.mask);
+    cv::compare(dilated, 0, workspace.mask, cv::CMP_LE);
+    o_trimap.setTo(0, workspace.mask);
 }
 
 } /* namespace VBGE */
@@ -0,0 +1,237 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Compositor.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "Utils_Logging.hpp"
+
+#include "VideoBackgroundEraser_Compositor.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+// Value of an opaque alpha, or of a white pixel
+double get_maxValue(int i_depth)
+{
+    switch(i_depth) {
+    case CV_8U: return 255.;
+    case CV_16U: return 65535.;
+    default: return 1.;
+    }
+}
+
+#if CV_SIMD
+// (f*a + b*(255-a))/255, rounded, exact for 8-bit values
+inline cv::v_uint16 blend(const cv::v_uint16& i_f, const cv::v_uint16& i_b, const cv::v_uint16& i_a, const cv::v_uint16& i_ia)
+{
+    const cv::v_uint16 t = cv::v_mul_wrap(i_f, i_a) + cv::v_mul_wrap(i_b, i_ia) + cv::vx_setall_u16(128);
+    return (t + (t >> 8)) >> 8;
+}
+#endif
+
+void composite_row(const uchar* i_src, const uchar* i_background, int i_cols, uchar* o_dst)
+{
+    int x = 0;
+#if CV_SIMD
+    constexpr int nlanes = cv::v_uint8::nlanes;
+    const cv::v_uint16 v255 = cv::vx_setall_u16(255);
+    for( ; x <= i_cols - nlanes ; x += nlanes) {
+        cv::v_uint8 f[3], b[3], a;
+        cv::v_load_deinterleave(i_src + 4*x, f[0], f[1], f[2], a);
+        cv::v_load_deinterleave(i_background + 3*x, b[0], b[1], b[2]);
+        cv::v_uint16 a_lo, a_hi;
+        cv::v_expand(a, a_lo, a_hi);
+        const cv::v_uint16 ia_lo = v255 - a_lo;
+        const cv::v_uint16 ia_hi = v255 - a_hi;
+        cv::v_uint8 out[3];
+        for(int c = 0 ; c < 3 ; ++c) {
+            cv::v_uint16 f_lo, f_hi, b_lo, b_hi;
+            cv::v_expand(f[c], f_lo, f_hi);
+            cv::v_expand(b[c], b_lo, b_hi);
+            out[c] = cv::v_pack(blend(f_lo, b_lo, a_lo, ia_lo), blend(f_hi, b_hi, a_hi, ia_hi));
+        }
+        cv::v_store_interleave(o_dst + 3*x, out[0], out[1], out[2]);
+    }
+#endif
+    for( ; x < i_cols ; ++x) {
+        const int a = i_src[4*x + 3];
+        for(int c = 0 ; c < 3 ; ++c) {
+            const int t = i_src[4*x + c]*a + i_background[3*x + c]*(255 - a) + 128;
+            o_dst[3*x + c] = static_cast<uchar>((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+template<typename T>
+void composite_row(const T* i_src, const T* i_background, int i_cols, T* o_dst)
+{
+    const float alphaScale = static_cast<float>(1./get_maxValue(cv::DataType<T>::depth));
+    for(int x = 0 ; x < i_cols ; ++x) {
+        const float a = i_src[4*x + 3] * alphaScale;
+        for(int c = 0 ; c < 3 ; ++c) {
+            o_dst[3*x + c] = cv::saturate_cast<T>(a*i_src[4*x + c] + (1.f - a)*i_background[3*x + c]);
+        }
+    }
+}
+
+template<typename T>
+void composite_image(const cv::Mat& i_image, const cv::Mat& i_background, cv::Mat& o_composite)
+{
+    // A single row of background is used for every row
+    const bool isSingleRow = (1 == i_background.rows);
+    cv::parallel_for_(cv::Range(0, i_image.rows), [&](const cv::Range& i_range) {
+        for(int y = i_range.start ; y < i_range.end ; ++y) {
+            composite_row(i_image.ptr<T>(y), i_background.ptr<T>(isSingleRow ? 0 : y), i_image.cols, o_composite.ptr<T>(y));
+        }
+    });
+}
+
+} /* namespace */
+
+VideoBackgroundEraser_Compositor::VideoBackgroundEraser_Compositor(bool i_isBGR)
+    : m_isBGR(i_isBGR)
+{
+
+}
+
+VideoBackgroundEraser_Compositor::~VideoBackgroundEraser_Compositor()
+{
+
+}
+
+int VideoBackgroundEraser_Compositor::set_background(const cv::Mat& i_background, int i_interpolation)
+{
+    if(i_background.empty() || 3 != i_background.channels()) {
+        logging_error("i_background must have 3 channels.");
+        return -1;
+    }
+
+    m_background = i_background;
+    m_interpolation = i_interpolation;
+    m_backgroundVideo.release();
+    m_backgroundType = BackgroundType::Image;
+    m_preparedDepth = -1;
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Compositor::set_background(const cv::Scalar& i_color)
+{
+    m_color = i_color;
+    m_background.release();
+    m_backgroundVideo.release();
+    m_backgroundType = BackgroundType::Color;
+    m_preparedDepth = -1;
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Compositor::set_background(const std::string& i_videoPath)
+{
+    if(false == m_backgroundVideo.open(i_videoPath)) {
+        logging_error("Failed to open background video : " << i_videoPath);
+        m_backgroundType = BackgroundType::None;
+        return -1;
+    }
+
+    m_background.release();
+    m_backgroundType = BackgroundType::Video;
+    m_preparedDepth = -1;
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Compositor::run(const cv::Mat& i_image_withoutBackground, cv::Mat& o_composite)
+{
+    if(i_image_withoutBackground.empty() || 4 != i_image_withoutBackground.channels()) {
+        logging_error("i_image_withoutBackground must have 4 channels.");
+        return -1;
+    }
+    const int depth = i_image_withoutBackground.depth();
+    if(CV_8U != depth && CV_16U != depth && CV_32F != depth) {
+        logging_error("Unsuported depth (" << cv::typeToString(depth) << "). Supported depths are CV_32F, CV_16U and CV_8U");
+        return -1;
+    }
+
+    if(0 > prepare_background(i_image_withoutBackground.size(), depth)) {
+        logging_error("prepare_background() failed.");
+        return -1;
+    }
+
+    o_composite.create(i_image_withoutBackground.size(), CV_MAKETYPE(depth, 3));
+    switch(depth) {
+    case CV_8U: composite_image<uchar>(i_image_withoutBackground, m_background_prepared, o_composite); break;
+    case CV_16U: composite_image<ushort>(i_image_withoutBackground, m_background_prepared, o_composite); break;
+    default: composite_image<float>(i_image_withoutBackground, m_background_prepared, o_composite); break;
+    }
+
+    return 0;
+}
+
+int VideoBackgroundEraser_Compositor::prepare_background(const cv::Size& i_size, int i_depth)
+{
+    switch(m_backgroundType) {
+    case BackgroundType::None:
+        logging_error("No background, call set_background() first.");
+        return -1;
+
+    case BackgroundType::Video:
+        // Next frame, the video loops
+        m_backgroundVideo >> m_background;
+        if(m_background.empty()) {
+            m_backgroundVideo.set(cv::CAP_PROP_POS_FRAMES, 0);
+            m_backgroundVideo >> m_background;
+        }
+        if(m_background.empty()) {
+            logging_error("Failed to read the background video.");
+            return -1;
+        }
+        if(false == m_isBGR) {
+            cv::cvtColor(m_background, m_background, cv::COLOR_BGR2RGB);
+        }
+        m_preparedDepth = -1;
+        break;
+
+    default:
+        break;
+    }
+
+    // Images and colors are only prepared again when the frames change
+    if(m_preparedDepth == i_depth && m_preparedSize == i_size) {
+        return 0;
+    }
+
+    if(BackgroundType::Color == m_backgroundType) {
+        const double scale = get_maxValue(i_depth) / 255.;
+        m_background_prepared.create(1, i_size.width, CV_MAKETYPE(i_depth, 3));
+        m_background_prepared.setTo(m_color * scale);
+    } else {
+        const cv::Mat* background = &m_background;
+        if(m_background.size() != i_size) {
+            cv::resize(m_background, m_background_resized, i_size, 0, 0, m_interpolation);
+            background = &m_background_resized;
+        }
+        const double scale = get_maxValue(i_depth) / get_maxValue(m_background.depth());
+        background->convertTo(m_background_prepared, i_depth, scale);
+    }
+
+    m_preparedSize = i_size;
+    m_preparedDepth = i_depth;
+
+    return 0;
+}
+
+} /* namespace VBGE */
@@ -0,0 +1,175 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Pipeline.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+#include <thread>
+
+#include "Utils_Logging.hpp"
+
+#include "VideoBackgroundEraser_Pipeline.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+VideoBackgroundEraser_Pipeline::VideoBackgroundEraser_Pipeline(VideoBackgroundEraser& io_vbge, size_t i_queueCapacity)
+    : m_vbge(io_vbge),
+      m_decodedQueue(std::max<size_t>(1, i_queueCapacity)),
+      m_segmentedQueue(std::max<size_t>(1, i_queueCapacity)),
+      m_trimappedQueue(std::max<size_t>(1, i_queueCapacity)),
+      m_mattedQueue(std::max<size_t>(1, i_queueCapacity)),
+      // Large enough to hold every frame in flight
+      m_recycledQueue(4*std::max<size_t>(1, i_queueCapacity) + 4)
+{
+
+}
+
+VideoBackgroundEraser_Pipeline::~VideoBackgroundEraser_Pipeline()
+{
+
+}
+
+int VideoBackgroundEraser_Pipeline::run(const SourceFunction& i_source, const SinkFunction& i_sink)
+{
+    if(false == m_vbge.get_isInitialized()) {
+        logging_error("VideoBackgroundEraser instance was not correctly initialized.");
+        return -1;
+    }
+
+    m_abort = false;
+    m_result = 0;
+
+    std::thread decodeThread(&VideoBackgroundEraser_Pipeline::decode_loop, this, std::cref(i_source));
+    std::thread segmentationThread(&VideoBackgroundEraser_Pipeline::stage_loop, this,
+                                   std::ref(m_decodedQueue), std::ref(m_segmentedQueue),
+                                   &VideoBackgroundEraser::run_segmentation, "run_segmentation");
+    std::thread trimapThread(&VideoBackgroundEraser_Pipeline::stage_loop, this,
+                             std::ref(m_segmentedQueue), std::ref(m_trimappedQueue),
+                             &VideoBackgroundEraser::run_trimap, "run_trimap");
+    std::thread mattingThread(&VideoBackgroundEraser_Pipeline::stage_loop, this,
+                              std::ref(m_trimappedQueue), std::ref(m_mattedQueue),
+                              &VideoBackgroundEraser::run_matting, "run_matting");
+
+    // Encode stage runs in the calling thread
+    FramePtr frame;
+    while(m_mattedQueue.pop(frame, m_abort)) {
+        // End of stream
+        if(!frame) {
+            break;
+        }
+        const int res = i_sink(*frame);
+        if(0 > res) {
+            logging_error("Encode stage failed on frame " << frame->index);
+            set_error();
+            break;
+        }
+        if(0 < res) {
+            logging_info("Stop requested by encode stage on frame " << frame->index);
+            break;
+        }
+        // Give the frame back to the decode stage, drop it if the queue is full
+        m_recycledQueue.try_push(frame);
+    }
+
+    // Release all stages still waiting on a queue
+    m_abort = true;
+    decodeThread.join();
+    segmentationThread.join();
+    trimapThread.join();
+    mattingThread.join();
+
+    // Empty the queues so the pipeline can be run again
+    for(BoundedQueue<FramePtr>* queue : {&m_decodedQueue, &m_segmentedQueue, &m_trimappedQueue, &m_mattedQueue}) {
+        while(queue->try_pop(frame)) {
+            m_recycledQueue.try_push(frame);
+        }
+    }
+
+    return m_result;
+}
+
+void VideoBackgroundEraser_Pipeline::stop()
+{
+    m_abort = true;
+}
+
+std::vector<VideoBackgroundEraser_Pipeline::QueueStatistics> VideoBackgroundEraser_Pipeline::get_queueStatistics() const
+{
+    std::vector<QueueStatistics> statistics;
+    auto add = [&statistics](const char* i_name, const BoundedQueue<FramePtr>& i_queue) {
+        QueueStatistics s;
+        s.name          = i_name;
+        s.capacity      = i_queue.capacity();
+        s.size          = i_queue.size();
+        s.meanOccupancy = i_queue.get_meanOccupancy();
+        s.nbPushBlocked = i_queue.get_nbPushBlocked();
+        s.nbPopStarved  = i_queue.get_nbPopStarved();
+        statistics.push_back(s);
+    };
+    add("decode->segmentation", m_decodedQueue);
+    add("segmentation->trimap", m_segmentedQueue);
+    add("trimap->matting", m_trimappedQueue);
+    add("matting->encode", m_mattedQueue);
+    return statistics;
+}
+
+void VideoBackgroundEraser_Pipeline::decode_loop(const SourceFunction& i_source)
+{
+    int64_t index = 0;
+    while(false == m_abort) {
+        FramePtr frame;
+        if(false == m_recycledQueue.try_pop(frame)) {
+            frame.reset(new VideoBackgroundEraser_Frame());
+        }
+        frame->index = index++;
+
+        const int res = i_source(*frame);
+        if(0 > res) {
+            logging_error("Decode stage failed on frame " << frame->index);
+            set_error();
+            return;
+        }
+        // End of stream is signaled to the next stages with an empty pointer
+        if(0 < res) {
+            frame.reset();
+        }
+        const bool endOfStream = !frame;
+        if(false == m_decodedQueue.push(frame, m_abort) || endOfStream) {
+            return;
+        }
+    }
+}
+
+void VideoBackgroundEraser_Pipeline::stage_loop(BoundedQueue<FramePtr>& io_input, BoundedQueue<FramePtr>& io_output, StageFunction i_stage, const char* i_stageName)
+{
+    FramePtr frame;
+    while(io_input.pop(frame, m_abort)) {
+        const bool endOfStream = !frame;
+        if(!endOfStream && 0 > (m_vbge.*i_stage)(*frame)) {
+            logging_error(i_stageName << " failed on frame " << frame->index);
+            set_error();
+            return;
+        }
+        if(false == io_output.push(frame, m_abort) || endOfStream) {
+            return;
+        }
+    }
+}
+
+void VideoBackgroundEraser_Pipeline::set_error()
+{
+    m_result = -1;
+    m_abort = true;
+}
+
+} /* namespace VBGE */
@@ -0,0 +1,91 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_SceneCutDetector.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <algorithm>
+
+#include "Utils_Logging.hpp"
+
+#include "VideoBackgroundEraser_SceneCutDetector.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+VideoBackgroundEraser_SceneCutDetector::VideoBackgroundEraser_SceneCutDetector(float i_threshold, int i_thumbnailWidth)
+    : m_threshold(i_threshold),
+      m_thumbnailWidth(std::max(1, i_thumbnailWidth))
+{
+
+}
+
+VideoBackgroundEraser_SceneCutDetector::~VideoBackgroundEraser_SceneCutDetector()
+{
+
+}
+
+int VideoBackgroundEraser_SceneCutDetector::run(const cv::Mat& i_image, bool& o_isCut, double* o_distance)
+{
+    o_isCut = false;
+    if(o_distance) {
+        *o_distance = 0.;
+    }
+
+    if(i_image.empty() || 3 != i_image.channels()) {
+        logging_error("i_image must have 3 channels.");
+        return -1;
+    }
+
+    // Thumbnail, CV_8UC3
+    const int width = std::min(i_image.cols, m_thumbnailWidth);
+    const int height = std::max(1, cvRound(static_cast<double>(width) * i_image.rows / i_image.cols));
+    cv::resize(i_image, m_thumbnail, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    const cv::Mat* thumbnail = &m_thumbnail;
+    switch(i_image.depth()) {
+    case CV_8U: break;
+    case CV_16U: m_thumbnail.convertTo(m_thumbnail_uint8, CV_8U, 1./257.); thumbnail = &m_thumbnail_uint8; break;
+    case CV_32F: m_thumbnail.convertTo(m_thumbnail_uint8, CV_8U, 255.); thumbnail = &m_thumbnail_uint8; break;
+    default:
+        logging_error("Unsuported depth (" << cv::typeToString(i_image.depth()) << "). Supported depths are CV_32F, CV_16U and CV_8U");
+        return -1;
+    }
+
+    // Color histogram, 8 bins per channel, normalized
+    const int channels[] = {0, 1, 2};
+    const int histSize[] = {8, 8, 8};
+    const float range[] = {0.f, 256.f};
+    const float* ranges[] = {range, range, range};
+    cv::calcHist(thumbnail, 1, channels, cv::noArray(), m_histogram, 3, histSize, ranges);
+    cv::normalize(m_histogram, m_histogram, 1., 0., cv::NORM_L1);
+
+    if(m_size_prev == i_image.size() && !m_histogram_prev.empty()) {
+        const double distance = cv::compareHist(m_histogram, m_histogram_prev, cv::HISTCMP_BHATTACHARYYA);
+        o_isCut = (distance > m_threshold);
+        if(o_distance) {
+            *o_distance = distance;
+        }
+    }
+
+    // The current histogram becomes the previous one, the buffer of the previous one is reused for the next frame
+    std::swap(m_histogram, m_histogram_prev);
+    m_size_prev = i_image.size();
+
+    return 0;
+}
+
+void VideoBackgroundEraser_SceneCutDetector::reset()
+{
+    m_histogram_prev.release();
+    m_size_prev = cv::Size();
+}
+
+} /* namespace VBGE */
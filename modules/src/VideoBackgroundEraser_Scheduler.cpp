@@ -0,0 +1,66 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Scheduler.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include "Utils_Logging.hpp"
+
+#include "VideoBackgroundEraser_Scheduler.hpp"
+#include "VideoBackgroundEraser_Scheduler_Algo.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+VideoBackgroundEraser_Scheduler::VideoBackgroundEraser_Scheduler(const VideoBackgroundEraser_Scheduler_Settings& i_settings)
+{
+    m_algo.reset(new VideoBackgroundEraser_Scheduler_Algo(i_settings));
+}
+
+VideoBackgroundEraser_Scheduler::~VideoBackgroundEraser_Scheduler()
+{
+    m_algo.reset();
+}
+
+bool VideoBackgroundEraser_Scheduler::get_isInitialized()
+{
+    return m_algo->get_isInitialized();
+}
+
+const VideoBackgroundEraser_Scheduler_Settings& VideoBackgroundEraser_Scheduler::get_settings()
+{
+    return m_algo->get_settings();
+}
+
+int VideoBackgroundEraser_Scheduler::run_segmentation(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& io_segmentations,
+                                                      bool i_isBGR, int i_priority)
+{
+    return m_algo->run_segmentation(i_images, io_segmentations, i_isBGR, i_priority);
+}
+
+int VideoBackgroundEraser_Scheduler::run_backgroundMask(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& io_backgroundMasks,
+                                                        bool i_isBGR, int i_priority)
+{
+    return m_algo->run_backgroundMask(i_images, io_backgroundMasks, i_isBGR, i_priority);
+}
+
+int VideoBackgroundEraser_Scheduler::run_matting(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                                                 std::vector<cv::Mat>& io_alpha_predictions, bool i_isBGR, int i_priority)
+{
+    return m_algo->run_matting(i_images, i_trimaps, io_alpha_predictions, i_isBGR, i_priority);
+}
+
+SchedulerStatistics VideoBackgroundEraser_Scheduler::get_statistics()
+{
+    return m_algo->get_statistics();
+}
+
+} /* namespace VBGE */
@@ -0,0 +1,227 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Scheduler_Algo.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include "Utils_Logging.hpp"
+
+#include "VideoBackgroundEraser_Scheduler_Algo.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+std::vector<std::shared_ptr<torch::jit::script::Module>> load_models(const VideoBackgroundEraser_Scheduler_Settings& i_settings)
+{
+    std::vector<ModelRegistry::Request> requests;
+    requests.push_back(DeepLabV3_Inference::get_modelRequest(i_settings.deeplabv3_inference));
+    requests.push_back(DeepImageMatting_Inference::get_modelRequest(i_settings.deepimagematting_inference));
+    return ModelRegistry::get_instance().get_models(requests);
+}
+
+} /* namespace */
+
+VideoBackgroundEraser_Scheduler_Algo::VideoBackgroundEraser_Scheduler_Algo(const VideoBackgroundEraser_Scheduler_Settings& i_settings)
+    : m_settings(i_settings),
+      m_models(load_models(m_settings)),
+      m_deeplabv3_inference(m_settings.deeplabv3_inference),
+      m_deepimagematting_inference(m_settings.deepimagematting_inference)
+{
+    if(false == m_deeplabv3_inference.get_isInitialized()) {
+        logging_error("m_deeplabv3_inference was not correctly initialized.");
+        return;
+    }
+    if(false == m_deepimagematting_inference.get_isInitialized()) {
+        logging_error("m_deepimagematting_inference was not correctly initialized.");
+        return;
+    }
+    if(0 >= m_settings.maxBatchSize) {
+        logging_error("m_settings.maxBatchSize must be positive (" << m_settings.maxBatchSize << ").");
+        return;
+    }
+    if(0 > m_settings.maxDelay_us) {
+        logging_error("m_settings.maxDelay_us must not be negative (" << m_settings.maxDelay_us << ").");
+        return;
+    }
+
+    // /!\ Dynamic alloc
+    m_deeplabv3_batcher.reset(new InferenceBatcher(
+        [this](std::vector<InferenceBatcher::Request*>& io_requests) { return run_deeplabv3_batch(io_requests); },
+        m_settings.maxBatchSize, std::chrono::microseconds(m_settings.maxDelay_us)));
+    m_deepimagematting_batcher.reset(new InferenceBatcher(
+        [this](std::vector<InferenceBatcher::Request*>& io_requests) { return run_deepimagematting_batch(io_requests); },
+        m_settings.maxBatchSize, std::chrono::microseconds(m_settings.maxDelay_us)));
+
+    m_isInitialized = true;
+}
+
+VideoBackgroundEraser_Scheduler_Algo::~VideoBackgroundEraser_Scheduler_Algo()
+{
+    m_deeplabv3_batcher.reset();
+    m_deepimagematting_batcher.reset();
+}
+
+bool VideoBackgroundEraser_Scheduler_Algo::get_isInitialized()
+{
+    return m_isInitialized;
+}
+
+const VideoBackgroundEraser_Scheduler_Settings& VideoBackgroundEraser_Scheduler_Algo::get_settings()
+{
+    return m_settings;
+}
+
+int VideoBackgroundEraser_Scheduler_Algo::run_segmentation(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& io_segmentations,
+                                                           bool i_isBGR, int i_priority)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    return run_request(*m_deeplabv3_batcher, Kind_Segmentation, i_images, nullptr, io_segmentations, i_isBGR, i_priority);
+}
+
+int VideoBackgroundEraser_Scheduler_Algo::run_backgroundMask(const std::vector<cv::Mat>& i_images, std::vector<cv::Mat>& io_backgroundMasks,
+                                                             bool i_isBGR, int i_priority)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    return run_request(*m_deeplabv3_batcher, Kind_BackgroundMask, i_images, nullptr, io_backgroundMasks, i_isBGR, i_priority);
+}
+
+int VideoBackgroundEraser_Scheduler_Algo::run_matting(const std::vector<cv::Mat>& i_images, const std::vector<cv::Mat>& i_trimaps,
+                                                      std::vector<cv::Mat>& io_alpha_predictions, bool i_isBGR, int i_priority)
+{
+    if(false == get_isInitialized()) {
+        logging_error("This instance was not correctly initialized.");
+        return -1;
+    }
+    if(i_images.size() != i_trimaps.size()) {
+        logging_error("i_images and i_trimaps have different sizes (" << i_images.size() << " vs " << i_trimaps.size() << ").");
+        return -1;
+    }
+    return run_request(*m_deepimagematting_batcher, Kind_Matting, i_images, &i_trimaps, io_alpha_predictions, i_isBGR, i_priority);
+}
+
+SchedulerStatistics VideoBackgroundEraser_Scheduler_Algo::get_statistics()
+{
+    SchedulerStatistics statistics;
+    if(false == get_isInitialized()) {
+        return statistics;
+    }
+    statistics.nbBatches_deeplabv3 = m_deeplabv3_batcher->get_nbBatches();
+    statistics.nbImages_deeplabv3 = m_deeplabv3_batcher->get_nbImages();
+    statistics.nbBatches_deepimagematting = m_deepimagematting_batcher->get_nbBatches();
+    statistics.nbImages_deepimagematting = m_deepimagematting_batcher->get_nbImages();
+    return statistics;
+}
+
+int VideoBackgroundEraser_Scheduler_Algo::run_request(InferenceBatcher& io_batcher, int i_kind, const std::vector<cv::Mat>& i_images,
+                                                      const std::vector<cv::Mat>* i_trimaps, std::vector<cv::Mat>& io_outputs,
+                                                      bool i_isBGR, int i_priority)
+{
+    if(i_images.empty()) {
+        return 0;
+    }
+    for(auto& image : i_images) {
+        if(image.size() != i_images[0].size() || image.type() != i_images[0].type()) {
+            logging_error("i_images must all have the same size and type.");
+            return -1;
+        }
+    }
+
+    InferenceBatcher::Request request;
+    request.kind = i_kind;
+    request.priority = i_priority;
+    request.isBGR = i_isBGR;
+    request.images = i_images;
+    if(nullptr != i_trimaps) {
+        request.trimaps = *i_trimaps;
+    }
+    // The buffers of the caller are written in place when they have the right size and type
+    request.outputs.swap(io_outputs);
+    request.outputs.resize(i_images.size());
+
+    const int result = io_batcher.run(request);
+    io_outputs.swap(request.outputs);
+    return result;
+}
+
+int VideoBackgroundEraser_Scheduler_Algo::run_deeplabv3_batch(std::vector<InferenceBatcher::Request*>& io_requests)
+{
+    m_deeplabv3_images.clear();
+    m_deeplabv3_outputs.clear();
+    for(auto request : io_requests) {
+        m_deeplabv3_images.insert(m_deeplabv3_images.end(), request->images.begin(), request->images.end());
+        m_deeplabv3_outputs.insert(m_deeplabv3_outputs.end(), request->outputs.begin(), request->outputs.end());
+    }
+
+    // Every request of a batch has the same kind and channel order
+    const InferenceBatcher::Request& first = *io_requests[0];
+    int result = 0;
+    if(Kind_BackgroundMask == first.kind) {
+        result = m_deeplabv3_inference.run_backgroundMask(m_deeplabv3_images, m_deeplabv3_outputs, first.isBGR);
+    } else {
+        result = m_deeplabv3_inference.run(m_deeplabv3_images, m_deeplabv3_outputs, first.isBGR);
+    }
+    if(0 > result) {
+        logging_error("DeepLabV3 failed on a batch of " << m_deeplabv3_images.size() << " images.");
+    } else {
+        size_t idx = 0;
+        for(auto request : io_requests) {
+            for(auto& output : request->outputs) {
+                output = m_deeplabv3_outputs[idx++];
+            }
+        }
+    }
+
+    // The buffers belong to the requests
+    m_deeplabv3_images.clear();
+    m_deeplabv3_outputs.clear();
+    return result;
+}
+
+int VideoBackgroundEraser_Scheduler_Algo::run_deepimagematting_batch(std::vector<InferenceBatcher::Request*>& io_requests)
+{
+    m_deepimagematting_images.clear();
+    m_deepimagematting_trimaps.clear();
+    m_deepimagematting_outputs.clear();
+    for(auto request : io_requests) {
+        m_deepimagematting_images.insert(m_deepimagematting_images.end(), request->images.begin(), request->images.end());
+        m_deepimagematting_trimaps.insert(m_deepimagematting_trimaps.end(), request->trimaps.begin(), request->trimaps.end());
+        m_deepimagematting_outputs.insert(m_deepimagematting_outputs.end(), request->outputs.begin(), request->outputs.end());
+    }
+
+    const int result = m_deepimagematting_inference.run(m_deepimagematting_images, m_deepimagematting_trimaps,
+                                                         m_deepimagematting_outputs, io_requests[0]->isBGR);
+    if(0 > result) {
+        logging_error("DeepImageMatting failed on a batch of " << m_deepimagematting_images.size() << " images.");
+    } else {
+        size_t idx = 0;
+        for(auto request : io_requests) {
+            for(auto& output : request->outputs) {
+                output = m_deepimagematting_outputs[idx++];
+            }
+        }
+    }
+
+    // The buffers belong to the requests
+    m_deepimagematting_images.clear();
+    m_deepimagematting_trimaps.clear();
+    m_deepimagematting_outputs.clear();
+    return result;
+}
+
+} /* namespace VBGE */
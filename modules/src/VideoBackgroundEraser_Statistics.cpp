@@ -0,0 +1,159 @@
+/*============================================================================*/
+/* File Description                                                           */
+/*============================================================================*/
+/**
+ * @file        VideoBackgroundEraser_Statistics.cpp
+
+ */
+/*============================================================================*/
+
+/*============================================================================*/
+/* Includes                                                                   */
+/*============================================================================*/
+#include <sstream>
+
+#include "VideoBackgroundEraser_Statistics.hpp"
+
+/*============================================================================*/
+/* namespace                                                                  */
+/*============================================================================*/
+namespace VBGE {
+
+namespace {
+
+std::string to_json(const Statistics& i_statistics)
+{
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"nbFrames\": " << i_statistics.nbFrames << ",\n";
+    json << "  \"unknownRatio\": " << i_statistics.unknownRatio << ",\n";
+    json << "  \"unknownRatio_lastFrame\": " << i_statistics.unknownRatio_lastFrame << ",\n";
+    json << "  \"initialization_ms\": " << i_statistics.initialization_ms << ",\n";
+    json << "  \"timeToFirstFrame_ms\": " << i_statistics.timeToFirstFrame_ms << ",\n";
+    const FrameCounters& frames = i_statistics.frameCounters;
+    json << "  \"frameCounters\": {"
+         << "\"nbFrames_inferred\": " << frames.nbFrames_inferred
+         << ", \"nbFrames_propagated\": " << frames.nbFrames_propagated
+         << ", \"nbKeyframes_forced\": " << frames.nbKeyframes_forced
+         << ", \"nbFrames_duplicate\": " << frames.nbFrames_duplicate
+         << ", \"nbSceneCuts\": " << frames.nbSceneCuts << "},\n";
+    const AllocatorStatistics& allocator = i_statistics.allocator;
+    json << "  \"allocator\": {"
+         << "\"nbAllocations\": " << allocator.nbAllocations
+         << ", \"nbBytes\": " << allocator.nbBytes
+         << ", \"nbSystemAllocations\": " << allocator.nbSystemAllocations
+         << ", \"cachedBytes\": " << allocator.cachedBytes << "},\n";
+    json << "  \"stages\": [";
+    for(size_t i = 0 ; i < i_statistics.stages.size() ; ++i) {
+        const StageStatistics& stage = i_statistics.stages[i];
+        json << (0 == i ? "\n" : ",\n");
+        json << "    {\"name\": \"" << stage.name << "\""
+             << ", \"nbCalls\": " << stage.nbCalls
+             << ", \"latency_mean_ms\": " << stage.latency_mean_ms
+             << ", \"latency_p50_ms\": " << stage.latency_p50_ms
+             << ", \"latency_p95_ms\": " << stage.latency_p95_ms
+             << ", \"latency_p99_ms\": " << stage.latency_p99_ms << "}";
+    }
+    json << "\n  ],\n";
+    json << "  \"partitions\": [";
+    for(size_t i = 0 ; i < i_statistics.partitions.size() ; ++i) {
+        const PartitionStatistics& partition = i_statistics.partitions[i];
+        json << (0 == i ? "\n" : ",\n");
+        json << "    {\"name\": \"" << partition.name << "\""
+             << ", \"firstCore\": " << partition.firstCore
+             << ", \"nbCores\": " << partition.nbCores
+             << ", \"nbThreads\": " << partition.nbThreads
+             << ", \"busyRatio\": " << partition.busyRatio
+             << ", \"cpuUtilization\": " << partition.cpuUtilization << "}";
+    }
+    json << (i_statistics.partitions.empty() ? "]\n" : "\n  ]\n");
+    json << "}\n";
+    return json.str();
+}
+
+std::string to_prometheus(const Statistics& i_statistics)
+{
+    std::ostringstream text;
+    text << "# HELP vbge_frames_total Frames which went through the whole pipeline\n";
+    text << "# TYPE vbge_frames_total counter\n";
+    text << "vbge_frames_total " << i_statistics.nbFrames << "\n";
+
+    const FrameCounters& frames = i_statistics.frameCounters;
+    text << "# HELP vbge_segmentation_frames_total Frames processed by each path of the segmentation stage\n";
+    text << "# TYPE vbge_segmentation_frames_total counter\n";
+    text << "vbge_segmentation_frames_total{path=\"inferred\"} " << frames.nbFrames_inferred << "\n";
+    text << "vbge_segmentation_frames_total{path=\"propagated\"} " << frames.nbFrames_propagated << "\n";
+    text << "vbge_segmentation_frames_total{path=\"duplicate\"} " << frames.nbFrames_duplicate << "\n";
+    text << "# TYPE vbge_keyframes_forced_total counter\n";
+    text << "vbge_keyframes_forced_total " << frames.nbKeyframes_forced << "\n";
+    text << "# TYPE vbge_scene_cuts_total counter\n";
+    text << "vbge_scene_cuts_total " << frames.nbSceneCuts << "\n";
+
+    const AllocatorStatistics& allocator = i_statistics.allocator;
+    text << "# TYPE vbge_allocations_total counter\n";
+    text << "vbge_allocations_total " << allocator.nbAllocations << "\n";
+    text << "# TYPE vbge_allocated_bytes_total counter\n";
+    text << "vbge_allocated_bytes_total " << allocator.nbBytes << "\n";
+    text << "# TYPE vbge_system_allocations_total counter\n";
+    text << "vbge_system_allocations_total " << allocator.nbSystemAllocations << "\n";
+    text << "# TYPE vbge_pool_cached_bytes gauge\n";
+    text << "vbge_pool_cached_bytes " << allocator.cachedBytes << "\n";
+
+    text << "# HELP vbge_trimap_unknown_ratio Fraction of the trimap pixels in the unknown band\n";
+    text << "# TYPE vbge_trimap_unknown_ratio gauge\n";
+    text << "vbge_trimap_unknown_ratio{scope=\"all\"} " << i_statistics.unknownRatio << "\n";
+    text << "vbge_trimap_unknown_ratio{scope=\"last_frame\"} " << i_statistics.unknownRatio_lastFrame << "\n";
+
+    text << "# HELP vbge_initialization_seconds Time spent in the constructor, in seconds\n";
+    text << "# TYPE vbge_initialization_seconds gauge\n";
+    text << "vbge_initialization_seconds " << i_statistics.initialization_ms / 1000. << "\n";
+    text << "# HELP vbge_time_to_first_frame_seconds Time from the constructor to the end of the first frame, in seconds\n";
+    text << "# TYPE vbge_time_to_first_frame_seconds gauge\n";
+    text << "vbge_time_to_first_frame_seconds " << i_statistics.timeToFirstFrame_ms / 1000. << "\n";
+
+    text << "# HELP vbge_stage_latency_seconds Latency of each stage, in seconds\n";
+    text << "# TYPE vbge_stage_latency_seconds summary\n";
+    for(auto& stage : i_statistics.stages) {
+        const std::string label = "stage=\"" + stage.name + "\"";
+        text << "vbge_stage_latency_seconds{" << label << ",quantile=\"0.5\"} " << stage.latency_p50_ms / 1000. << "\n";
+        text << "vbge_stage_latency_seconds{" << label << ",quantile=\"0.95\"} " << stage.latency_p95_ms / 1000. << "\n";
+        text << "vbge_stage_latency_seconds{" << label << ",quantile=\"0.99\"} " << stage.latency_p99_ms / 1000. << "\n";
+        text << "vbge_stage_latency_seconds_sum{" << label << "} " << stage.latency_mean_ms * stage.nbCalls / 1000. << "\n";
+        text << "vbge_stage_latency_seconds_count{" << label << "} " << stage.nbCalls << "\n";
+    }
+
+    if(!i_statistics.partitions.empty()) {
+        text << "# HELP vbge_partition_threads Number of threads of each thread partition\n";
+        text << "# TYPE vbge_partition_threads gauge\n";
+        for(auto& partition : i_statistics.partitions) {
+            text << "vbge_partition_threads{partition=\"" << partition.name << "\"} " << partition.nbThreads << "\n";
+        }
+        text << "# HELP vbge_partition_busy_ratio Fraction of the time spent in the networks of each thread partition\n";
+        text << "# TYPE vbge_partition_busy_ratio gauge\n";
+        for(auto& partition : i_statistics.partitions) {
+            if(0. <= partition.busyRatio) {
+                text << "vbge_partition_busy_ratio{partition=\"" << partition.name << "\"} " << partition.busyRatio << "\n";
+            }
+        }
+        text << "# HELP vbge_partition_cpu_utilization Fraction of the time the cores of each pinned thread partition were busy\n";
+        text << "# TYPE vbge_partition_cpu_utilization gauge\n";
+        for(auto& partition : i_statistics.partitions) {
+            if(0. <= partition.cpuUtilization) {
+                text << "vbge_partition_cpu_utilization{partition=\"" << partition.name << "\"} " << partition.cpuUtilization << "\n";
+            }
+        }
+    }
+    return text.str();
+}
+
+} /* namespace */
+
+std::string Statistics::to_string(StatisticsFormat i_format) const
+{
+    switch(i_format) {
+    case StatisticsFormat::Prometheus: return to_prometheus(*this);
+    default: return to_json(*this);
+    }
+}
+
+} /* namespace VBGE */
@@ -6,6 +6,7 @@
 
  */
 /*============================================================================*/
+#include <algorithm>
 #include <iostream>
 #include <thread>
 #include <cmath>
@@ -16,6 +17,11 @@
 
 #include <Utils_Logging.hpp>
 #include <VideoBackgroundEraser.hpp>
+#include <VideoBackgroundEraser_Pipeline.hpp>
+#include <FrameSink_ImageDirectory.hpp>
+#include <FrameSink_Video.hpp>
+#include <FrameSink_Raw.hpp>
+#include <VideoBackgroundEraser_Compositor.hpp>
 
 ////// APPLICATION ARGUMENTS //////
 struct {
@@ -24,6 +30,15 @@ struct {
     bool hideDisplay;
     std::string outputPath;
     std::string outputPathGrid;
+    int queueCapacity;
+    int writerThreads;
+    int pngCompression;
+    int pngStrategy;
+    std::string outputVideoPath;
+    std::string outputVideoCodec;
+    std::string outputAlphaVideoPath;
+    std::string outputRawPath;
+    int outputRawMaxFrames;
 
     VBGE::VideoBackgroundEraser_Settings vbge_settings;
 
@@ -71,7 +86,93 @@ int initializeAndParseArguments(int argc, char **argv, CmdArguments& o_cmdArgume
         tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<float>     ("r", "imageMatting_scale",
                                                                                          "Rescale for Deep Image Matting",
                                                                                          false, 1.f, "float", cmd)));
-
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "queueCapacity",
+                                                                                         "Number of frames each queue of the processing pipeline can hold",
+                                                                                         false, 2, "int", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "writerThreads",
+                                                                                         "Number of threads encoding and writing output images",
+                                                                                         false, 4, "int", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "pngCompression",
+                                                                                         "PNG compression level, from 0 (fastest) to 9 (smallest)",
+                                                                                         false, 1, "int", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "pngStrategy",
+                                                                                         "PNG compression strategy : 0 default, 1 filtered, 2 huffman only, 3 RLE, 4 fixed",
+                                                                                         false, cv::IMWRITE_PNG_STRATEGY_RLE, "int", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "pooledAllocator",
+                                                                                        "Reuse released image buffers instead of allocating new ones for each frame",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "roiMatting",
+                                                                                        "Run Deep Image Matting only on crops around the uncertain areas of the trimap",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<float>     ("", "temporalScale",
+                                                                                         "Rescale for the optical flow and the temporal management",
+                                                                                         false, 1.f, "float", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "opticalFlowPreset",
+                                                                                         "Preset of the optical flow : 0 ultrafast, 1 fast, 2 medium",
+                                                                                         false, cv::DISOpticalFlow::PRESET_MEDIUM, "int", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "keyframeInterval",
+                                                                                         "Run DeepLabV3 every N frames and propagate the mask with the optical flow in between",
+                                                                                         false, 1, "int", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "skipDuplicates",
+                                                                                        "Reuse the output of the previous frame when a frame is a duplicate of it",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<float>     ("", "duplicateThreshold",
+                                                                                         "Maximum mean difference, in 8-bit levels, between a duplicate and the previous frame",
+                                                                                         false, 1.f, "float", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "sceneCuts",
+                                                                                        "Detect scene cuts and reset the temporal management on each of them",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<std::string>("", "statisticsPath",
+                                                                                         "Path of a file where the statistics are written every 100 frames",
+                                                                                         false, "", "string", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "prometheus",
+                                                                                        "Write the statistics in Prometheus text format instead of JSON",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "optimize",
+                                                                                        "Freeze the models and optimize them for inference (libtorch 1.10 or later)",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<std::string>("", "modelCacheDirectory",
+                                                                                         "Directory where the frozen models are cached, with --optimize",
+                                                                                         false, "", "string", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "warmup",
+                                                                                        "Number of forwards of each network at the input resolution before the first frame",
+                                                                                        false, 0, "int", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<std::string>("", "int8DeepLabV3ModelPath",
+                                                                                         "Quantized DeepLabV3 model (tools/quantize_model.py), runs DeepLabV3 in INT8 on the CPU",
+                                                                                         false, "", "string", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<std::string>("", "int8DeepImageMattingModelPath",
+                                                                                         "Quantized DeepImageMatting model (tools/quantize_model.py), runs DeepImageMatting in INT8 on the CPU",
+                                                                                         false, "", "string", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "bf16",
+                                                                                        "Run the networks in bfloat16, on CPUs with AVX512-BF16 or AMX (FP32 otherwise)",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "threads",
+                                                                                        "Number of cores shared by torch and OpenCV, 0 to keep the defaults of the libraries",
+                                                                                        false, 0, "int", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "pinThreads",
+                                                                                        "Pin the threads of each partition of --threads to their cores, from core 0",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::SwitchArg           ("", "concurrentNetworks",
+                                                                                        "DeepLabV3 and DeepImageMatting run concurrently on separate halves of the torch cores of --threads",
+                                                                                        cmd, false)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<float>     ("", "segmentationScale",
+                                                                                        "Rescale factor of the images before DeepLabV3, the masks are upsampled guided by the images",
+                                                                                        false, 1.f, "float", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<std::string>("", "outputVideo",
+                                                                                         "Path of a video where the RGBA results are written (FFmpeg), at the frame rate of the input",
+                                                                                         false, "", "string", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<std::string>("", "outputVideoCodec",
+                                                                                         "Codec of --outputVideo : qtrle (.mov), png (.mov) or ffv1 (.mkv or .mov)",
+                                                                                         false, "qtrle", "string", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<std::string>("", "outputAlphaVideo",
+                                                                                         "Path of a second video with only the alpha matte, written with --outputVideo",
+                                                                                         false, "", "string", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<std::string>("", "outputRaw",
+                                                                                         "Path of a memory-mapped file of uncompressed RGBA results, or - for the standard output",
+                                                                                         false, "", "string", cmd)));
+        tclap_args.push_back(std::shared_ptr<TCLAP::Arg>(new TCLAP::ValueArg<int>       ("", "outputRawMaxFrames",
+                                                                                        "Expected number of frames of --outputRaw, the file grows up to 4 times more. 0 for the frame count of the input",
+                                                                                        false, 0, "int", cmd)));
 
 
 
@@ -112,9 +213,55 @@ int initializeAndParseArguments(int argc, char **argv, CmdArguments& o_cmdArgume
     deeplabv3.background_classId_vector     = classId_vector.empty() ? (std::vector<int>() = {0}) : classId_vector;
     deeplabv3.inferenceDeviceType           = o_cmdArguments.useCuda ? torch::kCUDA : torch::kCPU;
     deepimagematting.inferenceDeviceType    = deepimagematting.inferenceDeviceType;
+    o_cmdArguments.vbge_settings.input_isBGR = true;
 
     o_cmdArguments.vbge_settings.enable_temporalManagement = dynamic_cast<TCLAP::SwitchArg*>      (tclap_args[idx++].get())->getValue();
     o_cmdArguments.vbge_settings.imageMatting_scale        = dynamic_cast<TCLAP::ValueArg<float>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.queueCapacity                           = dynamic_cast<TCLAP::ValueArg<int>*>  (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.writerThreads                           = dynamic_cast<TCLAP::ValueArg<int>*>  (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.pngCompression                          = dynamic_cast<TCLAP::ValueArg<int>*>  (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.pngStrategy                             = dynamic_cast<TCLAP::ValueArg<int>*>  (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.enable_pooledAllocator    = dynamic_cast<TCLAP::SwitchArg*>      (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.enable_roiMatting         = dynamic_cast<TCLAP::SwitchArg*>      (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.temporal_scale            = dynamic_cast<TCLAP::ValueArg<float>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.opticalFlow_preset        = dynamic_cast<TCLAP::ValueArg<int>*>  (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.keyframe_interval         = dynamic_cast<TCLAP::ValueArg<int>*>  (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.enable_duplicateDetection = dynamic_cast<TCLAP::SwitchArg*>      (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.duplicate_maxDifference   = dynamic_cast<TCLAP::ValueArg<float>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.enable_sceneCutDetection  = dynamic_cast<TCLAP::SwitchArg*>      (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.statistics_dumpPath       = dynamic_cast<TCLAP::ValueArg<std::string>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.statistics_dumpFormat     = dynamic_cast<TCLAP::SwitchArg*>      (tclap_args[idx++].get())->getValue()
+                                                             ? VBGE::StatisticsFormat::Prometheus : VBGE::StatisticsFormat::JSON;
+    deeplabv3.enable_optimizeForInference = dynamic_cast<TCLAP::SwitchArg*>(tclap_args[idx++].get())->getValue();
+    deepimagematting.enable_optimizeForInference = deeplabv3.enable_optimizeForInference;
+    deeplabv3.optimizedModel_cacheDirectory = dynamic_cast<TCLAP::ValueArg<std::string>*>(tclap_args[idx++].get())->getValue();
+    deepimagematting.optimizedModel_cacheDirectory = deeplabv3.optimizedModel_cacheDirectory;
+    o_cmdArguments.vbge_settings.warmup_nbIterations = dynamic_cast<TCLAP::ValueArg<int>*>(tclap_args[idx++].get())->getValue();
+    deeplabv3.quantized_model_path = dynamic_cast<TCLAP::ValueArg<std::string>*>(tclap_args[idx++].get())->getValue();
+    if(!deeplabv3.quantized_model_path.empty()) {
+        deeplabv3.precision = VBGE::InferencePrecision::INT8;
+    }
+    deepimagematting.quantized_model_path = dynamic_cast<TCLAP::ValueArg<std::string>*>(tclap_args[idx++].get())->getValue();
+    if(!deepimagematting.quantized_model_path.empty()) {
+        deepimagematting.precision = VBGE::InferencePrecision::INT8;
+    }
+    if(dynamic_cast<TCLAP::SwitchArg*>(tclap_args[idx++].get())->getValue()) {
+        // INT8 models stay in INT8
+        for(auto precision : {&deeplabv3.precision, &deepimagematting.precision}) {
+            if(VBGE::InferencePrecision::FP32 == *precision) {
+                *precision = VBGE::InferencePrecision::BF16;
+            }
+        }
+    }
+    o_cmdArguments.vbge_settings.threads_budget            = dynamic_cast<TCLAP::ValueArg<int>*>  (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.enable_threadPinning      = dynamic_cast<TCLAP::SwitchArg*>      (tclap_args[idx++].get())->getValue();
+    o_cmdArguments.vbge_settings.enable_concurrentNetworks = dynamic_cast<TCLAP::SwitchArg*>      (tclap_args[idx++].get())->getValue();
+    deeplabv3.segmentation_scale                           = dynamic_cast<TCLAP::ValueArg<float>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.outputVideoPath      = dynamic_cast<TCLAP::ValueArg<std::string>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.outputVideoCodec     = dynamic_cast<TCLAP::ValueArg<std::string>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.outputAlphaVideoPath = dynamic_cast<TCLAP::ValueArg<std::string>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.outputRawPath        = dynamic_cast<TCLAP::ValueArg<std::string>*>(tclap_args[idx++].get())->getValue();
+    o_cmdArguments.outputRawMaxFrames   = dynamic_cast<TCLAP::ValueArg<int>*>        (tclap_args[idx++].get())->getValue();
 
     return 0;
 }
@@ -133,11 +280,9 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
-    // Create and initialize VideoBackgroundEraser
-    std::unique_ptr<VBGE::VideoBackgroundEraser> vbge(new VBGE::VideoBackgroundEraser(cmdArguments.vbge_settings));
-    if(false == vbge->get_isInitialized()) {
-        logging_error("VBGE::VideoBackgroundEraser was not correctly initialized");
-        return EXIT_FAILURE;
+    // The standard output carries the frames : every log goes to the standard error from now on
+    if("-" == cmdArguments.outputRawPath) {
+        std::cout.rdbuf(std::cerr.rdbuf());
     }
 
     // Open input
@@ -149,104 +294,268 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
-    // Prepare grid background
-    cv::Mat gridBackground;
+    // The warmup runs at the resolution of the input
+    if(0 < cmdArguments.vbge_settings.warmup_nbIterations) {
+        cmdArguments.vbge_settings.warmup_size = cv::Size(static_cast<int>(vc.get(cv::CAP_PROP_FRAME_WIDTH)),
+                                                          static_cast<int>(vc.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    }
+
+    // Create and initialize VideoBackgroundEraser
+    std::unique_ptr<VBGE::VideoBackgroundEraser> vbge(new VBGE::VideoBackgroundEraser(cmdArguments.vbge_settings));
+    if(false == vbge->get_isInitialized()) {
+        logging_error("VBGE::VideoBackgroundEraser was not correctly initialized");
+        return EXIT_FAILURE;
+    }
+
+    // Prepare grid background, the compositor resizes it to the size of the frames
+    VBGE::VideoBackgroundEraser_Compositor gridCompositor(cmdArguments.vbge_settings.input_isBGR);
     {
-        gridBackground.create(18, 32, CV_8UC3);
+        cv::Mat gridBackground(18, 32, CV_8UC3);
         for(int y = 0 ; y < gridBackground.rows ; ++y) {
             for(int x = 0, b = y%2 ; x < gridBackground.cols ; ++x, b=!b) {
                 gridBackground.at<cv::Vec3b>(y, x) = cv::Vec3b::all(b ? 255 : 128);
             }
         }
+        gridCompositor.set_background(gridBackground, cv::INTER_NEAREST);
     }
 
-    // Main loop
-    cv::Mat inputImage_bgr, inputImage_rgb;
-    cv::Mat outputImage_bgra, outputImage_rgba;
-    cv::Mat gridOutputImage_bgr, gridOutputImage_rgb;
-    int cnt = 0;
-    while(true)
-    {
+    // Asynchronous writers for the outputs
+    // Output file names start at 1
+    VBGE::FrameSink_ImageDirectory_Settings writer_settings;
+    writer_settings.index_offset     = 1;
+    writer_settings.nbWorkers        = cmdArguments.writerThreads;
+    writer_settings.maxPendingFrames = 2*std::max(1, cmdArguments.writerThreads);
+    writer_settings.png_compression  = cmdArguments.pngCompression;
+    writer_settings.png_strategy     = cmdArguments.pngStrategy;
+    std::unique_ptr<VBGE::FrameSink> outputWriter, gridOutputWriter;
+    if(!cmdArguments.outputPath.empty()) {
+        writer_settings.directory_path = cmdArguments.outputPath;
+        outputWriter.reset(new VBGE::FrameSink_ImageDirectory(writer_settings));
+        if(false == outputWriter->get_isInitialized()) {
+            logging_error("VBGE::FrameSink_ImageDirectory was not correctly initialized for : " << cmdArguments.outputPath);
+            return EXIT_FAILURE;
+        }
+    }
+    if(!cmdArguments.outputPathGrid.empty()) {
+        writer_settings.directory_path = cmdArguments.outputPathGrid;
+        gridOutputWriter.reset(new VBGE::FrameSink_ImageDirectory(writer_settings));
+        if(false == gridOutputWriter->get_isInitialized()) {
+            logging_error("VBGE::FrameSink_ImageDirectory was not correctly initialized for : " << cmdArguments.outputPathGrid);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Video output, RGBA, at the frame rate of the input
+    std::unique_ptr<VBGE::FrameSink_Video> videoWriter;
+    if(!cmdArguments.outputVideoPath.empty()) {
+        VBGE::FrameSink_Video_Settings video_settings;
+        video_settings.path       = cmdArguments.outputVideoPath;
+        video_settings.alpha_path = cmdArguments.outputAlphaVideoPath;
+        video_settings.isBGR      = cmdArguments.vbge_settings.input_isBGR;
+        const double fps = vc.get(cv::CAP_PROP_FPS);
+        if(0. < fps) {
+            video_settings.fps = fps;
+        } else {
+            logging_info("The frame rate of the input is unknown, the video is written at " << video_settings.fps << " frames/s");
+        }
+        if("png" == cmdArguments.outputVideoCodec) {
+            video_settings.codec = VBGE::VideoCodec::PNG;
+        } else if("ffv1" == cmdArguments.outputVideoCodec) {
+            video_settings.codec = VBGE::VideoCodec::FFV1;
+        } else if("qtrle" == cmdArguments.outputVideoCodec) {
+            video_settings.codec = VBGE::VideoCodec::QuickTimeAnimation;
+        } else {
+            logging_error("Unknown codec : " << cmdArguments.outputVideoCodec);
+            return EXIT_FAILURE;
+        }
+        videoWriter.reset(new VBGE::FrameSink_Video(video_settings));
+        if(false == videoWriter->get_isInitialized()) {
+            logging_error("VBGE::FrameSink_Video was not correctly initialized");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Raw output, uncompressed, in a memory-mapped file or on the standard output
+    std::unique_ptr<VBGE::FrameSink_Raw> rawWriter;
+    if(!cmdArguments.outputRawPath.empty()) {
+        VBGE::FrameSink_Raw_Settings raw_settings;
+        raw_settings.path      = cmdArguments.outputRawPath;
+        raw_settings.isBGR     = cmdArguments.vbge_settings.input_isBGR;
+        raw_settings.maxFrames = (0 < cmdArguments.outputRawMaxFrames) ? cmdArguments.outputRawMaxFrames
+                                                                       : static_cast<int64_t>(vc.get(cv::CAP_PROP_FRAME_COUNT));
+        rawWriter.reset(new VBGE::FrameSink_Raw(raw_settings));
+        if(false == rawWriter->get_isInitialized()) {
+            logging_error("VBGE::FrameSink_Raw was not correctly initialized, set --outputRawMaxFrames if the frame count of the input is unknown");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Lambda function to log encoding throughput
+    auto log_writerStatistics = [](const std::string& i_name, VBGE::FrameSink* i_writer) {
+        if(i_writer) {
+            auto statistics = i_writer->get_statistics();
+            logging_info("Writer " << i_name << " : " << statistics.nbFrames << " frames, " << statistics.framesPerSecond << " frames/s, "
+                         << statistics.megabytesPerSecond << " MB/s, " << statistics.encodeSeconds << " s of encoding");
+        }
+    };
+
+    // Processing pipeline : decode -> segmentation -> trimap -> matting -> encode
+    VBGE::VideoBackgroundEraser_Pipeline pipeline(*vbge, std::max(1, cmdArguments.queueCapacity));
+
+    // Lambda function to log how full each queue of the pipeline is
+    auto log_queueStatistics = [&pipeline]() {
+        for(auto& queue : pipeline.get_queueStatistics()) {
+            logging_info("Queue " << queue.name << " : mean occupancy " << queue.meanOccupancy << "/" << queue.capacity
+                         << ", producer blocked " << queue.nbPushBlocked << " times, consumer starved " << queue.nbPopStarved << " times");
+        }
+    };
+
+    // Lambda function to log the allocations of the last frame
+    auto log_allocatorStatistics = [&vbge, &cmdArguments]() {
+        if(cmdArguments.vbge_settings.enable_pooledAllocator) {
+            auto statistics = vbge->get_allocatorStatistics();
+            logging_info("Allocator : " << statistics.nbAllocations_lastFrame << " allocations and " << statistics.nbBytes_lastFrame
+                         << " bytes during the last frame, " << statistics.nbSystemAllocations << " system allocations since the start, "
+                         << statistics.cachedBytes << " bytes in the pool");
+        }
+    };
+
+    // Lambda function to log how many frames were segmented, propagated or skipped
+    auto log_frameCounters = [&vbge]() {
+        auto counters = vbge->get_frameCounters();
+        logging_info("Segmentation : " << counters.nbFrames_inferred << " frames inferred, " << counters.nbFrames_propagated
+                     << " frames propagated, " << counters.nbKeyframes_forced << " keyframes forced, "
+                     << counters.nbFrames_duplicate << " duplicate frames skipped, " << counters.nbSceneCuts << " scene cuts");
+    };
+
+    // Lambda function to log the latency of each stage
+    auto log_stageLatencies = [&vbge]() {
+        auto statistics = vbge->get_statistics();
+        for(auto& stage : statistics.stages) {
+            if(0 < stage.nbCalls) {
+                logging_info("Stage " << stage.name << " : " << stage.nbCalls << " calls, p50 " << stage.latency_p50_ms << " ms, p95 "
+                             << stage.latency_p95_ms << " ms, p99 " << stage.latency_p99_ms << " ms");
+            }
+        }
+        logging_info("Trimap unknown band : " << 100.*statistics.unknownRatio << "% of the pixels");
+        logging_info("Initialization : " << statistics.initialization_ms << " ms, time to first frame : "
+                     << statistics.timeToFirstFrame_ms << " ms");
+        for(auto& partition : statistics.partitions) {
+            logging_info("Partition " << partition.name << " : " << partition.nbThreads << " threads, "
+                         << (0. <= partition.busyRatio ? std::to_string(100.*partition.busyRatio) + "% busy" : std::string("not timed"))
+                         << (0. <= partition.cpuUtilization ? ", cores used at " + std::to_string(100.*partition.cpuUtilization) + "%" : std::string()));
+        }
+    };
+
+    // Decode stage
+    auto source_function = [&vc](VBGE::VideoBackgroundEraser_Frame& o_frame) -> int {
         // Load image
-        logging_info("Grab next image, cnt = " << cnt++);
+        // VideoBackgroundEraser is set to take BGR input, no need to convert to RGB
+        logging_info("Grab next image, cnt = " << o_frame.index);
+        cv::Mat& inputImage_bgr = o_frame.image;
         vc >> inputImage_bgr;
+        o_frame.timestamp_ms = vc.get(cv::CAP_PROP_POS_MSEC);
         if(inputImage_bgr.empty()) {
             logging_error("Failed to grab new image");
-            break;
+            return 1;
         } else {
             logging_info("Image of type " << cv::typeToString(inputImage_bgr.type()) << " and size " << inputImage_bgr.size());
             if(CV_8UC3 != inputImage_bgr.type()) {
                 logging_error("CV_8UC3 != inputImage_bgr.type()");
-                return EXIT_FAILURE;
+                return -1;
             }
         }
 
-        // Convert input image from BGR to RGB
-        cv::cvtColor(inputImage_bgr, inputImage_rgb, cv::COLOR_BGR2RGB);
-
-        //-- Main method
-        // Process background segmentation and removal
-        res = vbge->run(inputImage_rgb, outputImage_rgba);
-        if(0 > res) {
-            logging_error("VBGE::VideoBackgroundEraser::run() failed.");
-            return EXIT_FAILURE;
-        }
-
-        // Create grid output image
-        if(outputImage_rgba.size() != gridBackground.size()) {
-            cv::resize(gridBackground, gridBackground, outputImage_rgba.size(), 0, 0, cv::INTER_NEAREST);
-        }
-        gridOutputImage_rgb.create(outputImage_rgba.size(), CV_8UC3);
-        for(int y = 0, b = 0 ; y < gridOutputImage_rgb.rows ; ++y) {
-            for(int x = 0 ; x < gridOutputImage_rgb.cols ; ++x, b^=1) {
-                cv::Vec4b &out_im = outputImage_rgba.at<cv::Vec4b>(y, x);
-                cv::Vec3b &grid = gridBackground.at<cv::Vec3b>(y, x);
-                cv::Vec3b &grid_im = gridOutputImage_rgb.at<cv::Vec3b>(y, x);
-                const float alpha = out_im(3)/255.f;
-                for(int c = 0 ; c < 3 ; ++c) {
-                    grid_im(c) = alpha * out_im(c) + (1.f - alpha) * grid(c);
-                }
+        return 0;
+    };
+
+    // Encode stage
+    auto sink_function = [&](VBGE::VideoBackgroundEraser_Frame& io_frame) -> int {
+        // Output is BGRA, as the input is BGR
+        cv::Mat outputImage_bgra = io_frame.image_withoutBackground;
+        const int cnt = io_frame.index + 1;
+        // New buffer for each frame, its ownership is given to the writer
+        cv::Mat gridOutputImage_bgr;
+
+        // Create grid output image, only when it is saved or displayed
+        if(gridOutputWriter || false == cmdArguments.hideDisplay) {
+            if(0 > gridCompositor.run(outputImage_bgra, gridOutputImage_bgr)) {
+                logging_error("gridCompositor.run() failed.");
+                return -1;
             }
         }
 
-        // Convert gridOutputImage from RGBA to BGRA
-        cv::cvtColor(gridOutputImage_rgb, gridOutputImage_bgr, cv::COLOR_RGB2BGR);
-        // Convert gridOutputImage from RGBA to BGRA
-        cv::cvtColor(outputImage_rgba, outputImage_bgra, cv::COLOR_RGBA2BGRA);
-
-        // Lambda function to save image
-        auto save_function = [cnt](const std::string& i_directory_path, const cv::Mat& i_image) -> bool {
-            logging_info("Saving results in : " << i_directory_path);
-            std::ostringstream oss;
-            oss << i_directory_path << "/" << std::setw(8) << std::setfill('0') << cnt << ".png";
-            std::string path = oss.str();
-            logging_info("Writing : " << path);
-            return cv::imwrite(path, i_image);
-        };
+        // Display, before the buffers are given to the writers
+        int key = -1;
+        if(false == cmdArguments.hideDisplay) {
+            cv::imshow("inputImage", io_frame.image);
+            cv::imshow("outputImage", outputImage_bgra);
+            cv::imshow("gridOutputImage", gridOutputImage_bgr);
+            key = cv::waitKey(0) & 0xff;
+        }
 
         // Save rgba output
-        if(!cmdArguments.outputPath.empty() && !save_function(cmdArguments.outputPath, outputImage_bgra)) {
+        // The frame releases its reference, so the writers own the output buffer. Both writers only read it, they share it
+        io_frame.image_withoutBackground.release();
+        if(videoWriter && 0 > videoWriter->write(io_frame.index, io_frame.timestamp_ms, cv::Mat(outputImage_bgra))) {
+            logging_error("Failed to write outputImage_bgra in :" << cmdArguments.outputVideoPath);
+            return -1;
+        }
+        if(rawWriter && 0 > rawWriter->write(io_frame.index, io_frame.timestamp_ms, cv::Mat(outputImage_bgra))) {
+            logging_error("Failed to write outputImage_bgra in :" << cmdArguments.outputRawPath);
+            return -1;
+        }
+        if(outputWriter && 0 > outputWriter->write(io_frame.index, std::move(outputImage_bgra))) {
             logging_error("Failed to write outputImage_bgra in :" << cmdArguments.outputPath);
-            return EXIT_FAILURE;
+            return -1;
         }
 
         // Save output with grid background
-        if(!cmdArguments.outputPathGrid.empty() && !save_function(cmdArguments.outputPathGrid, gridOutputImage_bgr)) {
+        if(gridOutputWriter && 0 > gridOutputWriter->write(io_frame.index, std::move(gridOutputImage_bgr))) {
             logging_error("Failed to write gridOutputImage_bgr in :" << cmdArguments.outputPathGrid);
-            return EXIT_FAILURE;
+            return -1;
         }
 
-        // Display
-        if(false == cmdArguments.hideDisplay) {
-            cv::imshow("inputImage", inputImage_bgr);
-            cv::imshow("outputImage", outputImage_rgba);
-            cv::imshow("gridOutputImage", gridOutputImage_rgb);
-            int key = cv::waitKey(0) & 0xff;
-            if(27 == key || 'q' == key) {
-                break;
-            }
+        if(0 == cnt % 100) {
+            log_queueStatistics();
+            log_allocatorStatistics();
+            log_frameCounters();
+            log_writerStatistics("outputPath", outputWriter.get());
+            log_writerStatistics("outputPathGrid", gridOutputWriter.get());
+            log_writerStatistics("outputVideo", videoWriter.get());
+            log_writerStatistics("outputRaw", rawWriter.get());
+        }
+
+        if(27 == key || 'q' == key) {
+            return 1;
+        }
+
+        return 0;
+    };
+
+    // Main loop
+    res = pipeline.run(source_function, sink_function);
+    log_queueStatistics();
+    log_allocatorStatistics();
+    log_frameCounters();
+    log_stageLatencies();
+    if(0 > res) {
+        logging_error("VBGE::VideoBackgroundEraser_Pipeline::run() failed.");
+        return EXIT_FAILURE;
+    }
+
+    // Wait for the last frames to be written
+    for(VBGE::FrameSink* writer : {outputWriter.get(), gridOutputWriter.get(), static_cast<VBGE::FrameSink*>(videoWriter.get()),
+                                   static_cast<VBGE::FrameSink*>(rawWriter.get())}) {
+        if(writer && 0 > writer->flush()) {
+            logging_error("Failed to write all output images");
+            return EXIT_FAILURE;
         }
     }
+    log_writerStatistics("outputPath", outputWriter.get());
+    log_writerStatistics("outputPathGrid", gridOutputWriter.get());
+    log_writerStatistics("outputVideo", videoWriter.get());
+    log_writerStatistics("outputRaw", rawWriter.get());
 
 
     // Manually reset (and delete content of) pointer
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""Post-training INT8 quantization of the TorchScript models of VideoBackgroundEraser.
+
+Calibrates DeepLabV3 or Deep Image Matting on a set of frames, writes a quantized TorchScript
+model for the fbgemm engine (loaded by the C++ wrappers with InferencePrecision::INT8), and
+reports on the same frames the accuracy delta, the latency and the size against FP32.
+
+The preprocessing is the one of DeepLabV3_Inference and DeepImageMatting_Inference :
+RGB in [0, 1], normalized by mean and std for DeepLabV3, and a 4th plane with the trimap
+in [0, 1] for Deep Image Matting. Deep Image Matting needs trimaps : they are built from the
+FP32 DeepLabV3 masks, as in the pipeline.
+
+Examples :
+    ./quantize_model.py deeplabv3 -m best_deeplabv3_skydiver.pt -o best_deeplabv3_skydiver_int8.pt \\
+                       -i ../data/YourVideo.mp4 -b 0 3 4
+    ./quantize_model.py deepimagematting -m best_DeepImageMatting.pt -o best_DeepImageMatting_int8.pt \\
+                       -i ../data/frames/ --deeplabv3 best_deeplabv3_skydiver.pt -b 0 3 4
+"""
+
+import argparse
+import os
+import sys
+import time
+
+import cv2
+import numpy as np
+import torch
+
+try:
+    from torch.ao.quantization import get_default_qconfig, quantize_jit
+except ImportError:
+    from torch.quantization import get_default_qconfig, quantize_jit
+
+DEEPLABV3_MEAN = np.array([0.485, 0.456, 0.406], dtype=np.float32)
+DEEPLABV3_STD = np.array([0.229, 0.224, 0.225], dtype=np.float32)
+
+
+def read_frames(path, max_frames, size):
+    """Frames of a video or of a directory of images, RGB uint8, every frame of a video is not needed."""
+    frames = []
+    if os.path.isdir(path):
+        names = sorted(os.listdir(path))
+        step = max(1, len(names) // max_frames)
+        for name in names[::step]:
+            image = cv2.imread(os.path.join(path, name), cv2.IMREAD_COLOR)
+            if image is not None:
+                frames.append(image)
+    else:
+        capture = cv2.VideoCapture(path)
+        count = int(capture.get(cv2.CAP_PROP_FRAME_COUNT))
+        step = max(1, count // max_frames)
+        index = 0
+        while True:
+            ok, image = capture.read()
+            if not ok:
+                break
+            if index % step == 0:
+                frames.append(image)
+            index += 1
+    frames = frames[:max_frames]
+    if size is not None:
+        frames = [cv2.resize(frame, size, interpolation=cv2.INTER_AREA) for frame in frames]
+    return [cv2.cvtColor(frame, cv2.COLOR_BGR2RGB) for frame in frames]
+
+
+def deeplabv3_input(frame):
+    planes = (frame.astype(np.float32) / 255.0 - DEEPLABV3_MEAN) / DEEPLABV3_STD
+    return torch.from_numpy(planes.transpose(2, 0, 1).copy()).unsqueeze(0)
+
+
+def deepimagematting_input(frame, trimap):
+    planes = np.concatenate([frame.astype(np.float32) / 255.0, trimap[:, :, None].astype(np.float32) / 255.0], axis=2)
+    return torch.from_numpy(planes.transpose(2, 0, 1).copy()).unsqueeze(0)
+
+
+def background_mask(scores, background_ids):
+    """255 for background pixels : same rule as DeepLabV3_Inference::run_backgroundMask()."""
+    classes = scores.argmax(1)[0].numpy()
+    return np.isin(classes, background_ids).astype(np.uint8) * 255, classes
+
+
+def compute_trimap(foreground_mask):
+    """Same morphology as VideoBackgroundEraser_Algo::compute_trimap() : 1 pixel outside the contour, 15 inside."""
+    kernel = cv2.getStructuringElement(cv2.MORPH_ELLIPSE, (3, 3))
+    dilated = cv2.dilate(foreground_mask, kernel, iterations=1)
+    eroded = cv2.erode(foreground_mask, kernel, iterations=15)
+    trimap = np.full(foreground_mask.shape, 128, dtype=np.uint8)
+    trimap[eroded == 255] = 255
+    trimap[dilated == 0] = 0
+    return trimap
+
+
+def run_timed(model, inputs):
+    outputs = []
+    start = time.perf_counter()
+    with torch.no_grad():
+        for tensor in inputs:
+            outputs.append(model(tensor))
+    return outputs, 1000.0 * (time.perf_counter() - start) / max(1, len(inputs))
+
+
+def quantize(model, inputs):
+    """Graph mode post-training static quantization of a TorchScript module, calibrated on inputs."""
+    def calibrate(prepared, data):
+        with torch.no_grad():
+            for tensor in data:
+                prepared(tensor)
+    return quantize_jit(model, {'': get_default_qconfig('fbgemm')}, calibrate, [inputs])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('network', choices=['deeplabv3', 'deepimagematting'])
+    parser.add_argument('-m', '--model', required=True, help='FP32 TorchScript model')
+    parser.add_argument('-o', '--output', required=True, help='Quantized TorchScript model to write')
+    parser.add_argument('-i', '--input', required=True, help='Calibration frames : a video or a directory of images')
+    parser.add_argument('-b', '--background_classId_list', type=int, nargs='+', default=[0],
+                        help='Background ids of DeepLabV3, to compare the masks and to build the trimaps')
+    parser.add_argument('--deeplabv3', help='FP32 DeepLabV3 model, to build the trimaps of Deep Image Matting')
+    parser.add_argument('--maxFrames', type=int, default=64, help='Number of calibration frames')
+    parser.add_argument('--width', type=int, default=0, help='Resize the frames to this width, 0 to keep them')
+    args = parser.parse_args()
+
+    if 'fbgemm' not in torch.backends.quantized.supported_engines:
+        sys.exit('The fbgemm quantized engine is not available in this PyTorch build')
+    torch.backends.quantized.engine = 'fbgemm'
+
+    size = None
+    if 0 < args.width:
+        first = read_frames(args.input, 1, None)
+        if not first:
+            sys.exit('No frame in ' + args.input)
+        height = int(round(first[0].shape[0] * args.width / first[0].shape[1]))
+        size = (args.width, height)
+    frames = read_frames(args.input, args.maxFrames, size)
+    if not frames:
+        sys.exit('No frame in ' + args.input)
+    print('Calibration on {} frames of {}x{}'.format(len(frames), frames[0].shape[1], frames[0].shape[0]))
+
+    model = torch.jit.load(args.model, map_location='cpu').eval()
+
+    if 'deeplabv3' == args.network:
+        inputs = [deeplabv3_input(frame) for frame in frames]
+    else:
+        if args.deeplabv3 is None:
+            sys.exit('--deeplabv3 is needed to build the trimaps of Deep Image Matting')
+        deeplabv3 = torch.jit.load(args.deeplabv3, map_location='cpu').eval()
+        inputs = []
+        with torch.no_grad():
+            for frame in frames:
+                mask, _ = background_mask(deeplabv3(deeplabv3_input(frame)), args.background_classId_list)
+                trimap = compute_trimap(255 - mask)
+                inputs.append(deepimagematting_input(frame, trimap))
+
+    quantized = quantize(model, inputs)
+    torch.jit.save(quantized, args.output)
+
+    # Accuracy delta, latency and size against FP32, on the calibration set
+    outputs_fp32, latency_fp32 = run_timed(model, inputs)
+    outputs_int8, latency_int8 = run_timed(quantized, inputs)
+    if 'deeplabv3' == args.network:
+        agreement = []
+        iou = []
+        for fp32, int8 in zip(outputs_fp32, outputs_int8):
+            mask_fp32, classes_fp32 = background_mask(fp32, args.background_classId_list)
+            mask_int8, classes_int8 = background_mask(int8, args.background_classId_list)
+            agreement.append(np.mean(classes_fp32 == classes_int8))
+            foreground_fp32 = mask_fp32 == 0
+            foreground_int8 = mask_int8 == 0
+            union = np.logical_or(foreground_fp32, foreground_int8).sum()
+            iou.append(1.0 if 0 == union else np.logical_and(foreground_fp32, foreground_int8).sum() / union)
+        print('Classes agreement with FP32 : {:.4f}'.format(np.mean(agreement)))
+        print('Foreground IoU with FP32    : mean {:.4f}, min {:.4f}'.format(np.mean(iou), np.min(iou)))
+    else:
+        errors = []
+        for tensor, fp32, int8 in zip(inputs, outputs_fp32, outputs_int8):
+            unknown = (tensor[0, 3] == 128.0 / 255.0).numpy()
+            difference = 255.0 * (fp32 - int8).abs().reshape(unknown.shape).numpy()
+            if unknown.any():
+                errors.append(difference[unknown].mean())
+        print('Alpha mean absolute difference with FP32, unknown pixels : mean {:.3f}, max {:.3f} (8-bit levels)'
+              .format(np.mean(errors) if errors else 0.0, np.max(errors) if errors else 0.0))
+    print('Latency : FP32 {:.1f} ms, INT8 {:.1f} ms per frame ({:.2f}x)'
+          .format(latency_fp32, latency_int8, latency_fp32 / max(latency_int8, 1e-6)))
+    print('Size    : FP32 {:.1f} MB, INT8 {:.1f} MB'
+          .format(os.path.getsize(args.model) / 1e6, os.path.getsize(args.output) / 1e6))
+    print('Written ' + args.output)
+
+
+if __name__ == '__main__':
+    main()